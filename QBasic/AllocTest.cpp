@@ -0,0 +1,113 @@
+#include "AllocTest.hpp"
+
+#include "basic/Machine.hpp"
+#include "basic/Script.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <sstream>
+
+// every allocation of the process, on any thread
+static std::atomic<uint64_t> g_allocations{0};
+
+void *operator new(std::size_t size) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc{};
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+static basic::Program load(const basic::String &code) {
+	std::istringstream sin{code};
+	return basic::Script::Load(sin).PopValue().GetProgram();
+}
+
+// allocations of a whole run on a Machine, resumed after each PRINT
+static uint64_t count_execute(const basic::Program &program) {
+	uint64_t begin = g_allocations.load();
+	std::unique_ptr<basic::Context> context;
+	basic::String outputs;
+	while (true) {
+		auto machine = basic::Machine::Execute(program, std::move(context), [] {});
+		auto result = basic::Machine::GetResult(&machine);
+		context = std::move(result.context);
+		context->PopOutputs(&outputs);
+		if (!result.result.PopError().Format().empty())
+			break;
+	}
+	return g_allocations.load() - begin;
+}
+
+void AllocTest::testExecute() {
+	// the loop runs 100 times longer with the same allocations: none once warm, the JIT compiled in both
+	const auto workload = [](int count) {
+		return "10 LET i = 0\n"
+		       "20 LET s = 0\n"
+		       "30 REM loop\n"
+		       "40 LET s = s + i * i - i / 3\n"
+		       "50 LET i = i + 1\n"
+		       "60 IF i < " +
+		       std::to_string(count) +
+		       " THEN 30\n"
+		       "70 GOTO 90\n"
+		       "80 LET s = 0\n"
+		       "90 END\n";
+	};
+	uint64_t short_run = count_execute(load(workload(2000)));
+	QCOMPARE(count_execute(load(workload(200000))), short_run);
+
+	// loops and array elements, with the JIT too
+	const auto loop_workload = [](int count) {
+		return "10 DIM a(64)\n"
+		       "20 FOR k = 1 TO " +
+		       std::to_string(count) +
+		       "\n"
+		       "30 LET a(k MOD 64) = a((k - 1) MOD 64) + k\n"
+		       "40 NEXT k\n";
+	};
+	short_run = count_execute(load(loop_workload(2000)));
+	QCOMPARE(count_execute(load(loop_workload(200000))), short_run);
+
+	basic::Jit::SetMode(basic::JitMode::kDisabled);
+	short_run = count_execute(load(workload(2000)));
+	QCOMPARE(count_execute(load(workload(200000))), short_run);
+	basic::Jit::SetMode(basic::JitMode::kEnabled);
+}
+
+void AllocTest::testPrint() {
+	// steps of a PRINT loop with numbers longer than a short string, popped into a reused buffer after each PRINT
+	auto program = load("10 LET i = 1000\n"
+	                    "20 PRINT i * 1000000 * 1000000 - 999999999\n"
+	                    "30 LET i = i + 1\n"
+	                    "40 GOTO 20\n");
+	auto context = basic::Context::Create(program).PopValue();
+	basic::String outputs;
+	const auto run = [&](int steps) {
+		for (int i = 0; i < steps; ++i) {
+			program.Step(context.get());
+			context->PopOutputs(&outputs);
+		}
+	};
+	run(3000);
+	uint64_t begin = g_allocations.load();
+	run(30000);
+	QCOMPARE(g_allocations.load() - begin, uint64_t{0});
+
+	// kept unpopped, the outputs grow geometrically
+	begin = g_allocations.load();
+	for (int i = 0; i < 30000; ++i)
+		program.Step(context.get());
+	QVERIFY(g_allocations.load() - begin <= 32);
+
+	// on a Machine, which returns after each PRINT, the allocations are per resume, not per statement
+	const auto prints = [](int count) {
+		return "10 FOR i = 1 TO " + std::to_string(count) + "\n20 PRINT i * 1000000 * 1000000\n30 NEXT i\n";
+	};
+	uint64_t short_run = count_execute(load(prints(100)));
+	uint64_t long_run = count_execute(load(prints(1100)));
+	QVERIFY((long_run - short_run) / 1000 <= 16);
+}
+
+QTEST_MAIN(AllocTest)
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class AllocTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testExecute();
+	static void testPrint();
+
+public:
+	AllocTest() = default;
+};
@@ -0,0 +1,178 @@
+#include "ArrayTest.hpp"
+
+#include "basic/Checkpoint.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+static basic::String run_script(const char *script_str) {
+	std::istringstream sin{script_str};
+	auto script_res = basic::Script::Load(sin);
+	if (script_res.IsError())
+		return script_res.PopError().Format();
+	std::ostringstream sout;
+	script_res.PopValue().Run(sout);
+	return sout.str();
+}
+
+static basic::String format_parsed(const char *stmt_str) {
+	auto stmt_res = basic::Statement::Parse(basic::Token::Tokenize(stmt_str));
+	return stmt_res.IsOK() ? stmt_res.PopValue()->Format() : stmt_res.PopError().Format();
+}
+
+static basic::String end_message(basic::LineID line) {
+	return "[" + std::to_string(line) + "]" + basic::MsgEndOfProgram{}.Format() + "\n";
+}
+
+void ArrayTest::testParse() {
+	QCOMPARE(format_parsed("DIM a ( 10 )"), "DIM a(10)");
+	QCOMPARE(format_parsed("LET a(i+1)=a((i))*-a(0)"), "LET a(i + 1) = a(i) * -a(0)");
+	QCOMPARE(format_parsed("INPUT a(n MOD 3)"), "INPUT a(n MOD 3)");
+	QCOMPARE(format_parsed("PRINT b(a(1)) ** 2 - n (2)"), "PRINT b(a(1)) ** 2 - n(2)");
+	// MOD is an operator, not an array
+	QCOMPARE(format_parsed("PRINT 7 MOD (2)"), "PRINT 7 MOD 2");
+
+	QCOMPARE(format_parsed("DIM a"), (basic::ErrInvalidVariable{.stmt_str = "DIM a", .var_str = "a"}.Format()));
+	QCOMPARE(format_parsed("DIM a(1) + 1"),
+	         (basic::ErrInvalidVariable{.stmt_str = "DIM a(1) + 1", .var_str = "a(1) + 1"}.Format()));
+	QCOMPARE(format_parsed("LET a(1 = 2"),
+	         (basic::ErrInvalidVariable{.stmt_str = "LET a(1 = 2", .var_str = "a(1"}.Format()));
+	QCOMPARE(format_parsed("INPUT 2(1)"),
+	         (basic::ErrInvalidVariable{.stmt_str = "INPUT 2(1)", .var_str = "2(1)"}.Format()));
+	QVERIFY(basic::Statement::Parse(basic::Token::Tokenize("PRINT a()")).IsError());
+	QVERIFY(basic::Statement::Parse(basic::Token::Tokenize("PRINT a(1)(2)")).IsError());
+	QVERIFY(basic::Statement::Parse(basic::Token::Tokenize("PRINT 1 a(2)")).IsError());
+}
+
+void ArrayTest::testRun() {
+	// squares through an array, the elements start at zero and a scalar of the same name is separate
+	QCOMPARE(run_script("10 DIM a(5)\n"
+	                    "20 LET a = 100\n"
+	                    "30 FOR i = 1 TO 4\n"
+	                    "40 LET a(i) = a(i - 1) + 2 * i - 1\n"
+	                    "50 NEXT i\n"
+	                    "60 PRINT a(4) + a(0)\n"
+	                    "70 PRINT a\n"),
+	         "16\n100\n" + end_message(70));
+
+	// a sieve, each element written through an index expression
+	QCOMPARE(run_script("10 DIM f(1000)\n"
+	                    "20 LET c = 0\n"
+	                    "30 FOR i = 2 TO 999\n"
+	                    "40 IF f(i) > 0 THEN 90\n"
+	                    "50 LET c = c + 1\n"
+	                    "60 FOR j = i + i TO 999 STEP i\n"
+	                    "70 LET f(j) = 1\n"
+	                    "80 NEXT j\n"
+	                    "90 NEXT i\n"
+	                    "100 PRINT c\n"),
+	         "168\n" + end_message(100));
+
+	// INPUT into elements, DIM again clears
+	QCOMPARE(run_script("10 DIM a(3)\n"
+	                    "20 INPUT a(2)\n"
+	                    "30 INPUT a(a(2) - 9)\n"
+	                    "40 PRINT a(0) * a(2)\n"
+	                    "50 DIM a(a(2))\n"
+	                    "60 PRINT a(8)\n"
+	                    "? 9\n"
+	                    "? 6\n"),
+	         "54\n0\n" + end_message(60));
+
+	// the index is checked before the value is computed, INPUT reads first
+	using basic::RuntimeError;
+	QCOMPARE(run_script("10 DIM a(3)\n20 LET a(3) = 1 / 0\n"),
+	         "[20]" + RuntimeError{basic::ErrIndexOutOfRange{"a(3)"}}.Format() + "\n");
+	QCOMPARE(run_script("10 DIM a(3)\n20 INPUT a(-1)\n? 1\n"),
+	         "[20]" + RuntimeError{basic::ErrIndexOutOfRange{"a(-1)"}}.Format() + "\n");
+	QCOMPARE(run_script("10 DIM a(0)\n20 PRINT a(0)\n"),
+	         "[20]" + RuntimeError{basic::ErrIndexOutOfRange{"a(0)"}}.Format() + "\n");
+	QCOMPARE(run_script("10 PRINT a(0)\n"), "[10]" + RuntimeError{basic::ErrUndefinedVariable{"a()"}}.Format() + "\n");
+	QCOMPARE(run_script("10 LET a = 1\n20 LET a(0) = 1\n"),
+	         "[20]" + RuntimeError{basic::ErrUndefinedVariable{"a()"}}.Format() + "\n");
+	QCOMPARE(run_script("10 DIM a(0 - 1)\n"),
+	         "[10]" + RuntimeError{basic::ErrInvalidArraySize{"a(-1)"}}.Format() + "\n");
+	basic::String too_large = std::to_string(basic::kArrayMaxSize + 1);
+	QCOMPARE(run_script(("10 DIM a(" + too_large + ")\n").c_str()),
+	         "[10]" + RuntimeError{basic::ErrInvalidArraySize{"a(" + too_large + ")"}}.Format() + "\n");
+}
+
+void ArrayTest::testFormatAST() {
+	std::istringstream sin{"10 DIM a(2)\n"
+	                       "20 LET a(1) = a(0) + 1\n"
+	                       "30 INPUT a(0)\n"};
+	auto program = basic::Script::Load(sin).PopValue().GetProgram();
+	auto context = basic::Context::Create(program).PopValue();
+	context->PushInput("5");
+	while (program.Step(context.get()).IsOK())
+		;
+	QCOMPARE(program.FormatAST(context.get()), "10 DIM [execute:1]\n"
+	                                           "  a() [use:3]\n"
+	                                           "    2\n"
+	                                           "20 LET = [execute:1]\n"
+	                                           "  a() [use:3]\n"
+	                                           "    1\n"
+	                                           "  +\n"
+	                                           "    a()\n"
+	                                           "      0\n"
+	                                           "    1\n"
+	                                           "30 INPUT [execute:1]\n"
+	                                           "  a() [use:3]\n"
+	                                           "    0\n");
+}
+
+void ArrayTest::testFork() {
+	std::istringstream sin{"10 DIM a(3)\n"
+	                       "20 INPUT x\n"
+	                       "30 LET a(1) = x\n"
+	                       "40 PRINT a(1)\n"};
+	auto program = basic::Script::Load(sin).PopValue().GetProgram();
+	auto context = basic::Context::Create(program).PopValue();
+	program.Step(context.get());
+
+	// the forks share the elements until one of them writes
+	auto fork = context->Fork();
+	QCOMPARE(fork->FindArray("a"), context->FindArray("a"));
+	context->PushInput("7");
+	fork->PushInput("8");
+	for (int i = 0; i < 3; ++i) {
+		program.Step(context.get());
+		program.Step(fork.get());
+	}
+	QVERIFY(fork->FindArray("a") != context->FindArray("a"));
+	QCOMPARE(context->PopOutputs(), "7");
+	QCOMPARE(fork->PopOutputs(), "8");
+}
+
+void ArrayTest::testCheckpoint() {
+	std::istringstream sin{"10 DIM a(4)\n"
+	                       "20 FOR i = 0 TO 3\n"
+	                       "30 INPUT a(i)\n"
+	                       "40 NEXT i\n"
+	                       "50 PRINT a(0) + a(1) + a(2) + a(3)\n"};
+	auto program = basic::Script::Load(sin).PopValue().GetProgram();
+	auto context = basic::Context::Create(program).PopValue();
+	context->PushInput("1");
+	context->PushInput("20");
+	while (program.Step(context.get()).IsOK())
+		;
+
+	basic::String checkpoint;
+	basic::Checkpoint::Write(basic::StringWriter{&checkpoint}, program, context.get());
+	auto opt_restored = basic::Checkpoint::Read(basic::StringReader{checkpoint});
+	QVERIFY(opt_restored.has_value());
+	auto &restored = *opt_restored->context;
+	QVERIFY(*restored.FindArray("a") == (std::vector<basic::Int>{1, 20, 0, 0}));
+	QCOMPARE(restored.GetArrayStat("a"), context->GetArrayStat("a"));
+
+	restored.PushInput("300");
+	restored.PushInput("4000");
+	while (true) {
+		auto result = opt_restored->program.Step(&restored);
+		if (result.IsError() && !result.PopError().Format().empty())
+			break;
+	}
+	QCOMPARE(restored.PopOutputs(), "4321");
+}
+
+QTEST_MAIN(ArrayTest)
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class ArrayTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testParse();
+	static void testRun();
+	static void testFormatAST();
+	static void testFork();
+	static void testCheckpoint();
+
+public:
+	ArrayTest() = default;
+};
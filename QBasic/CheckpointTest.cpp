@@ -0,0 +1,154 @@
+#include "CheckpointTest.hpp"
+
+#include "basic/Checkpoint.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+static basic::Program load(const char *code) {
+	std::istringstream sin{code};
+	return basic::Script::Load(sin).PopValue().GetProgram();
+}
+
+// resume through PRINTs, returns the outputs followed by the message the run stopped with
+static basic::String run(const basic::Program &program, basic::Context *p_context) {
+	while (true) {
+		auto result = program.Step(p_context);
+		if (result.IsOK())
+			continue;
+		auto message = result.PopError().Format();
+		if (!message.empty())
+			return p_context->PopOutputs() + "|" + message;
+	}
+}
+
+static const char *const kSumCode = "10 INPUT n\n"
+                                    "20 LET s = 0\n"
+                                    "30 LET i = 1\n"
+                                    "40 LET s = s + i * i\n"
+                                    "50 LET i = i + 1\n"
+                                    "60 IF i < n + 1 THEN 40\n"
+                                    "70 PRINT s\n"
+                                    "80 INPUT n\n"
+                                    "90 PRINT n\n";
+
+// paused in the middle of the loop, with an output and an input pending
+static basic::String write_sum_checkpoint(basic::Program *p_program, std::unique_ptr<basic::Context> *p_context) {
+	*p_program = load(kSumCode);
+	*p_context = basic::Context::Create(*p_program).PopValue();
+	(*p_context)->PushInput("10");
+	(*p_context)->PushInput("3");
+	for (int i = 0; i < 15; ++i)
+		p_program->Step(p_context->get());
+	basic::String ret;
+	basic::Checkpoint::Write(basic::StringWriter{&ret}, *p_program, p_context->get());
+	return ret;
+}
+
+void CheckpointTest::testRoundTrip() {
+	basic::Program program;
+	std::unique_ptr<basic::Context> context;
+	basic::String checkpoint = write_sum_checkpoint(&program, &context);
+
+	auto opt_restored = basic::Checkpoint::Read(basic::StringReader{checkpoint});
+	QVERIFY(opt_restored.has_value() && opt_restored->context);
+	const auto &restored = *opt_restored->context;
+	QCOMPARE(opt_restored->program.Format(), program.Format());
+	QCOMPARE(restored.GetLine(), context->GetLine());
+	QCOMPARE(restored.GetStepCount(), context->GetStepCount());
+	for (const char *var : {"n", "s", "i"}) {
+		QVERIFY(restored.FindVariable(var) != nullptr);
+		QCOMPARE(basic::IntToString(*restored.FindVariable(var)), basic::IntToString(*context->FindVariable(var)));
+		QCOMPARE(restored.GetVariableStat(var), context->GetVariableStat(var));
+	}
+	for (basic::LineID line = 10; line <= 90; line += 10) {
+		QCOMPARE(restored.GetLineStat(line), context->GetLineStat(line));
+		QCOMPARE(restored.GetBranchStat(line), context->GetBranchStat(line));
+	}
+	QVERIFY(context->GetLineStat(40) > 0);
+
+	// writes back the same bytes, and both resume the same way
+	basic::String rewritten;
+	basic::Checkpoint::Write(basic::StringWriter{&rewritten}, opt_restored->program, &restored);
+	QVERIFY(rewritten == checkpoint);
+	QCOMPARE(run(opt_restored->program, opt_restored->context.get()), run(program, context.get()));
+
+	// and through a stream, without a context
+	std::stringstream stream;
+	basic::Checkpoint::Write(stream, program, nullptr);
+	auto opt_program = basic::Checkpoint::Read(stream);
+	QVERIFY(opt_program.has_value() && opt_program->context == nullptr);
+	QCOMPARE(opt_program->program.Format(), program.Format());
+}
+
+void CheckpointTest::testTruncated() {
+	basic::Program program;
+	std::unique_ptr<basic::Context> context;
+	basic::String checkpoint = write_sum_checkpoint(&program, &context);
+
+	for (std::size_t size = 0; size < checkpoint.size(); ++size) {
+		basic::String prefix = checkpoint.substr(0, size);
+		QVERIFY(!basic::Checkpoint::Read(basic::StringReader{prefix}).has_value());
+		std::istringstream sin{prefix};
+		QVERIFY(!basic::Checkpoint::Read(sin).has_value());
+	}
+}
+
+void CheckpointTest::testCorrupted() {
+	basic::Program program;
+	std::unique_ptr<basic::Context> context;
+	basic::String checkpoint = write_sum_checkpoint(&program, &context);
+
+	basic::String version = checkpoint;
+	version[4] ^= 1;
+	QVERIFY(!basic::Checkpoint::Read(basic::StringReader{version}).has_value());
+
+	// a statement that doesn't parse
+	basic::String header{basic::Checkpoint::kVersionStr, sizeof(basic::Checkpoint::kVersionStr)};
+	basic::String statement = header + "\x01\x0a\x07PRINT (";
+	QVERIFY(!basic::Checkpoint::Read(basic::StringReader{statement}).has_value());
+
+	// sizes far past the end are not allocated
+	basic::String size = header + "\x01\x0a\xff\xff\xff\xff\xff\xff\xff\xff\x7fPRINT 1";
+	QVERIFY(!basic::Checkpoint::Read(basic::StringReader{size}).has_value());
+	basic::String count = header + "\xff\xff\xff\xff\xff\xff\xff\xff\x7f\x0a\x07PRINT 1";
+	QVERIFY(!basic::Checkpoint::Read(basic::StringReader{count}).has_value());
+
+	// any other byte changed reads within the input, into a checkpoint or nothing
+	for (std::size_t i = 0; i < checkpoint.size(); ++i)
+		for (char mask : {'\x01', '\x40', '\x80', '\xff'}) {
+			basic::String corrupted = checkpoint;
+			corrupted[i] = char(corrupted[i] ^ mask);
+			auto opt_checkpoint = basic::Checkpoint::Read(basic::StringReader{corrupted});
+			if (i < sizeof(basic::Checkpoint::kVersionStr))
+				QVERIFY(!opt_checkpoint.has_value());
+		}
+}
+
+void CheckpointTest::testFork() {
+	auto program = load("10 INPUT n\n20 LET s = n * 2\n30 PRINT s\n");
+	auto context = basic::Context::Create(program).PopValue();
+	context->SetVariable("a", 1);
+	context->PushInput("5");
+	program.Step(context.get());
+
+	auto fork = context->Fork();
+	fork->SetVariable("a", 2);
+	fork->SetVariable("b", 3);
+	QCOMPARE(run(program, fork.get()), "10|" + basic::MsgEndOfProgram{}.Format());
+
+	// none of the fork's writes show in the parent, which goes on its own way
+	QCOMPARE(*context->FindVariable("a"), basic::Int{1});
+	QVERIFY(context->FindVariable("b") == nullptr);
+	QVERIFY(context->FindVariable("s") == nullptr);
+	QCOMPARE(context->GetLine(), basic::LineID{20});
+	QCOMPARE(context->GetLineStat(20), basic::Count{1});
+	QCOMPARE(context->GetLineStat(30), basic::Count{0});
+	QCOMPARE(context->GetVariableStat("s"), basic::Count{0});
+	context->SetVariable("n", 7);
+	QCOMPARE(run(program, context.get()), "14|" + basic::MsgEndOfProgram{}.Format());
+	QCOMPARE(*fork->FindVariable("s"), basic::Int{10});
+	QCOMPARE(*fork->FindVariable("n"), basic::Int{5});
+}
+
+QTEST_MAIN(CheckpointTest)
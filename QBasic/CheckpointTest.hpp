@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class CheckpointTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testRoundTrip();
+	static void testTruncated();
+	static void testCorrupted();
+	static void testFork();
+
+public:
+	CheckpointTest() = default;
+};
@@ -0,0 +1,150 @@
+#include "DaemonTest.hpp"
+
+#include "basic/Daemon.hpp"
+
+#include <map>
+#include <unistd.h>
+
+namespace {
+
+// a daemon serving on its own thread
+class Served {
+public:
+	const basic::String path = "/tmp/qbasicd-test-" + std::to_string(getpid()) + ".sock";
+
+private:
+	std::unique_ptr<basic::Daemon> m_daemon;
+	std::thread m_thread;
+
+public:
+	inline Served() : m_daemon{basic::Daemon::Listen(path, 2)} {
+		if (m_daemon)
+			m_thread = std::thread{&basic::Daemon::Serve, m_daemon.get()};
+	}
+	inline ~Served() {
+		if (m_daemon) {
+			m_daemon->Stop();
+			m_thread.join();
+		}
+	}
+	inline basic::Daemon *operator->() const { return m_daemon.get(); }
+	inline explicit operator bool() const { return m_daemon != nullptr; }
+};
+
+// the outputs of a request, then its final "[LINE]MESSAGE", or an empty string if the connection is lost
+basic::String receive_request(basic::DaemonClient *p_client, basic::DaemonStatus *p_status = nullptr) {
+	basic::String ret;
+	while (auto opt_reply = p_client->Receive()) {
+		if (opt_reply->type == basic::DaemonFrame::kOutput)
+			ret += opt_reply->text + "\n";
+		else {
+			if (p_status)
+				*p_status = opt_reply->status;
+			return ret + "[" + std::to_string(opt_reply->line) + "]" + opt_reply->text;
+		}
+	}
+	return {};
+}
+
+} // namespace
+
+void DaemonTest::testRequest() {
+	Served daemon;
+	QVERIFY(daemon);
+	auto client = basic::DaemonClient::Connect(daemon.path);
+	QVERIFY(client != nullptr);
+	basic::DaemonStatus status{};
+
+	// inputs of the source come first
+	const char *code = "10 INPUT a\n20 INPUT b\n30 PRINT a + b\n40 PRINT a * b\n? 6\n";
+	client->Submit(1, code, {"7"});
+	QCOMPARE(receive_request(client.get(), &status), "13\n42\n[40]" + basic::MsgEndOfProgram{}.Format());
+	QVERIFY(status == basic::DaemonStatus::kEnd);
+
+	client->Submit(2, code);
+	QCOMPARE(receive_request(client.get(), &status), "[20]" + basic::MsgRequestInput{}.Format());
+	QVERIFY(status == basic::DaemonStatus::kInputRequest);
+
+	client->Submit(3, "10 PRINT 1\n20 PRINT 1 / 0\n");
+	QCOMPARE(receive_request(client.get(), &status),
+	         "1\n[20]" + basic::RuntimeError{basic::ErrDivByZero{"0"}}.Format());
+	QVERIFY(status == basic::DaemonStatus::kError);
+
+	client->Submit(4, "10 PRINT (1\n");
+	QVERIFY(receive_request(client.get(), &status).starts_with("[0]"));
+	QVERIFY(status == basic::DaemonStatus::kParseError);
+	client->Submit(5, "");
+	QVERIFY(receive_request(client.get(), &status).starts_with("[0]"));
+	QVERIFY(status == basic::DaemonStatus::kParseError);
+
+	auto stats = daemon->GetStats();
+	QCOMPARE(stats.requests, uint64_t{5});
+	QCOMPARE(stats.cache_hits, uint64_t{1});
+}
+
+void DaemonTest::testBatch() {
+	Served daemon;
+	QVERIFY(daemon);
+	auto client = basic::DaemonClient::Connect(daemon.path);
+	QVERIFY(client != nullptr);
+
+	const char *codes[] = {"10 INPUT n\n20 PRINT n\n30 LET n = n - 1\n40 IF n > 0 THEN 20\n",
+	                       "10 INPUT n\n20 PRINT n * n\n"};
+	constexpr uint64_t kCount = 200;
+	for (uint64_t id = 0; id < kCount; ++id)
+		client->Submit(id, codes[id % 2], {std::to_string(id % 5 + 1)}, uint32_t(id % 3));
+	QVERIFY(client->Flush());
+
+	// the replies of different requests interleave
+	std::map<uint64_t, basic::String> outputs;
+	std::size_t finished = 0;
+	while (finished < kCount) {
+		auto opt_reply = client->Receive();
+		QVERIFY(opt_reply.has_value());
+		QVERIFY(opt_reply->id < kCount);
+		if (opt_reply->type == basic::DaemonFrame::kOutput)
+			outputs[opt_reply->id] += opt_reply->text + "\n";
+		else {
+			QVERIFY(opt_reply->status == basic::DaemonStatus::kEnd);
+			++finished;
+		}
+	}
+	for (uint64_t id = 0; id < kCount; ++id) {
+		uint64_t n = id % 5 + 1;
+		basic::String expected;
+		if (id % 2 == 0) {
+			for (uint64_t i = n; i > 0; --i)
+				expected += std::to_string(i) + "\n";
+		} else
+			expected = std::to_string(n * n) + "\n";
+		QCOMPARE(outputs[id], expected);
+	}
+
+	// each source parsed once
+	auto stats = daemon->GetStats();
+	QCOMPARE(stats.requests, kCount);
+	QCOMPARE(stats.cache_misses, uint64_t{2});
+	QCOMPARE(stats.cache_hits, kCount - 2);
+}
+
+void DaemonTest::testDisconnect() {
+	Served daemon;
+	QVERIFY(daemon);
+	{
+		// never finishes, terminated with its connection
+		auto client = basic::DaemonClient::Connect(daemon.path);
+		QVERIFY(client != nullptr);
+		client->Submit(1, "10 LET i = 0\n20 LET i = i + 1\n30 GOTO 20\n");
+		client->Submit(2, "10 INPUT x\n");
+		QVERIFY(client->Flush());
+		std::this_thread::sleep_for(std::chrono::milliseconds{20});
+	}
+	auto client = basic::DaemonClient::Connect(daemon.path);
+	QVERIFY(client != nullptr);
+	client->Submit(1, "10 PRINT 5\n");
+	QCOMPARE(receive_request(client.get()), "5\n[10]" + basic::MsgEndOfProgram{}.Format());
+
+	QCOMPARE(daemon->GetStats().requests, uint64_t{3});
+}
+
+QTEST_MAIN(DaemonTest)
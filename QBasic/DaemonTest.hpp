@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class DaemonTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testRequest();
+	static void testBatch();
+	static void testDisconnect();
+
+public:
+	DaemonTest() = default;
+};
@@ -0,0 +1,86 @@
+#include "DebugTest.hpp"
+
+#include "basic/Machine.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+static basic::Program load(const char *code) {
+	std::istringstream sin{code};
+	return basic::Script::Load(sin).PopValue().GetProgram();
+}
+
+// resume through PRINTs, returns the message the run stopped with
+static basic::String run(basic::ExecuteResult *p_result, const basic::DebugOptions &debug) {
+	while (true) {
+		auto machine = basic::Machine::Execute(std::move(p_result->program), std::move(p_result->context), [] {},
+		                                       {.debug = debug});
+		*p_result = basic::Machine::GetResult(&machine);
+		auto error = p_result->result.PopError();
+		if (!error.Format().empty())
+			return error.Format();
+	}
+}
+
+static basic::Int read(const basic::ExecuteResult &result, const basic::String &var) {
+	return result.context->ReadVariable(var).PopValue();
+}
+
+void DebugTest::testBreakpoint() {
+	basic::ExecuteResult result{load("10 LET i = 0\n"
+	                                 "20 LET i = i + 1\n"
+	                                 "30 IF i < 3 THEN 20\n"
+	                                 "40 PRINT i\n")};
+	basic::DebugOptions debug{.breakpoints = {10, 30}};
+
+	QCOMPARE(run(&result, debug), basic::MsgBreakpoint{}.Format());
+	QCOMPARE(result.context->GetLine(), basic::LineID{10});
+	for (basic::Int i = 1; i <= 3; ++i) {
+		QCOMPARE(run(&result, debug), basic::MsgBreakpoint{}.Format());
+		QCOMPARE(result.context->GetLine(), basic::LineID{30});
+		QCOMPARE(read(result, "i"), i);
+	}
+	// removed while paused
+	debug.breakpoints.clear();
+	QCOMPARE(run(&result, debug), basic::MsgEndOfProgram{}.Format());
+	QCOMPARE(result.context->GetLineStat(40), basic::Count{1});
+}
+
+void DebugTest::testWatchpoint() {
+	basic::ExecuteResult result{load("10 LET i = 0\n"
+	                                 "20 LET x = 5\n"
+	                                 "30 LET i = i + 1\n"
+	                                 "40 LET x = i / 2 + 5\n"
+	                                 "50 IF i < 4 THEN 30\n")};
+	basic::DebugOptions debug{.watchpoints = {"x"}};
+
+	QCOMPARE(run(&result, debug), (basic::MsgWatchpoint{.var = "x", .value = 5}.Format()));
+	QCOMPARE(result.context->GetLine(), basic::LineID{30});
+	// unchanged by i = 1
+	QCOMPARE(run(&result, debug), (basic::MsgWatchpoint{.var = "x", .value = 6}.Format()));
+	QCOMPARE(read(result, "i"), basic::Int{2});
+	QCOMPARE(run(&result, debug), (basic::MsgWatchpoint{.var = "x", .value = 7}.Format()));
+	QCOMPARE(read(result, "i"), basic::Int{4});
+	QCOMPARE(run(&result, debug), basic::MsgEndOfProgram{}.Format());
+}
+
+void DebugTest::testStep() {
+	basic::ExecuteResult result{load("10 INPUT n\n"
+	                                 "20 LET n = n * 2\n"
+	                                 "30 END\n")};
+	basic::DebugOptions debug{.breakpoints = {10}};
+
+	QCOMPARE(run(&result, debug), basic::MsgBreakpoint{}.Format());
+	// the input re-runs the statement without stopping at its breakpoint again
+	debug.step = true;
+	QCOMPARE(run(&result, debug), basic::MsgRequestInput{}.Format());
+	result.context->PushInput("21");
+	QCOMPARE(run(&result, debug), basic::MsgStep{}.Format());
+	QCOMPARE(result.context->GetLine(), basic::LineID{20});
+	QCOMPARE(read(result, "n"), basic::Int{21});
+	QCOMPARE(run(&result, debug), basic::MsgStep{}.Format());
+	QCOMPARE(read(result, "n"), basic::Int{42});
+	QCOMPARE(run(&result, debug), basic::MsgEndOfProgram{}.Format());
+}
+
+QTEST_MAIN(DebugTest)
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class DebugTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testBreakpoint();
+	static void testWatchpoint();
+	static void testStep();
+
+public:
+	DebugTest() = default;
+};
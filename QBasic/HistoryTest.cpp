@@ -0,0 +1,119 @@
+#include "HistoryTest.hpp"
+
+#include "basic/Machine.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+static const char *kCode = "10 LET s = 0\n"
+                           "20 INPUT n\n"
+                           "30 LET i = 0\n"
+                           "40 LET s = s + i * n\n"
+                           "50 LET i = i + 1\n"
+                           "60 IF i < 50 THEN 40\n"
+                           "70 PRINT s\n"
+                           "80 IF s < 100000 THEN 20\n";
+static const std::vector<basic::String> kInputs = {"3", "-7", "40", "100", "2000"};
+
+static basic::Program load(const char *code) {
+	std::istringstream sin{code};
+	return basic::Script::Load(sin).PopValue().GetProgram();
+}
+
+// run to the end, giving the inputs from input_id when requested, returns the outputs
+static basic::String run(const basic::Program &program, std::unique_ptr<basic::Context> *p_context,
+                         basic::History *p_history, std::size_t input_id = 0) {
+	basic::String outputs;
+	while (true) {
+		auto machine = basic::Machine::Execute(program, std::move(*p_context), [] {}, {.p_history = p_history});
+		auto result = basic::Machine::GetResult(&machine);
+		*p_context = std::move(result.context);
+		basic::String new_outputs = (*p_context)->PopOutputs();
+		if (!new_outputs.empty())
+			outputs += new_outputs + "\n";
+		bool request_input = false, print = false;
+		result.result.PopError().Visit([&](const auto &error) {
+			using Error = std::decay_t<decltype(error)>;
+			request_input = std::is_same_v<Error, basic::MsgRequestInput>;
+			print = std::is_same_v<Error, basic::MsgPrint>;
+		});
+		if (request_input && input_id < kInputs.size())
+			(*p_context)->PushInput(kInputs[input_id++]);
+		else if (!print)
+			return outputs;
+	}
+}
+
+// state after the target step, executed from the start
+static std::unique_ptr<basic::Context> run_to(const basic::Program &program, uint64_t target_step) {
+	auto context = basic::Context::Create(program).PopValue();
+	for (const auto &input : kInputs)
+		context->PushInput(input);
+	while (context->GetStepCount() < target_step)
+		program.Step(context.get());
+	return context;
+}
+
+static basic::String format(const basic::Context &context) {
+	basic::String ret = std::to_string(context.GetLine());
+	context.ForEachVariable([&ret](const basic::String &var, basic::Int value) {
+		ret += " " + var + "=" + basic::IntToString(value);
+	});
+	return ret;
+}
+
+void HistoryTest::testRewind() {
+	auto program = load(kCode);
+	basic::History history{16, 8};
+	std::unique_ptr<basic::Context> context;
+	basic::String outputs = run(program, &context, &history);
+	uint64_t end_step = context->GetStepCount();
+	QVERIFY(end_step > 500);
+
+	// steps back, across inputs
+	for (uint64_t target_step : {end_step, end_step - 1, end_step - 150, uint64_t{120}, uint64_t{3}}) {
+		auto rewound = history.Rewind(program, *context, target_step).PopValue();
+		QVERIFY(rewound != nullptr);
+		QCOMPARE(rewound->GetStepCount(), target_step);
+		QCOMPARE(format(*rewound), format(*run_to(program, target_step)));
+		context = std::move(rewound);
+	}
+	// continuing re-records the same run, the logged inputs are given again
+	QCOMPARE(run(program, &context, &history, kInputs.size()), outputs);
+	QCOMPARE(context->GetStepCount(), end_step);
+	auto rewound = history.Rewind(program, *context, end_step - 10).PopValue();
+	QCOMPARE(format(*rewound), format(*run_to(program, end_step - 10)));
+}
+
+void HistoryTest::testLastWrite() {
+	auto program = load(kCode);
+	basic::History history{16, 8};
+	std::unique_ptr<basic::Context> context;
+	run(program, &context, &history);
+
+	auto opt_step = history.FindLastWrite(program, *context, "n");
+	QVERIFY(opt_step.has_value());
+	// before the writing statement, the program stops when the 4th input makes s large enough
+	auto rewound = history.Rewind(program, *context, opt_step.value()).PopValue();
+	QCOMPARE(rewound->GetLine(), basic::LineID{20});
+	QCOMPARE(rewound->ReadVariable("n").PopValue(), basic::Int{40});
+
+	QVERIFY(history.FindLastWrite(program, *context, "unused") == std::nullopt);
+}
+
+void HistoryTest::testBounded() {
+	auto program = load("10 LET i = 0\n"
+	                    "20 LET i = i + 1\n"
+	                    "30 IF i < 1000000 THEN 20\n");
+	basic::History history{64, 32};
+	std::unique_ptr<basic::Context> context;
+	run(program, &context, &history);
+	QVERIFY(history.GetSnapshotCount() <= 32);
+	QVERIFY(history.GetInterval() > 64);
+
+	auto rewound = history.Rewind(program, *context, context->GetStepCount() - 1).PopValue();
+	QCOMPARE(rewound->ReadVariable("i").PopValue(), basic::Int{999999});
+	QCOMPARE(rewound->GetLine(), basic::LineID{20});
+}
+
+QTEST_MAIN(HistoryTest)
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class HistoryTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testRewind();
+	static void testLastWrite();
+	static void testBounded();
+
+public:
+	HistoryTest() = default;
+};
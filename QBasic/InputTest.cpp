@@ -0,0 +1,127 @@
+#include "InputTest.hpp"
+
+#include "basic/Machine.hpp"
+#include "basic/Script.hpp"
+
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+
+// INPUT parsing by tokens, as before Token::ParseInput
+static std::optional<basic::Int> parse_by_tokens(basic::StringView input) {
+	std::vector<basic::Token> tokens = basic::Token::Tokenize(input);
+	if (tokens.empty() || tokens.size() > 2 || !tokens.back().IsDigit())
+		return std::nullopt;
+	auto value = tokens.back().ToDigit<basic::Int>();
+	if (tokens.size() == 1 || tokens[0].GetView() == "+")
+		return value;
+	if (tokens[0].GetView() == "-")
+		return basic::Int(-basic::UInt(value));
+	return std::nullopt;
+}
+
+// outputs through the PRINTs, then the message the run stopped with
+static basic::String run(const char *code, basic::InputSource *p_source, const std::vector<basic::String> &pushed) {
+	std::istringstream sin{code};
+	basic::ExecuteResult result{basic::Script::Load(sin).PopValue().GetProgram()};
+	result.context = basic::Context::Create(result.program).PopValue();
+	for (const auto &input : pushed)
+		result.context->PushInput(input);
+	basic::String ret;
+	while (true) {
+		auto machine = basic::Machine::Execute(std::move(result.program), std::move(result.context), [] {},
+		                                       {.p_input_source = p_source});
+		result = basic::Machine::GetResult(&machine);
+		basic::String outputs = result.context->PopOutputs();
+		if (!outputs.empty())
+			ret += outputs + "\n";
+		auto error = result.result.PopError();
+		if (!error.Format().empty())
+			return ret + "[" + std::to_string(result.context->GetLine()) + "]" + error.Format();
+	}
+}
+
+// the input with its value, to tell a mismatch
+static basic::String describe(const basic::String &input, const std::optional<basic::Int> &opt_value) {
+	return "\'" + input + "\' -> " + (opt_value.has_value() ? basic::IntToString(opt_value.value()) : "invalid");
+}
+
+void InputTest::testParse() {
+	for (const char *input :
+	     {"0", "42", " 42 ", "+7", "- 7", "-7", "--7", "+-7", "7-", "7 8", "- 7 8", "x", "7x", "", " ", "\t-\t3\r",
+	      "99999999999999999999999999999999999999999999", "-170141183460469231731687303715884105728", "+", "-"})
+		QCOMPARE(describe(input, basic::Token::ParseInput(input)), describe(input, parse_by_tokens(input)));
+	QVERIFY(basic::Token::ParseInput(" -  12") == basic::Int{-12});
+
+	// random strings over the characters that matter to the tokenizer
+	const char kAlphabet[] = " \t\r+-0123456789xX_";
+	std::mt19937_64 rng{1};
+	for (int i = 0; i < 200000; ++i) {
+		basic::String input(rng() % 9, ' ');
+		for (char &c : input)
+			c = kAlphabet[rng() % (sizeof(kAlphabet) - 1)];
+		QCOMPARE(describe(input, basic::Token::ParseInput(input)), describe(input, parse_by_tokens(input)));
+	}
+}
+
+void InputTest::testSource() {
+	const char *code = "10 LET s = 0\n"
+	                   "20 INPUT x\n"
+	                   "30 LET s = s + x\n"
+	                   "40 PRINT s\n"
+	                   "50 GOTO 20\n";
+	// the pushed inputs come first, the last line needs no newline
+	basic::InputSource source{"3\n-  4\n+5"};
+	QCOMPARE(run(code, &source, {"1", "2"}), "1\n3\n6\n2\n7\n[20]" + basic::MsgRequestInput{}.Format());
+
+	// the same errors as pushed inputs
+	for (const char *bad : {"", "1 2", "--3", "4x", " -"}) {
+		basic::InputSource bad_source{"1\n" + basic::String{bad} + "\n9\n"};
+		basic::String expected = run(code, nullptr, {"1", bad});
+		QCOMPARE(run(code, &bad_source, {}), expected);
+		QCOMPARE(expected, "1\n[20]" + basic::ErrInvalidInput{bad}.Format());
+	}
+}
+
+void InputTest::testFile() {
+	const char *code = "10 LET s = 0\n"
+	                   "20 LET n = 0\n"
+	                   "30 INPUT x\n"
+	                   "40 LET s = s + x\n"
+	                   "50 LET n = n + 1\n"
+	                   "60 IF n < 100000 THEN 30\n"
+	                   "70 PRINT s\n";
+	char filename[] = "/tmp/qbasic-inputs-XXXXXX";
+	int fd = mkstemp(filename);
+	QVERIFY(fd != -1);
+	basic::String contents;
+	basic::Int sum = 0;
+	for (basic::Int i = 0; i < 100000; ++i) {
+		contents += (i % 3 ? "" : "-") + basic::IntToString(i) + "\n";
+		sum += i % 3 ? i : -i;
+	}
+	QVERIFY(write(fd, contents.data(), contents.size()) == ssize_t(contents.size()));
+	close(fd);
+	auto source = basic::InputSource::Open(filename);
+	unlink(filename);
+	QVERIFY(source != nullptr);
+	QCOMPARE(run(code, source.get(), {}), basic::IntToString(sum) + "\n[70]" + basic::MsgEndOfProgram{}.Format());
+
+	// a pipe written line by line, each read returns what is there
+	int fds[2];
+	QVERIFY(pipe(fds) == 0);
+	std::thread writer{[fd = fds[1]] {
+		for (const char *line : {"20\n", "-", "5\n", "7"}) {
+			[[maybe_unused]] auto written = write(fd, line, strlen(line));
+			std::this_thread::sleep_for(std::chrono::milliseconds{5});
+		}
+		close(fd);
+	}};
+	basic::InputSource pipe_source{fds[0], true};
+	QCOMPARE(run("10 INPUT a\n20 INPUT b\n30 INPUT c\n40 PRINT a + b * c\n", &pipe_source, {}),
+	         "-15\n[40]" + basic::MsgEndOfProgram{}.Format());
+	writer.join();
+}
+
+QTEST_MAIN(InputTest)
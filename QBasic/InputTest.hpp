@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class InputTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testParse();
+	static void testSource();
+	static void testFile();
+
+public:
+	InputTest() = default;
+};
@@ -0,0 +1,116 @@
+#include "IntTest.hpp"
+
+#include "basic/Checkpoint.hpp"
+#include "basic/Machine.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+static const basic::Int kIntMax = ~basic::kIntMin;
+
+// outputs of a run through its PRINTs, followed by the message it stopped with
+static basic::String run(const basic::String &code) {
+	std::istringstream sin{code};
+	basic::ExecuteResult result{basic::Script::Load(sin).PopValue().GetProgram()};
+	basic::String ret;
+	while (true) {
+		auto machine = basic::Machine::Execute(std::move(result.program), std::move(result.context), [] {}, {});
+		result = basic::Machine::GetResult(&machine);
+		basic::String outputs = result.context->PopOutputs();
+		if (!outputs.empty())
+			ret += outputs + "\n";
+		auto error = result.result.PopError();
+		if (!error.Format().empty())
+			return ret + "|" + error.Format();
+	}
+}
+
+void IntTest::testOverflow() {
+	basic::String max_str = basic::IntToString(kIntMax), min_str = basic::IntToString(basic::kIntMin);
+	basic::String end = "|" + basic::MsgEndOfProgram{}.Format();
+
+	if (basic::kCheckedInt) {
+		QCOMPARE(run("10 LET m = " + max_str + "\n20 PRINT m\n30 PRINT m + 1\n"),
+		         max_str + "\n|" + basic::ErrOverflow{.operation_str = max_str + " + 1"}.Format());
+		QCOMPARE(run("10 LET m = 0 - " + max_str + " - 1\n20 PRINT m\n30 PRINT m - 1\n"),
+		         min_str + "\n|" + basic::ErrOverflow{.operation_str = min_str + " - 1"}.Format());
+		QCOMPARE(run("10 LET m = " + max_str + "\n20 PRINT m * 2\n"),
+		         "|" + basic::ErrOverflow{.operation_str = max_str + " * 2"}.Format());
+		// by squaring: 2^(bits/2-1) * 2^(bits/2)
+		basic::Int half = basic::Int(1) << (BASIC_INT_BITS / 2 - 1);
+		QCOMPARE(run("10 PRINT 2 ** " + std::to_string(BASIC_INT_BITS - 1) + "\n"),
+		         "|" + basic::ErrOverflow{.operation_str = basic::IntToString(half) + " * " +
+		                                                   basic::IntToString(half * 2)}
+		                   .Format());
+		basic::String exp_str = std::to_string(BASIC_INT_BITS - 2);
+		QCOMPARE(run("10 PRINT 2 ** " + exp_str + " - 1 + 2 ** " + exp_str + "\n"), max_str + "\n" + end);
+	} else {
+		// two's complement
+		QCOMPARE(run("10 LET m = " + max_str + "\n20 PRINT m\n30 PRINT m + 1\n"),
+		         max_str + "\n" + min_str + "\n" + end);
+		QCOMPARE(run("10 LET m = 0 - " + max_str + " - 1\n20 PRINT m - 1\n30 PRINT -m\n"),
+		         max_str + "\n" + min_str + "\n" + end);
+		QCOMPARE(run("10 PRINT 2 ** " + std::to_string(BASIC_INT_BITS - 1) + "\n20 PRINT 2 ** " +
+		             std::to_string(BASIC_INT_BITS) + "\n"),
+		         min_str + "\n0\n" + end);
+	}
+}
+
+void IntTest::testDivision() {
+	basic::String max_str = basic::IntToString(kIntMax), min_str = basic::IntToString(basic::kIntMin);
+	basic::String end = "|" + basic::MsgEndOfProgram{}.Format();
+
+	QCOMPARE(run("10 PRINT -7 / 2\n20 PRINT -7 MOD 3\n30 PRINT 7 MOD -3\n40 PRINT -6 MOD 3\n"),
+	         "-3\n2\n-2\n0\n" + end);
+	// MIN MOD -1 is 0 on every width, MIN / -1 overflows
+	QCOMPARE(run("10 LET m = 0 - " + max_str + " - 1\n20 PRINT m MOD -1\n30 PRINT m MOD " + max_str + "\n"),
+	         "0\n" + basic::IntToString(kIntMax - 1) + "\n" + end);
+	// near MAX, where r + l MOD r would wrap, also once the line is hot enough to be compiled
+	QCOMPARE(run("10 LET m = " + max_str + "\n"
+	             "20 LET k = 0\n"
+	             "30 LET a = (m - 1) MOD m\n"
+	             "40 LET b = -1 MOD m\n"
+	             "50 LET c = 1 MOD (0 - m)\n"
+	             "60 LET d = (m - 2) MOD (m - 1)\n"
+	             "70 LET k = k + 1\n"
+	             "80 IF k < 2000 THEN 30\n"
+	             "90 PRINT a\n100 PRINT b\n110 PRINT c\n120 PRINT d\n"),
+	         basic::IntToString(kIntMax - 1) + "\n" + basic::IntToString(kIntMax - 1) + "\n" +
+	             basic::IntToString(1 - kIntMax) + "\n" + basic::IntToString(kIntMax - 2) + "\n" + end);
+	if (basic::kCheckedInt)
+		QCOMPARE(run("10 LET m = 0 - " + max_str + " - 1\n20 PRINT m / -1\n"),
+		         "|" + basic::ErrOverflow{.operation_str = "-" + min_str}.Format());
+	else
+		QCOMPARE(run("10 LET m = 0 - " + max_str + " - 1\n20 PRINT m / -1\n"), min_str + "\n" + end);
+}
+
+void IntTest::testLiterals() {
+	// read modulo 2^bits
+	const char *wrapped_str = BASIC_INT_BITS == 32   ? "4294967301"
+	                          : BASIC_INT_BITS == 64 ? "18446744073709551621"
+	                                                 : "340282366920938463463374607431768211461";
+	QCOMPARE(run(basic::String{"10 PRINT "} + wrapped_str + "\n"), "5\n|" + basic::MsgEndOfProgram{}.Format());
+	QCOMPARE(basic::ExprNum{.value = basic::kIntMin}.Format(), "-" + basic::IntToString(kIntMax / 10) +
+	                                                               std::to_string(int(kIntMax % 10) + 1));
+}
+
+void IntTest::testCheckpoint() {
+	std::istringstream sin{"10 PRINT 1\n"};
+	auto program = basic::Script::Load(sin).PopValue().GetProgram();
+	auto context = basic::Context::Create(program).PopValue();
+	const basic::Int values[] = {basic::kIntMin, basic::kIntMin + 1, -1, 0, 1, kIntMax - 1, kIntMax};
+	for (std::size_t i = 0; i < std::size(values); ++i)
+		context->SetVariable("v" + std::to_string(i), values[i]);
+
+	std::stringstream stream;
+	basic::Checkpoint::Write(stream, program, context.get());
+	auto opt_checkpoint = basic::Checkpoint::Read(stream);
+	QVERIFY(opt_checkpoint.has_value() && opt_checkpoint->context);
+	for (std::size_t i = 0; i < std::size(values); ++i) {
+		const basic::Int *p_value = opt_checkpoint->context->FindVariable("v" + std::to_string(i));
+		QVERIFY(p_value != nullptr);
+		QCOMPARE(basic::IntToString(*p_value), basic::IntToString(values[i]));
+	}
+}
+
+QTEST_MAIN(IntTest)
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class IntTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testOverflow();
+	static void testDivision();
+	static void testLiterals();
+	static void testCheckpoint();
+
+public:
+	IntTest() = default;
+};
@@ -0,0 +1,85 @@
+#include "JitTest.hpp"
+
+#include "basic/Jit.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+// Run a script with the JIT disabled, enabled and in differential mode (aborts on divergence), outputs should be the
+// same
+static void verify_script(const char *script_str) {
+	std::istringstream sin{script_str};
+	auto script_res = basic::Script::Load(sin);
+	QVERIFY(script_res.IsOK());
+	auto script = script_res.PopValue();
+
+	const auto run = [&script](basic::JitMode mode) {
+		basic::Jit::SetMode(mode);
+		std::ostringstream sout;
+		script.Run(sout);
+		return sout.str();
+	};
+	auto interpreted = run(basic::JitMode::kDisabled);
+	QCOMPARE(run(basic::JitMode::kEnabled), interpreted);
+	QCOMPARE(run(basic::JitMode::kDifferential), interpreted);
+	basic::Jit::SetMode(basic::JitMode::kEnabled);
+}
+
+void JitTest::testArithmetic() {
+	verify_script("10 LET i = 0\n"
+	              "20 LET s = 0\n"
+	              "30 LET s = (s - i * i + i / -3 + i MOD -7 + (i - 9) MOD 5 + 3 ** (i MOD 4)) MOD 1000003\n"
+	              "40 LET i = i + 1\n"
+	              "50 IF -i > -5000 THEN 30\n"
+	              "60 IF s = s THEN 80\n"
+	              "70 PRINT i\n"
+	              "80 PRINT s\n");
+}
+
+void JitTest::testErrorExits() {
+	verify_script("10 LET k = 0\n"
+	              "20 LET k = k + 1\n"
+	              "30 LET q = k / (3000 - k)\n"
+	              "40 GOTO 20\n");
+	verify_script("10 LET k = 0\n"
+	              "20 LET k = k + 1\n"
+	              "30 IF 2 ** (3000 - k) > k MOD (5000 - k) THEN 20\n"
+	              "40 PRINT k\n");
+	verify_script("10 LET k = 0\n"
+	              "20 LET k = k + 1\n"
+	              "30 IF k < 2000 THEN 50\n"
+	              "40 LET j = k\n"
+	              "50 IF k + j > 3000 THEN 70\n"
+	              "60 GOTO 20\n"
+	              "70 PRINT j\n");
+}
+
+void JitTest::testArrays() {
+	// element reads are compiled, a write is the interpreter's
+	verify_script("10 DIM a(5000)\n"
+	              "20 LET k = 1\n"
+	              "30 LET a(k) = (a(k - 1) * 7 + a(k / 2) + k) MOD 10007\n"
+	              "40 LET k = k + 1\n"
+	              "50 IF a(k - 1) < a(k - 1) + k - 4999 THEN 70\n"
+	              "60 GOTO 30\n"
+	              "70 PRINT a(4999)\n");
+	// an index out of range exits to the interpreter, both ways
+	verify_script("10 DIM a(3000)\n"
+	              "20 LET k = 0\n"
+	              "30 LET k = k + 1\n"
+	              "40 LET s = a(k)\n"
+	              "50 GOTO 30\n");
+	verify_script("10 DIM a(3000)\n"
+	              "20 LET k = 2500\n"
+	              "30 LET k = k - 1\n"
+	              "40 LET s = a(k) + k\n"
+	              "50 GOTO 30\n");
+	// more arrays than the compiled code has slots for
+	verify_script("10 DIM a(1)\n20 DIM b(1)\n30 DIM c(1)\n40 DIM d(1)\n50 DIM e(1)\n"
+	              "60 LET k = 0\n"
+	              "70 LET k = k + a(0) + b(0) + c(0) + d(0) + e(0) + 1\n"
+	              "80 IF k < 3000 THEN 70\n"
+	              "90 PRINT k\n");
+}
+
+QTEST_MAIN(JitTest)
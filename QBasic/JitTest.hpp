@@ -0,0 +1,14 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class JitTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testArithmetic();
+	static void testErrorExits();
+	static void testArrays();
+
+public:
+	JitTest() = default;
+};
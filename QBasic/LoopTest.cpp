@@ -0,0 +1,186 @@
+#include "LoopTest.hpp"
+
+#include "basic/Checkpoint.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+static basic::String run_script(const char *script_str) {
+	std::istringstream sin{script_str};
+	auto script_res = basic::Script::Load(sin);
+	if (script_res.IsError())
+		return script_res.PopError().Format();
+	std::ostringstream sout;
+	script_res.PopValue().Run(sout);
+	return sout.str();
+}
+
+static basic::String format_parsed(const char *stmt_str) {
+	auto stmt_res = basic::Statement::Parse(basic::Token::Tokenize(stmt_str));
+	return stmt_res.IsOK() ? stmt_res.PopValue()->Format() : stmt_res.PopError().Format();
+}
+
+void LoopTest::testParse() {
+	QCOMPARE(format_parsed("FOR i = 1 TO 10"), "FOR i = 1 TO 10");
+	QCOMPARE(format_parsed("FOR  i=n*2 TO -(n) STEP  -  1"), "FOR i = n * 2 TO -n STEP -1");
+	QCOMPARE(format_parsed("NEXT  i"), "NEXT i");
+	QCOMPARE(format_parsed("FOR i 1 TO 3"),
+	         (basic::ErrMissingToken{.stmt_str = "FOR i 1 TO 3", .token_str = "="}.Format()));
+	QCOMPARE(format_parsed("FOR i = 1"),
+	         (basic::ErrMissingToken{.stmt_str = "FOR i = 1", .token_str = "TO"}.Format()));
+	QCOMPARE(format_parsed("FOR 2 = 1 TO 3"),
+	         (basic::ErrInvalidVariable{.stmt_str = "FOR 2 = 1 TO 3", .var_str = "2"}.Format()));
+	QCOMPARE(format_parsed("NEXT"), basic::ErrInvalidVariable{.stmt_str = "NEXT"}.Format());
+	QVERIFY(basic::Statement::Parse(basic::Token::Tokenize("FOR i = 1 TO 3 STEP")).IsError());
+
+	// the step is folded if it is a literal
+	const auto get_step = [](const char *stmt_str) {
+		auto stmt = basic::Statement::Parse(basic::Token::Tokenize(stmt_str)).PopValue();
+		return stmt->Visit([](const auto &stmt) -> std::optional<basic::Int> {
+			if constexpr (std::is_same_v<std::decay_t<decltype(stmt)>, basic::StmtFor>)
+				return stmt.opt_step;
+			else
+				return std::nullopt;
+		});
+	};
+	QVERIFY(get_step("FOR i = 1 TO 3") == basic::Int{1});
+	QVERIFY(get_step("FOR i = 1 TO 3 STEP -(2)") == basic::Int{-2});
+	QVERIFY(get_step("FOR i = 1 TO 3 STEP +5") == basic::Int{5});
+	QVERIFY(!get_step("FOR i = 1 TO 3 STEP n").has_value());
+	QVERIFY(!get_step("FOR i = 1 TO 3 STEP 1 + 1").has_value());
+}
+
+void LoopTest::testRun() {
+	// the same sums as a LET, IF and GOTO loop
+	QCOMPARE(run_script("10 LET s = 0\n"
+	                    "20 FOR i = 1 TO 100\n"
+	                    "30 FOR j = i TO 1 STEP -3\n"
+	                    "40 LET s = s + i * j\n"
+	                    "50 NEXT j\n"
+	                    "60 NEXT i\n"
+	                    "70 PRINT s\n"
+	                    "80 PRINT i\n"
+	                    "90 PRINT j\n"),
+	         run_script("10 LET s = 0\n"
+	                    "20 LET i = 1\n"
+	                    "30 LET j = i\n"
+	                    "40 LET s = s + i * j\n"
+	                    "50 LET j = j - 3\n"
+	                    "55 IF j > 0 THEN 40\n"
+	                    "60 LET i = i + 1\n"
+	                    "65 IF i < 101 THEN 30\n"
+	                    "70 PRINT s\n"
+	                    "80 PRINT i\n"
+	                    "90 PRINT j\n"));
+
+	// the bounds and the step are evaluated once, an empty range goes past the NEXT
+	QCOMPARE(run_script("10 LET n = 3\n"
+	                    "20 FOR i = n TO n * 2 STEP n - 1\n"
+	                    "30 LET n = n + 10\n"
+	                    "40 PRINT i\n"
+	                    "50 NEXT i\n"
+	                    "60 FOR k = 5 TO 4\n"
+	                    "70 PRINT k\n"
+	                    "80 NEXT k\n"
+	                    "90 PRINT k\n"),
+	         "3\n5\n5\n[90]" + basic::MsgEndOfProgram{}.Format() + "\n");
+
+	// jumping out of a loop and entering it again replaces its frame
+	QCOMPARE(run_script("10 FOR r = 1 TO 3\n"
+	                    "20 FOR c = 1 TO 1000\n"
+	                    "30 IF c = r THEN 60\n"
+	                    "40 NEXT c\n"
+	                    "60 PRINT r * 10 + c\n"
+	                    "70 NEXT r\n"),
+	         "11\n22\n33\n[70]" + basic::MsgEndOfProgram{}.Format() + "\n");
+
+	// the counter stops before overflowing
+	basic::String max = basic::IntToString(-(basic::kIntMin + 1)), min = "(0 - " + max + " - 1)";
+	QCOMPARE(run_script(("10 FOR i = -3 TO " + min + " STEP " + min + "\n"
+	                     "20 PRINT i\n"
+	                     "30 NEXT i\n"
+	                     "40 FOR i = " + max + " - 1 TO " + max + " STEP " + max + "\n"
+	                     "50 PRINT i\n"
+	                     "60 NEXT i\n")
+	                        .c_str()),
+	         "-3\n" + basic::IntToString(-(basic::kIntMin + 2)) + "\n[60]" + basic::MsgEndOfProgram{}.Format() + "\n");
+
+	QCOMPARE(run_script("10 NEXT i\n"), "[10]" + basic::RuntimeError{basic::ErrNextWithoutFor{"i"}}.Format() + "\n");
+	QCOMPARE(run_script("10 FOR i = 1 TO 0\n20 NEXT j\n"),
+	         "[10]" + basic::RuntimeError{basic::ErrForWithoutNext{"i"}}.Format() + "\n");
+	QCOMPARE(run_script("10 FOR i = 1 TO 2\n20 FOR j = 1 TO 2\n30 NEXT i\n40 NEXT j\n"),
+	         "[40]" + basic::RuntimeError{basic::ErrNextWithoutFor{"j"}}.Format() + "\n");
+}
+
+void LoopTest::testFormatAST() {
+	std::istringstream sin{"10 FOR i = 1 TO 3\n"
+	                       "20 FOR j = i TO 2 STEP 1\n"
+	                       "30 NEXT j\n"
+	                       "40 NEXT i\n"};
+	auto program = basic::Script::Load(sin).PopValue().GetProgram();
+	auto context = basic::Context::Create(program).PopValue();
+	while (program.Step(context.get()).IsOK())
+		;
+	QCOMPARE(program.FormatAST(context.get()), "10 FOR = [enter:1] [skip:0]\n"
+	                                           "  i [use:6]\n"
+	                                           "  1\n"
+	                                           "  TO\n"
+	                                           "  3\n"
+	                                           "20 FOR = [enter:2] [skip:1]\n"
+	                                           "  j [use:3]\n"
+	                                           "  i\n"
+	                                           "  TO\n"
+	                                           "  2\n"
+	                                           "  STEP\n"
+	                                           "  1\n"
+	                                           "30 NEXT [continue:1] [exit:2]\n"
+	                                           "  j [use:3]\n"
+	                                           "40 NEXT [continue:2] [exit:1]\n"
+	                                           "  i [use:6]\n");
+}
+
+void LoopTest::testCheckpoint() {
+	const char *code = "10 FOR i = 1 TO 3\n"
+	                   "20 FOR j = 10 TO 30 STEP 10\n"
+	                   "30 INPUT x\n"
+	                   "40 PRINT i + j + x\n"
+	                   "50 NEXT j\n"
+	                   "60 NEXT i\n";
+	std::istringstream sin{code};
+	auto program = basic::Script::Load(sin).PopValue().GetProgram();
+	auto context = basic::Context::Create(program).PopValue();
+	const auto run = [&program](basic::Context *p_context) {
+		basic::String ret;
+		while (true) {
+			auto result = program.Step(p_context);
+			if (result.IsOK())
+				continue;
+			auto error = result.PopError();
+			ret += p_context->PopOutputs();
+			if (!error.Format().empty())
+				return ret + "[" + std::to_string(p_context->GetLine()) + "]" + error.Format();
+			ret += "\n";
+		}
+	};
+	context->PushInput("0");
+	context->PushInput("100");
+	QCOMPARE(run(context.get()), "11\n121\n[30]" + basic::MsgRequestInput{}.Format());
+	QCOMPARE(context->GetLoops().size(), std::size_t{2});
+
+	// the loops go on from the restored frames
+	basic::String checkpoint;
+	basic::Checkpoint::Write(basic::StringWriter{&checkpoint}, program, context.get());
+	auto opt_restored = basic::Checkpoint::Read(basic::StringReader{checkpoint});
+	QVERIFY(opt_restored.has_value());
+	for (int i = 0; i < 7; ++i) {
+		context->PushInput("1000");
+		opt_restored->context->PushInput("1000");
+	}
+	basic::String expected = run(context.get());
+	QCOMPARE(expected, "1031\n1012\n1022\n1032\n1013\n1023\n1033\n[60]" + basic::MsgEndOfProgram{}.Format());
+	program = opt_restored->program;
+	QCOMPARE(run(opt_restored->context.get()), expected);
+	QVERIFY(opt_restored->context->GetLoops().empty());
+}
+
+QTEST_MAIN(LoopTest)
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class LoopTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testParse();
+	static void testRun();
+	static void testFormatAST();
+	static void testCheckpoint();
+
+public:
+	LoopTest() = default;
+};
@@ -1,14 +1,15 @@
 #include "MainWindow.h"
 #include "ui_mainwindow.h"
 
-#include <fstream>
+#include "basic/Checkpoint.hpp"
+#include "basic/Worker.hpp"
 
+#include <QDockWidget>
 #include <QFileDialog>
 #include <QMessageBox>
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), m_ui(new Ui::MainWindow) {
 	m_ui->setupUi(this);
-	m_program = basic::Program::Create();
 
 	QFont font_display{"Source Code Pro", 13};
 	m_ui->treeDisplay->setFont(font_display);
@@ -17,36 +18,100 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), m_ui(new Ui::Main
 	QFont font_input{"Source Code Pro", 16};
 	m_ui->cmdEdit->setFont(font_input);
 
+	auto profile_dock = new QDockWidget(u8"热点行 (PROFILE)", this);
+	m_profile_display = new QTextBrowser(profile_dock);
+	m_profile_display->setFont(font_display);
+	profile_dock->setWidget(m_profile_display);
+	addDockWidget(Qt::RightDockWidgetArea, profile_dock);
+
 	connect(this, &MainWindow::machineReady, this, &MainWindow::on_machineReady);
+	connect(&m_profile_timer, &QTimer::timeout, this, &MainWindow::update_profile_view);
+	m_profile_timer.start(500);
 }
 
 MainWindow::~MainWindow() { delete m_ui; }
 
 bool MainWindow::is_running() const { return m_machine || m_context; }
+bool MainWindow::is_paused() const { return !m_machine && m_context; }
 
 void MainWindow::start_machine() {
-	m_machine = basic::Machine::Execute(std::move(m_program), std::move(m_context), [this]() { emit machineReady(); });
+	m_machine = basic::Machine::Execute(
+	    m_run_program, std::move(m_context), [this]() { emit machineReady(); },
+	    {.p_tracer = m_tracer.get(), .p_probe = m_profiler.GetProbe(), .p_meter = &m_meter, .debug = m_debug,
+	     .p_history = &m_history, .p_input_source = m_input_source.get(), .isolated = m_isolated});
 }
 
-void MainWindow::update_code_view() {
-	if (!m_program)
+bool MainWindow::step_back(std::optional<basic::String> opt_var) {
+	if (!is_paused()) {
+		show_status("Program is not paused");
+		return false;
+	}
+	// to the previous statement, or to the last one writing the variable
+	uint64_t target_step = m_context->GetStepCount() - 1;
+	if (opt_var.has_value()) {
+		auto opt_step = m_history.FindLastWrite(m_run_program, *m_context, opt_var.value());
+		if (!opt_step.has_value()) {
+			show_status("No write to \'" + opt_var.value() + "\' recorded");
+			return false;
+		}
+		target_step = opt_step.value();
+	}
+	auto rewind_res = m_history.Rewind(m_run_program, *m_context, target_step);
+	if (rewind_res.IsError()) {
+		show_status(rewind_res.PopError().Format());
+		return false;
+	}
+	auto context = rewind_res.PopValue();
+	if (context == nullptr) {
+		show_status("Cannot step back before the start");
+		return false;
+	}
+	m_context = std::move(context);
+	print_message("[" + std::to_string(m_context->GetLine()) + "] Stepped back");
+	return true;
+}
+
+void MainWindow::start_trace() {
+	if (m_trace_filename.empty())
+		return;
+	m_trace_file.open(m_trace_filename, std::ios::binary | std::ios::trunc);
+	if (!m_trace_file.is_open()) {
+		show_status("Unable to write trace \'" + m_trace_filename + "\'");
 		return;
-	m_ui->codeDisplay->setText(QString::fromStdString(m_program->Format()));
+	}
+	m_tracer = std::make_unique<basic::TraceWriter>(m_trace_file, m_run_program, nullptr);
+}
+void MainWindow::stop_trace() {
+	m_tracer = nullptr;
+	m_trace_file.close();
 }
+
+void MainWindow::update_code_view() { m_ui->codeDisplay->setText(QString::fromStdString(m_program.Format())); }
 void MainWindow::update_tree_view() {
-	if (!m_program)
+	m_ui->treeDisplay->setText(QString::fromStdString(m_program.FormatAST(m_context.get())));
+}
+void MainWindow::update_profile_view() {
+	if (!m_machine)
 		return;
-	m_ui->treeDisplay->setText(QString::fromStdString(m_program->FormatAST(m_context.get())));
+	auto reading = m_meter.Read();
+	basic::String text = std::to_string(reading.statements) + " statements, " +
+	                     std::to_string(reading.expression_nodes) + " nodes, " +
+	                     std::to_string(reading.peak_variables) + " variables, " +
+	                     std::to_string(reading.output_bytes) + " output bytes, " +
+	                     std::to_string(reading.cpu_time.count() / 1000) + " ms CPU\n\n";
+	auto report = m_profiler.Report(m_run_program);
+	for (const auto &line : report.lines) {
+		char percent[16];
+		snprintf(percent, sizeof(percent), "%5.1f%% ", 100.0 * line.samples / report.total_samples);
+		text += percent + std::to_string(line.line) + " " + line.statement_str + "\n";
+	}
+	m_profile_display->setText(QString::fromStdString(text));
 }
 void MainWindow::update_ui() {
 	if (is_running()) {
 		// running
-		m_ui->btnClear->setDisabled(true);
-
 		m_ui->btnRun->setText(u8"终止执行 (TERM)");
 	} else {
-		m_ui->btnClear->setDisabled(false);
-
 		m_ui->btnRun->setText(u8"执行代码 (RUN)");
 	}
 }
@@ -56,23 +121,34 @@ bool MainWindow::run_command(const basic::String &cmd) {
 		return false;
 
 	if (tokens[0].IsDigit()) {
-		// Insert or erase statement
-		if (is_running()) {
-			show_status("Cannot modify program when running");
-			return false;
-		}
+		// Insert or erase statement, a running program keeps its own snapshot
 		auto line = tokens[0].ToDigit<basic::LineID>();
+		basic::Program base = m_program;
 		if (tokens.size() == 1) {
-			m_program->EraseStatement(line);
+			m_program.EraseStatement(line);
 		} else {
 			auto stmt_res = basic::Statement::Parse({tokens.begin() + 1, tokens.end()});
 			if (stmt_res.IsOK()) {
-				m_program->InsertStatement(line, stmt_res.PopValue());
+				m_program.InsertStatement(line, stmt_res.PopValue());
 			} else {
 				show_status(stmt_res.PopError().Format());
 				return false;
 			}
 		}
+		// a paused program continues with the edit, e.g. the answer to its INPUT runs the new code
+		if (is_paused() && !m_program.IsSameAs(base)) {
+			if (!m_run_program.SwapEdits(m_program, base, m_context->GetLine())) {
+				show_status("Line " + std::to_string(m_context->GetLine()) +
+				            " is where the program is paused, the edit is for the next RUN");
+			} else {
+				// the recorded history and trace replay the code before the edit
+				m_history.Reset();
+				if (m_tracer) {
+					stop_trace();
+					print_message("Tracing stopped, the running program was edited");
+				}
+			}
+		}
 	} else if (tokens[0].GetView() == "?") {
 		// Request input and resume program
 		if (!is_running()) {
@@ -86,14 +162,38 @@ bool MainWindow::run_command(const basic::String &cmd) {
 			m_context->PushInput(input);
 			start_machine();
 		}
+	} else if (tokens.size() == 2 && tokens[0].GetView() == "BREAK") {
+		// toggle a breakpoint
+		if (!tokens[1].IsDigit()) {
+			show_status("Invalid line '" + tokens[1].GetString() + "'");
+			return false;
+		}
+		auto line = tokens[1].ToDigit<basic::LineID>();
+		if (m_debug.breakpoints.erase(line) == 0)
+			m_debug.breakpoints.insert(line);
+		print_message((m_debug.breakpoints.count(line) ? "Breakpoint set at " : "Breakpoint removed at ") +
+		              std::to_string(line));
+	} else if (tokens.size() == 2 && tokens[0].GetView() == "BACK") {
+		if (!tokens[1].IsVariable()) {
+			show_status("Invalid variable \'" + tokens[1].GetString() + "\'");
+			return false;
+		}
+		if (!step_back(tokens[1].GetString()))
+			return false;
+	} else if (tokens.size() == 2 && tokens[0].GetView() == "WATCH") {
+		// toggle a watchpoint
+		if (!tokens[1].IsVariable()) {
+			show_status("Invalid variable '" + tokens[1].GetString() + "'");
+			return false;
+		}
+		auto var = tokens[1].GetString();
+		if (m_debug.watchpoints.erase(var) == 0)
+			m_debug.watchpoints.insert(var);
+		print_message((m_debug.watchpoints.count(var) ? "Watching '" : "Stopped watching '") + var + "'");
 	} else if (tokens.size() == 1) {
 		auto view = tokens[0].GetView();
 		if (view == "CLEAR") {
-			if (is_running()) {
-				show_status("Cannot modify program when running");
-				return false;
-			}
-			m_program->Clear();
+			m_program.Clear();
 			m_ui->outputDisplay->clear();
 		} else if (view == "RUN") {
 			if (is_running()) {
@@ -102,7 +202,41 @@ bool MainWindow::run_command(const basic::String &cmd) {
 			}
 			m_ui->outputDisplay->clear();
 			m_context = nullptr;
+			m_run_program = m_program;
+			stop_trace();
+			start_trace();
+			m_profiler.Reset();
+			m_meter.Reset();
+			m_debug.step = false;
+			m_history.Reset();
+			m_input_source = m_inputs_filename.empty() ? nullptr : basic::InputSource::Open(m_inputs_filename);
+			if (!m_inputs_filename.empty() && m_input_source == nullptr)
+				print_message("Unable to read inputs from \'" + m_inputs_filename + "\'");
 			start_machine();
+		} else if (view == "STEP" || view == "CONT") {
+			if (!is_paused()) {
+				show_status("Program is not paused");
+				return false;
+			}
+			m_debug.step = view == "STEP";
+			start_machine();
+		} else if (view == "BACK") {
+			if (!step_back(std::nullopt))
+				return false;
+		} else if (view == "INSPECT") {
+			if (!is_paused()) {
+				show_status("Program is not paused");
+				return false;
+			}
+			basic::String text = "[" + std::to_string(m_context->GetLine()) + "]";
+			m_context->ForEachVariable([&text](const basic::String &var, basic::Int value) {
+				text += " " + var + " = " + basic::IntToString(value);
+			});
+			// arrays by their sizes, the elements are too many to list
+			m_context->ForEachArray([&text](const basic::String &var, const std::vector<basic::Int> &array) {
+				text += " " + var + "(" + std::to_string(array.size()) + ")";
+			});
+			print_message(text);
 		} else if (view == "TERM") {
 			if (!is_running()) {
 				show_status("Program is already stopped");
@@ -135,6 +269,109 @@ bool MainWindow::run_command(const basic::String &cmd) {
 				show_status("Unable to load \'" + filename.toStdString() + "\'");
 				return false;
 			}
+		} else if (view == "SAVE") {
+			if (m_machine) {
+				show_status("Cannot save session when running");
+				return false;
+			}
+			auto filename =
+			    QFileDialog::getSaveFileName(this, tr("Save QBASIC Session"), "", tr("QBASIC Session (*.qbsession)"));
+			if (filename.isEmpty()) {
+				show_status("No file to save");
+				return false;
+			}
+
+			std::ofstream fout{QDir::toNativeSeparators(filename).toStdString(), std::ios::binary};
+			if (!fout.is_open()) {
+				show_status("Unable to save \'" + filename.toStdString() + "\'");
+				return false;
+			}
+			// a paused session is saved with its context, otherwise only the program
+			if (m_context)
+				basic::Checkpoint::Write(fout, m_run_program, m_context.get());
+			else
+				basic::Checkpoint::Write(fout, m_program, nullptr);
+		} else if (view == "RESUME") {
+			if (is_running()) {
+				show_status("Program is already running");
+				return false;
+			}
+			auto filename =
+			    QFileDialog::getOpenFileName(this, tr("Resume QBASIC Session"), "", tr("QBASIC Session (*.qbsession)"));
+			if (filename.isEmpty()) {
+				show_status("No file to resume");
+				return false;
+			}
+
+			std::ifstream fin{QDir::toNativeSeparators(filename).toStdString(), std::ios::binary};
+			auto opt_checkpoint = basic::Checkpoint::Read(fin);
+			if (!opt_checkpoint.has_value()) {
+				show_status("Invalid session \'" + filename.toStdString() + "\'");
+				return false;
+			}
+			m_ui->outputDisplay->clear();
+			m_program = m_run_program = std::move(opt_checkpoint->program);
+			m_context = std::move(opt_checkpoint->context);
+			m_history.Reset();
+			if (m_context) {
+				// resume if inputs are already there, otherwise wait for input
+				if (m_context->HaveInput())
+					start_machine();
+				else
+					print_message("[" + std::to_string(m_context->GetLine()) + "]" + basic::MsgRequestInput{}.Format());
+			}
+		} else if (view == "TRACE") {
+			// toggle tracing of the next runs
+			if (!m_trace_filename.empty()) {
+				m_trace_filename.clear();
+				print_message("Tracing disabled");
+			} else {
+				auto filename = QFileDialog::getSaveFileName(this, tr("Trace QBASIC Runs"), "",
+				                                             tr("QBASIC Trace (*.qbtrace)"));
+				if (filename.isEmpty()) {
+					show_status("No file to trace");
+					return false;
+				}
+				m_trace_filename = QDir::toNativeSeparators(filename).toStdString();
+				print_message("Tracing next runs to \'" + m_trace_filename + "\'");
+			}
+		} else if (view == "INPUTS") {
+			// toggle reading the inputs of the next runs from a file
+			if (!m_inputs_filename.empty()) {
+				m_inputs_filename.clear();
+				print_message("Reading inputs from the input box");
+			} else {
+				auto filename = QFileDialog::getOpenFileName(this, tr("Read QBASIC Inputs"), "",
+				                                             tr("Inputs, one per line (*.txt);;All Files (*)"));
+				if (filename.isEmpty()) {
+					show_status("No file to read");
+					return false;
+				}
+				m_inputs_filename = QDir::toNativeSeparators(filename).toStdString();
+				print_message("Reading inputs of next runs from \'" + m_inputs_filename + "\'");
+			}
+		} else if (view == "PROFILE") {
+			// export the last run's samples as folded stacks for flame graph tools
+			auto filename = QFileDialog::getSaveFileName(this, tr("Save QBASIC Profile"), "",
+			                                             tr("Folded Stacks (*.folded)"));
+			if (filename.isEmpty()) {
+				show_status("No file to save");
+				return false;
+			}
+			std::ofstream fout{QDir::toNativeSeparators(filename).toStdString()};
+			if (!fout.is_open()) {
+				show_status("Unable to save \'" + filename.toStdString() + "\'");
+				return false;
+			}
+			fout << m_profiler.Report(m_run_program).folded_stacks;
+		} else if (view == "ISOLATE") {
+			// toggle running the next runs in worker processes
+			if (!basic::WorkerPool::IsStarted()) {
+				show_status("Worker processes are not available");
+				return false;
+			}
+			m_isolated = !m_isolated;
+			print_message(m_isolated ? "Running in worker processes" : "Running in the window process");
 		} else if (view == "HELP") {
 			QMessageBox::information(this, tr("QBASIC Help"), tr("A minimal BASIC interpreter made by AdamYuan."));
 		} else {
@@ -166,7 +403,7 @@ void MainWindow::on_machineReady() {
 
 	basic::ExecuteResult result = basic::Machine::GetResult(&m_machine);
 
-	m_program = std::move(result.program);
+	m_run_program = std::move(result.program);
 	m_context = std::move(result.context);
 
 	update_code_view();
@@ -192,14 +429,25 @@ void MainWindow::on_machineReady() {
 					print_message("[" + std::to_string(m_context->GetLine()) + "]" + error.Format());
 				}
 			} else if constexpr (std::is_same_v<Error, basic::MsgPrint>) {
-				// resume
-				start_machine();
+				// resume, a step ends at its output
+				if (m_debug.step)
+					print_message("[" + std::to_string(m_context->GetLine()) + "]" + basic::MsgStep{}.Format());
+				else
+					start_machine();
+			} else if constexpr (std::is_same_v<Error, basic::MsgBreakpoint> ||
+			                     std::is_same_v<Error, basic::MsgWatchpoint> || std::is_same_v<Error, basic::MsgStep> ||
+			                     std::is_same_v<Error, basic::ErrWorkerLost>) {
+				// paused, wait for STEP, CONT or TERM (a lost worker leaves the context as before its run)
+				print_message("[" + std::to_string(m_context->GetLine()) + "]" + error.Format());
 			} else {
 				print_message("[" + std::to_string(m_context->GetLine()) + "]" + error.Format());
 				m_context = nullptr;
+				stop_trace();
 			}
-		} else
+		} else {
 			print_message(error.Format());
+			stop_trace();
+		}
 	});
 
 	update_ui();
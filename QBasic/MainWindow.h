@@ -4,6 +4,12 @@
 #include <QMainWindow>
 
 #include "basic/Machine.hpp"
+#include "basic/Profiler.hpp"
+#include "basic/Trace.hpp"
+
+#include <QTextBrowser>
+#include <QTimer>
+#include <fstream>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -33,20 +39,47 @@ signals:
 private:
 	Ui::MainWindow *m_ui;
 
+	// traces the runs started by RUN when m_trace_filename is set, destroyed after the machine using it
+	basic::String m_trace_filename;
+	std::ofstream m_trace_file;
+	std::unique_ptr<basic::TraceWriter> m_tracer;
+
+	// samples the runs for the hot lines panel, with the counters of the run on top
+	basic::Profiler m_profiler;
+	basic::Meter m_meter;
+	QTextBrowser *m_profile_display;
+	QTimer m_profile_timer;
+
+	// breakpoints and watchpoints apply from the next start, step is set while single-stepping
+	basic::DebugOptions m_debug;
+	// the run so far, to step back
+	basic::History m_history;
+	// run in a worker process (WorkerPool), a crashing run doesn't take the window down
+	bool m_isolated{};
+	// inputs of the runs started by RUN are read from m_inputs_filename when set, after the typed ones
+	basic::String m_inputs_filename;
+	std::unique_ptr<basic::InputSource> m_input_source;
+
 	std::unique_ptr<basic::Context> m_context;
-	std::unique_ptr<basic::Program> m_program;
+	// m_program is the edited version, m_run_program is the snapshot being executed
+	basic::Program m_program, m_run_program;
 	std::unique_ptr<basic::Machine> m_machine;
 
 	bool run_command(const basic::String &cmd);
 
 	void start_machine();
+	bool step_back(std::optional<basic::String> opt_var);
 	bool is_running() const;
+	bool is_paused() const;
+	void start_trace();
+	void stop_trace();
 
 	void print_message(const basic::String &msg);
 	void show_status(const basic::String &status);
 	void update_ui();
 	void update_code_view();
 	void update_tree_view();
+	void update_profile_view();
 };
 
 #endif // MAINWINDOW_H
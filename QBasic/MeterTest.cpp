@@ -0,0 +1,92 @@
+#include "MeterTest.hpp"
+
+#include "basic/Machine.hpp"
+#include "basic/Meter.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+static basic::ExecuteResult run(const char *code, basic::Meter *p_meter) {
+	std::istringstream sin{code};
+	auto script = basic::Script::Load(sin).PopValue();
+	auto machine = basic::Machine::Execute(script.GetProgram(), nullptr, [] {}, {.p_meter = p_meter});
+	auto result = basic::Machine::GetResult(&machine);
+	// resume after each PRINT
+	while (true) {
+		auto error = result.result.PopError();
+		if (!error.Format().empty()) {
+			result.result = std::move(error);
+			return result;
+		}
+		machine = basic::Machine::Execute(std::move(result.program), std::move(result.context), [] {},
+		                                  {.p_meter = p_meter});
+		result = basic::Machine::GetResult(&machine);
+	}
+}
+
+void MeterTest::testCounters() {
+	basic::Meter meter;
+	auto result = run("10 LET i = 0\n"
+	                  "20 LET i = i + 1\n"
+	                  "30 LET x = i * 2\n"
+	                  "40 IF i < 100 THEN 20\n"
+	                  "50 PRINT x + 1\n"
+	                  "60 PRINT -x\n",
+	                  &meter);
+	auto reading = meter.Read();
+	QCOMPARE(reading.statements, uint64_t{1 + 100 * 3 + 2});
+	QCOMPARE(reading.expression_nodes, uint64_t{1 + 100 * (3 + 3 + 2) + 3 + 2});
+	QCOMPARE(reading.peak_variables, uint64_t{2});
+	QCOMPARE(reading.output_bytes, uint64_t{std::string{"201\n-200\n"}.size()});
+	QVERIFY(reading.wall_time.count() >= 0 && reading.cpu_time.count() >= 0);
+}
+
+// runs until the quota stops it, returns the error message
+static basic::String run_exceeding(const char *code, basic::Meter *p_meter) {
+	auto error = run(code, p_meter).result.PopError();
+	bool exceeded = false;
+	error.Visit([&exceeded](const auto &error) {
+		exceeded = std::is_same_v<std::decay_t<decltype(error)>, basic::ErrQuotaExceeded>;
+	});
+	return exceeded ? error.Format() : "";
+}
+
+void MeterTest::testQuotas() {
+	const char *loop = "10 LET i = 0\n"
+	                   "20 LET i = i + 1\n"
+	                   "30 GOTO 20\n";
+
+	basic::Meter meter{{.statements = 1001}};
+	QVERIFY(run_exceeding(loop, &meter).find("1001 statements") != std::string::npos);
+	QCOMPARE(meter.Read().statements, uint64_t{1001});
+
+	meter.SetQuota({.expression_nodes = 300});
+	meter.Reset();
+	QVERIFY(run_exceeding(loop, &meter).find("300 expression nodes") != std::string::npos);
+	QVERIFY(meter.Read().expression_nodes <= 300);
+
+	meter.SetQuota({.cpu_time = std::chrono::milliseconds{20}});
+	meter.Reset();
+	QVERIFY(run_exceeding(loop, &meter).find("us of CPU time") != std::string::npos);
+	QVERIFY(meter.Read().cpu_time >= std::chrono::milliseconds{20});
+
+	meter.SetQuota({.variables = 2});
+	meter.Reset();
+	QVERIFY(run_exceeding("10 LET a = 1\n"
+	                      "20 LET b = 2\n"
+	                      "30 LET c = 3\n"
+	                      "40 LET d = 4\n",
+	                      &meter)
+	            .find("2 variables") != std::string::npos);
+	QCOMPARE(meter.Read().peak_variables, uint64_t{3});
+
+	meter.SetQuota({.output_bytes = 100});
+	meter.Reset();
+	QVERIFY(run_exceeding("10 PRINT 12345\n"
+	                      "20 GOTO 10\n",
+	                      &meter)
+	            .find("100 output bytes") != std::string::npos);
+	QVERIFY(meter.Read().output_bytes > 100);
+}
+
+QTEST_MAIN(MeterTest)
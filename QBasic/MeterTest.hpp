@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class MeterTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testCounters();
+	static void testQuotas();
+
+public:
+	MeterTest() = default;
+};
@@ -0,0 +1,147 @@
+#include "PersistentMapTest.hpp"
+
+#include "basic/Config.hpp"
+#include "basic/PersistentMap.hpp"
+
+#include <climits>
+#include <map>
+#include <random>
+
+using Map = basic::PersistentMap<int, basic::String>;
+
+// "key=value " for each entry, in the order ForEach visits them
+static basic::String describe(const Map &map) {
+	basic::String ret;
+	map.ForEach([&ret](const Map::Entry &entry) { ret += std::to_string(entry.first) + "=" + entry.second + " "; });
+	return ret;
+}
+static basic::String describe(const std::map<int, basic::String> &map) {
+	basic::String ret;
+	for (const auto &[key, value] : map)
+		ret += std::to_string(key) + "=" + value + " ";
+	return ret;
+}
+
+void PersistentMapTest::testEdit() {
+	Map map;
+	QVERIFY(map.Empty());
+	QVERIFY(map.Find(1) == nullptr);
+	QVERIFY(map.First() == nullptr);
+
+	map.Insert(2, "b");
+	map.Insert(1, "a");
+	map.Insert(3, "c");
+	QCOMPARE(map.Size(), std::size_t{3});
+	QCOMPARE(map.Find(2)->second, basic::String{"b"});
+
+	// overwriting keeps the size
+	map.Insert(2, "x");
+	map[3] += "y";
+	QCOMPARE(map.Size(), std::size_t{3});
+	QCOMPARE(describe(map), basic::String{"1=a 2=x 3=cy "});
+
+	// default-inserted by operator[]
+	QCOMPARE(map[4], basic::String{});
+	QCOMPARE(map.Size(), std::size_t{4});
+
+	map.Erase(2);
+	map.Erase(5);
+	QCOMPARE(map.Size(), std::size_t{3});
+	QVERIFY(map.Find(2) == nullptr);
+	QCOMPARE(describe(map), basic::String{"1=a 3=cy 4= "});
+	map.Erase(1);
+	map.Erase(3);
+	map.Erase(4);
+	QVERIFY(map.Empty());
+	QCOMPARE(map.Size(), std::size_t{0});
+}
+
+void PersistentMapTest::testSharing() {
+	Map original;
+	for (int key = 0; key < 100; ++key)
+		original.Insert(key, std::to_string(key));
+	const auto *p_entry = original.Find(50);
+
+	// a copy shares everything until edited, the edits never show in the original
+	Map copy = original;
+	QVERIFY(copy.IsSameAs(original));
+	QCOMPARE(copy.Find(50), p_entry);
+	copy.Insert(50, "x");
+	copy.Insert(100, "y");
+	copy.Erase(0);
+	QVERIFY(!copy.IsSameAs(original));
+	QCOMPARE(original.Size(), std::size_t{100});
+	QCOMPARE(original.Find(50), p_entry);
+	QCOMPARE(p_entry->second, basic::String{"50"});
+	QVERIFY(original.Find(100) == nullptr);
+	QVERIFY(original.Find(0) != nullptr);
+	QCOMPARE(copy.Find(50)->second, basic::String{"x"});
+
+	// only the nodes on the edited paths were copied
+	int shared = 0;
+	for (int key = 1; key < 100; ++key)
+		shared += copy.Find(key) == original.Find(key);
+	QVERIFY(shared >= 50);
+
+	// nor do the original's edits show in the copy
+	original.Clear();
+	QVERIFY(original.Empty());
+	QCOMPARE(copy.Size(), std::size_t{100});
+	QCOMPARE(copy.Find(99)->second, basic::String{"99"});
+}
+
+void PersistentMapTest::testOrder() {
+	// random edits of versions copied from each other, against a std::map
+	std::mt19937 rng{1};
+	std::vector<Map> versions(1);
+	std::vector<std::map<int, basic::String>> references(1);
+	for (int i = 0; i < 500; ++i) {
+		std::size_t from = rng() % versions.size();
+		auto version = versions[from];
+		auto reference = references[from];
+		for (int edits = int(rng() % 16); edits--;) {
+			int key = int(rng() % 200) - 100;
+			if (rng() % 3 == 0) {
+				version.Erase(key);
+				reference.erase(key);
+			} else {
+				basic::String value = std::to_string(rng() % 10);
+				version.Insert(key, value);
+				reference[key] = value;
+			}
+		}
+		versions.push_back(std::move(version));
+		references.push_back(std::move(reference));
+	}
+	for (std::size_t i = 0; i < versions.size(); ++i) {
+		QCOMPARE(describe(versions[i]), describe(references[i]));
+		QCOMPARE(versions[i].Size(), references[i].size());
+		if (!references[i].empty())
+			QCOMPARE(versions[i].First()->first, references[i].begin()->first);
+	}
+}
+
+void PersistentMapTest::testUpperBound() {
+	Map map;
+	QVERIFY(map.UpperBound(0) == nullptr);
+	for (int key = 10; key <= 50; key += 10)
+		map.Insert(key, std::to_string(key));
+
+	// before the first key, between and on keys, on and after the last key
+	QCOMPARE(map.UpperBound(INT_MIN)->first, 10);
+	QCOMPARE(map.UpperBound(9)->first, 10);
+	QCOMPARE(map.UpperBound(10)->first, 20);
+	QCOMPARE(map.UpperBound(25)->first, 30);
+	QCOMPARE(map.UpperBound(49)->first, 50);
+	QVERIFY(map.UpperBound(50) == nullptr);
+	QVERIFY(map.UpperBound(INT_MAX) == nullptr);
+
+	// the ends follow edits
+	map.Erase(50);
+	QVERIFY(map.UpperBound(40) == nullptr);
+	map.Erase(10);
+	QCOMPARE(map.UpperBound(INT_MIN)->first, 20);
+	QCOMPARE(map.First()->first, 20);
+}
+
+QTEST_MAIN(PersistentMapTest)
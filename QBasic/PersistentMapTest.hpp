@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class PersistentMapTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testEdit();
+	static void testSharing();
+	static void testOrder();
+	static void testUpperBound();
+
+public:
+	PersistentMapTest() = default;
+};
@@ -0,0 +1,35 @@
+#include "ProfilerTest.hpp"
+
+#include "basic/Jit.hpp"
+#include "basic/Machine.hpp"
+#include "basic/Profiler.hpp"
+#include "basic/Script.hpp"
+
+#include <sstream>
+
+void ProfilerTest::testHotLine() {
+	// line 30 and 40 execute as often, but 30 costs far more
+	std::istringstream sin{"10 LET i = 0\n"
+	                       "20 LET i = i + 1\n"
+	                       "30 LET x = (i * i + i * 3 - i / 7 + i MOD 5) * (i + 1) - (i * i + i * 3 - i / 7) * i\n"
+	                       "40 REM\n"
+	                       "50 IF i < 200000 THEN 20\n"};
+	auto script = basic::Script::Load(sin).PopValue();
+
+	// compiled lines don't report their expressions
+	basic::Jit::SetMode(basic::JitMode::kDisabled);
+	basic::Profiler profiler{std::chrono::microseconds{100}};
+	auto machine = basic::Machine::Execute(script.GetProgram(), nullptr, [] {}, {.p_probe = profiler.GetProbe()});
+	auto result = basic::Machine::GetResult(&machine);
+	basic::Jit::SetMode(basic::JitMode::kEnabled);
+
+	auto report = profiler.Report(script.GetProgram());
+	QVERIFY(report.total_samples > 0);
+	QVERIFY(!report.lines.empty());
+	QCOMPARE(report.lines[0].line, basic::LineID{30});
+	QCOMPARE(report.lines[0].statement_str, script.GetProgram().GetStatement(30).PopValue()->Format());
+	QVERIFY(report.folded_stacks.find("30 LET x = ") != std::string::npos);
+	QVERIFY(report.folded_stacks.find(";i * i + i * 3 - i / 7 + i MOD 5;") != std::string::npos);
+}
+
+QTEST_MAIN(ProfilerTest)
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class ProfilerTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testHotLine();
+
+public:
+	ProfilerTest() = default;
+};
@@ -0,0 +1,247 @@
+#include "ProgramTest.hpp"
+
+#include "basic/Machine.hpp"
+#include "basic/Script.hpp"
+
+#include <map>
+#include <random>
+#include <sstream>
+
+static std::unique_ptr<basic::Statement> parse(const basic::String &stmt_str) {
+	return basic::Statement::Parse(basic::Token::Tokenize(stmt_str)).PopValue();
+}
+
+// "+key" for a key only in the first map, "-key" only in the second, "~key" with different values
+template <typename Map> static basic::String describe_diff(const Map &map, const Map &other) {
+	basic::String ret;
+	map.Diff(other, [&ret](int key, const int *p_value, const int *p_other_value) {
+		ret += (p_value && p_other_value ? "~" : p_value ? "+" : "-") + std::to_string(key) + " ";
+	});
+	return ret;
+}
+static basic::String describe_diff(const std::map<int, int> &map, const std::map<int, int> &other) {
+	basic::String ret;
+	for (int key = 0; key < 1000; ++key) {
+		auto it = map.find(key), other_it = other.find(key);
+		if (it != map.end() && other_it != other.end()) {
+			if (it->second != other_it->second)
+				ret += "~" + std::to_string(key) + " ";
+		} else if (it != map.end() || other_it != other.end())
+			ret += (it != map.end() ? "+" : "-") + std::to_string(key) + " ";
+	}
+	return ret;
+}
+
+// resume through PRINTs, returns the outputs followed by the message the run stopped with
+static basic::String run(basic::ExecuteResult *p_result, const basic::ExecuteOptions &options = {}) {
+	basic::String ret;
+	while (true) {
+		auto machine = basic::Machine::Execute(p_result->program, std::move(p_result->context), [] {}, options);
+		*p_result = basic::Machine::GetResult(&machine);
+		ret += p_result->context->PopOutputs();
+		auto error = p_result->result.PopError();
+		if (!error.Format().empty())
+			return ret + "|" + error.Format();
+		ret += ",";
+	}
+}
+
+void ProgramTest::testDiff() {
+	// copies edited apart, compared to a plain map
+	std::mt19937 rng{1};
+	std::vector<basic::PersistentMap<int, int>> versions(1);
+	std::vector<std::map<int, int>> references(1);
+	for (int i = 0; i < 2000; ++i) {
+		std::size_t from = rng() % versions.size();
+		auto version = versions[from];
+		auto reference = references[from];
+		for (int edits = int(rng() % 8); edits--;) {
+			int key = int(rng() % 1000);
+			if (rng() % 3 == 0) {
+				version.Erase(key);
+				reference.erase(key);
+			} else {
+				int value = int(rng() % 4);
+				version.Insert(key, value);
+				reference[key] = value;
+			}
+		}
+		std::size_t other = rng() % versions.size();
+		QCOMPARE(describe_diff(version, versions[other]), describe_diff(reference, references[other]));
+		QCOMPARE(describe_diff(versions[other], version), describe_diff(references[other], reference));
+		versions.push_back(std::move(version));
+		references.push_back(std::move(reference));
+	}
+	QCOMPARE(describe_diff(versions.back(), versions.back()), basic::String{});
+
+	// a few edits of a large copy visit a few nodes
+	basic::PersistentMap<int, int> map;
+	for (int key = 0; key < 1000000; ++key)
+		map.Insert(key, key);
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < 1000; ++i) {
+		auto edited = map;
+		edited.Insert(int(rng() % 1000000), -1);
+		edited.Erase(int(rng() % 1000000));
+		edited.Insert(1000000 + i, 0);
+		std::size_t count = 0;
+		edited.Diff(map, [&count](int, const int *, const int *) { ++count; });
+		QCOMPARE(count, std::size_t{3});
+	}
+	QVERIFY(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds{500});
+}
+
+void ProgramTest::testIndex() {
+	// random edits of FOR, NEXT and LET lines, the index against a scan of the lines
+	const char *vars[] = {"i", "j", "k"};
+	std::mt19937 rng{2};
+	basic::Program program;
+	std::vector<basic::Program> versions;
+	for (int i = 0; i < 3000; ++i) {
+		auto line = basic::LineID(rng() % 40 + 1);
+		basic::String var = vars[rng() % 3];
+		switch (rng() % 5) {
+		case 0:
+			program.EraseStatement(line);
+			break;
+		case 1:
+			program.InsertStatement(line, parse("NEXT " + var));
+			break;
+		case 2:
+			program.InsertStatement(line, parse("FOR " + var + " = 1 TO 2"));
+			break;
+		case 3:
+			program.InsertStatement(line, parse("LET " + var + " = 0"));
+			break;
+		default:
+			program.InsertStatement(line, parse("PRINT " + var));
+		}
+		if (i % 100 == 0)
+			versions.push_back(program);
+	}
+	versions.push_back(program);
+
+	for (const auto &version : versions) {
+		for (const char *var : vars) {
+			for (basic::LineID line = 0; line <= 40; ++line) {
+				basic::String expected = basic::ErrForWithoutNext{.var = var}.Format();
+				for (basic::LineID next = line + 1; next <= 40; ++next) {
+					auto stmt_res = version.GetStatement(next);
+					if (stmt_res.IsOK() && stmt_res.PopValue()->Format() == basic::String{"NEXT "} + var) {
+						expected = std::to_string(next);
+						break;
+					}
+				}
+				auto next_res = version.FindNext(line, var);
+				QCOMPARE(next_res.IsOK() ? std::to_string(next_res.PopValue()) : next_res.PopError().Format(),
+				         expected);
+			}
+		}
+
+		// traps in place of the breakpoints and of the lines writing the watched variable
+		basic::Program patched = version.Patch({3, 5}, {"j"});
+		for (basic::LineID line = 1; line <= 40; ++line) {
+			auto stmt_res = version.GetStatement(line);
+			if (stmt_res.IsError())
+				continue;
+			const basic::Statement *p_stmt = stmt_res.PopValue();
+			const basic::String *p_var = p_stmt->GetVariable();
+			bool trapped = line == 3 || line == 5 || (p_var && *p_var == "j");
+			QCOMPARE(patched.GetStatement(line).PopValue() != p_stmt, trapped);
+		}
+	}
+}
+
+void ProgramTest::testEdit() {
+	// a large program, edited and run again and again
+	basic::Program program;
+	program.InsertStatement(5, parse("LET x = 0"));
+	for (basic::LineID line = 10; line <= 1000000; line += 10)
+		program.InsertStatement(line, parse(line % 1000 ? "LET x = x + 1" : "FOR i = 1 TO 0"));
+	program.InsertStatement(1000010, parse("NEXT i"));
+	program.InsertStatement(1000020, parse("PRINT x"));
+
+	std::mt19937 rng{3};
+	basic::Program last_run = program;
+	auto begin = std::chrono::steady_clock::now();
+	for (int i = 0; i < 100; ++i) {
+		auto line = basic::LineID((rng() % 99000 + 1000) * 10 + 15);
+		program.InsertStatement(line, parse("LET y = x + " + std::to_string(i)));
+		if (i % 2)
+			program.EraseStatement(line - 5);
+
+		// a run: the patched snapshot, the steps up to the first FOR skipping to the end and the edits sent to a worker
+		basic::Program run = program.Patch({20000}, {"y"});
+		auto context = basic::Context::Create(run).PopValue();
+		basic::RuntimeResult<void> step_res;
+		while (step_res.IsOK())
+			step_res = run.Step(context.get());
+		QCOMPARE(step_res.PopError().Format(), basic::MsgEndOfProgram{}.Format());
+		QCOMPARE(context->PopOutputs(), basic::String{"99"});
+		std::size_t edits = 0;
+		program.ForEachEdit(last_run, [&edits](basic::LineID, const basic::Statement *) { ++edits; });
+		QCOMPARE(edits, std::size_t(i % 2 ? 2 : 1));
+		last_run = program;
+	}
+	// the low milliseconds for each edit and run
+	QVERIFY(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds{300});
+}
+
+void ProgramTest::testSwap() {
+	std::istringstream sin{"10 LET s = 0\n"
+	                       "20 INPUT x\n"
+	                       "30 LET s = s + x\n"
+	                       "40 PRINT s\n"
+	                       "50 GOTO 20\n"};
+	basic::Program program = basic::Script::Load(sin).PopValue().GetProgram();
+	basic::ExecuteResult result{program};
+	QCOMPARE(run(&result), "|" + basic::MsgRequestInput{}.Format());
+	result.context->PushInput("3");
+	QCOMPARE(run(&result), "3,|" + basic::MsgRequestInput{}.Format());
+
+	// the edit runs with the variables and the line of the paused context, the other lines are the same statements
+	std::vector<const basic::Statement *> statements;
+	for (basic::LineID line : {10, 20, 40, 50})
+		statements.push_back(result.program.GetStatement(line).PopValue());
+	basic::Program base = program;
+	program.InsertStatement(30, parse("LET s = s + x * 10"));
+	program.InsertStatement(35, parse("LET n = 1"));
+	QVERIFY(result.program.SwapEdits(program, base, result.context->GetLine()));
+	for (std::size_t i = 0; basic::LineID line : {10, 20, 40, 50})
+		QVERIFY(result.program.GetStatement(line).PopValue() == statements[i++]);
+	result.context->PushInput("4");
+	QCOMPARE(run(&result), "43,|" + basic::MsgRequestInput{}.Format());
+	QCOMPARE(*result.context->FindVariable("n"), basic::Int{1});
+
+	// the INPUT waited on stays an INPUT
+	for (const char *stmt_str : {"", "PRINT x", "LET x = 1"}) {
+		base = program;
+		if (*stmt_str)
+			program.InsertStatement(20, parse(stmt_str));
+		else
+			program.EraseStatement(20);
+		basic::Program before = result.program;
+		QVERIFY(!result.program.SwapEdits(program, base, 20));
+		QVERIFY(result.program.IsSameAs(before));
+		program = base;
+	}
+	base = program;
+	program.InsertStatement(20, parse("INPUT y"));
+	program.EraseStatement(35);
+	QVERIFY(result.program.SwapEdits(program, base, 20));
+	result.context->PushInput("5");
+	QCOMPARE(run(&result), "83,|" + basic::MsgRequestInput{}.Format());
+	QCOMPARE(*result.context->FindVariable("y"), basic::Int{5});
+	QCOMPARE(result.program.Format(), program.Format());
+
+	// other pauses too, the paused line may change
+	base = program;
+	program.InsertStatement(40, parse("PRINT s + 1"));
+	result.context->PushInput("6");
+	basic::ExecuteOptions options{.debug = {.breakpoints = {40}}};
+	QCOMPARE(run(&result, options), "|" + basic::MsgBreakpoint{}.Format());
+	QVERIFY(result.program.SwapEdits(program, base, 40));
+	QCOMPARE(run(&result), "124,|" + basic::MsgRequestInput{}.Format());
+}
+
+QTEST_MAIN(ProgramTest)
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class ProgramTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testDiff();
+	static void testIndex();
+	static void testEdit();
+	static void testSwap();
+
+public:
+	ProgramTest() = default;
+};
@@ -0,0 +1,224 @@
+#include "SchedulerTest.hpp"
+
+#include "basic/Scheduler.hpp"
+#include "basic/Script.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <set>
+#include <sstream>
+
+static basic::Program load(const basic::String &code) {
+	std::istringstream sin{code};
+	return basic::Script::Load(sin).PopValue().GetProgram();
+}
+
+// What the callbacks of all sessions report, in order: "NAME LINE" for each output line, "NAME ?LINE" for an input
+// request and "NAME |MESSAGE" when finished. While held, the first output blocks its worker thread.
+class Log {
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<basic::String> m_events;
+	bool m_held{};
+
+	inline void add(basic::String event) {
+		{
+			std::scoped_lock lock{m_mutex};
+			m_events.push_back(std::move(event));
+		}
+		m_condition.notify_all();
+	}
+
+public:
+	inline basic::SessionCallbacks Callbacks(const basic::String &name) {
+		return {
+		    .on_output =
+		        [this, name](const basic::String &outputs) {
+			        std::istringstream sin{outputs};
+			        for (basic::String line; std::getline(sin, line);)
+				        add(name + " " + line);
+			        std::unique_lock lock{m_mutex};
+			        m_condition.wait(lock, [this] { return !m_held; });
+		        },
+		    .on_input_request = [this, name](basic::LineID line) { add(name + " ?" + std::to_string(line)); },
+		    .on_finish =
+		        [this, name](basic::ExecuteResult result) { add(name + " |" + result.result.PopError().Format()); },
+		};
+	}
+	inline void Hold(bool held) {
+		{
+			std::scoped_lock lock{m_mutex};
+			m_held = held;
+		}
+		m_condition.notify_all();
+	}
+	inline void Add(basic::String event) { add(std::move(event)); }
+	// the index of event, after waiting for it (-1 if it didn't come)
+	inline int Wait(const basic::String &event) {
+		std::unique_lock lock{m_mutex};
+		auto it = m_events.end();
+		m_condition.wait_for(lock, std::chrono::seconds{30}, [&] {
+			it = std::find(m_events.begin(), m_events.end(), event);
+			return it != m_events.end();
+		});
+		return it == m_events.end() ? -1 : int(it - m_events.begin());
+	}
+	inline std::vector<basic::String> Get() {
+		std::scoped_lock lock{m_mutex};
+		return m_events;
+	}
+	inline void Clear() {
+		std::scoped_lock lock{m_mutex};
+		m_events.clear();
+	}
+};
+
+// the events of name from begin to end, without the name
+static std::vector<basic::String> filter(const std::vector<basic::String> &events, const basic::String &name,
+                                         int begin = 0, int end = INT_MAX) {
+	std::vector<basic::String> ret;
+	for (int i = begin; i < std::min(end, int(events.size())); ++i)
+		if (events[i].compare(0, name.size() + 1, name + " ") == 0)
+			ret.push_back(events[i].substr(name.size() + 1));
+	return ret;
+}
+
+// prints 0, then every 100th iteration up to count (forever if 0)
+static basic::Program load_loop(int count) {
+	return load("10 LET i = 0\n20 PRINT i\n30 LET i = i + 1\n40 IF i MOD 100 > 0 THEN 30\n50 PRINT i\n" +
+	            (count ? "60 IF i < " + std::to_string(count) + " THEN 30\n" : basic::String{"60 GOTO 30\n"}));
+}
+
+static const basic::String kEnded = "|" + basic::MsgEndOfProgram{}.Format();
+static const basic::String kTerminated = "|" + basic::ErrTerminate::Format();
+
+void SchedulerTest::testSlicing() {
+	// a single thread, a is held on its first PRINT until b is queued
+	Log log;
+	basic::Scheduler scheduler{1, 100};
+	log.Hold(true);
+	scheduler.Submit(load_loop(5000), nullptr, 0, log.Callbacks("a"));
+	QCOMPARE(log.Wait("a 0"), 0);
+	scheduler.Submit(load_loop(5000), nullptr, 0, log.Callbacks("b"));
+	log.Hold(false);
+	QVERIFY(log.Wait("a " + kEnded) >= 0);
+	QVERIFY(log.Wait("b " + kEnded) >= 0);
+
+	auto events = log.Get();
+	std::vector<basic::String> expected;
+	for (int i = 0; i <= 5000; i += 100)
+		expected.push_back(std::to_string(i));
+	expected.push_back(kEnded);
+	QVERIFY(filter(events, "a") == expected);
+	QVERIFY(filter(events, "b") == expected);
+	// 200 statements between PRINTs, preempted every 100 the sessions take turns
+	int switches = 0;
+	for (std::size_t i = 1; i < events.size(); ++i)
+		switches += events[i][0] != events[i - 1][0];
+	QVERIFY(switches >= 40);
+}
+
+void SchedulerTest::testPriority() {
+	// weights 4 and 1, b runs a slice for every 4 slices of a
+	Log log;
+	basic::Scheduler scheduler{1, 100};
+	log.Hold(true);
+	scheduler.Submit(load_loop(20000), nullptr, 3, log.Callbacks("a"));
+	QCOMPARE(log.Wait("a 0"), 0);
+	auto b = scheduler.Submit(load_loop(0), nullptr, 0, log.Callbacks("b"));
+	log.Hold(false);
+	int end = log.Wait("a " + kEnded);
+	QVERIFY(end >= 0);
+	scheduler.Terminate(b);
+	QVERIFY(log.Wait("b " + kTerminated) >= 0);
+
+	auto events = log.Get();
+	auto b_events = filter(events, "b", 0, end);
+	QVERIFY(!b_events.empty());
+	int b_count = std::stoi(b_events.back());
+	QVERIFY2(3000 <= b_count && b_count <= 7000, std::to_string(b_count).c_str());
+}
+
+void SchedulerTest::testInput() {
+	Log log;
+	basic::Scheduler scheduler{1, 100};
+	auto a = scheduler.Submit(load("10 INPUT n\n20 PRINT n * 2\n30 INPUT n\n40 PRINT n * 3\n"), nullptr, 0,
+	                          log.Callbacks("a"));
+	QVERIFY(log.Wait("a ?10") >= 0);
+	// the only thread isn't taken by the parked session
+	scheduler.Submit(load_loop(1000), nullptr, 0, log.Callbacks("b"));
+	QVERIFY(log.Wait("b " + kEnded) >= 0);
+	QVERIFY(filter(log.Get(), "a") == std::vector<basic::String>{"?10"});
+
+	scheduler.PushInput(a, "21");
+	QVERIFY(log.Wait("a ?30") >= 0);
+	scheduler.PushInput(a, "5");
+	QVERIFY(log.Wait("a " + kEnded) >= 0);
+	QVERIFY(filter(log.Get(), "a") == (std::vector<basic::String>{"?10", "42", "?30", "15", kEnded}));
+
+	// inputs pushed ahead are taken without requests
+	auto c = scheduler.Submit(load("10 INPUT n\n20 INPUT m\n30 PRINT n - m\n"), nullptr, 0, log.Callbacks("c"));
+	scheduler.PushInput(c, "7");
+	scheduler.PushInput(c, "2");
+	QVERIFY(log.Wait("c " + kEnded) >= 0);
+	auto c_events = filter(log.Get(), "c");
+	QVERIFY(c_events.size() >= 2);
+	QCOMPARE(c_events[c_events.size() - 2], basic::String{"5"});
+}
+
+void SchedulerTest::testTerminate() {
+	Log log;
+	basic::Scheduler scheduler{2, 100};
+	auto a = scheduler.Submit(load("10 INPUT n\n20 PRINT n\n"), nullptr, 0, log.Callbacks("a"));
+	auto b = scheduler.Submit(load_loop(0), nullptr, 0, log.Callbacks("b"));
+	QVERIFY(log.Wait("a ?10") >= 0);
+	QVERIFY(log.Wait("b 100") >= 0);
+	// parked on INPUT and running
+	scheduler.Terminate(a);
+	scheduler.Terminate(b);
+	QVERIFY(log.Wait("a " + kTerminated) >= 0);
+	QVERIFY(log.Wait("b " + kTerminated) >= 0);
+	QVERIFY(filter(log.Get(), "a") == (std::vector<basic::String>{"?10", kTerminated}));
+
+	// a finished session reports once, a later Terminate does nothing
+	auto c = scheduler.Submit(load("10 PRINT 1\n"), nullptr, 0, log.Callbacks("c"));
+	QVERIFY(log.Wait("c " + kEnded) >= 0);
+	scheduler.Terminate(c);
+	scheduler.Terminate(a);
+	QVERIFY(filter(log.Get(), "c") == (std::vector<basic::String>{"1", kEnded}));
+	QVERIFY(filter(log.Get(), "a") == (std::vector<basic::String>{"?10", kTerminated}));
+}
+
+void SchedulerTest::testLatency() {
+	// an interactive session among busy ones on a single thread
+	Log log;
+	basic::Scheduler scheduler{1, 100};
+	constexpr int kBusyCount = 8;
+	std::vector<basic::Scheduler::SessionHandle> busy;
+	for (int i = 0; i < kBusyCount; ++i)
+		busy.push_back(scheduler.Submit(load_loop(0), nullptr, 0, log.Callbacks("b" + std::to_string(i))));
+	auto a = scheduler.Submit(load("10 INPUT n\n20 PRINT n\n30 GOTO 10\n"), nullptr, 0, log.Callbacks("a"));
+
+	for (int round = 0; round < 20; ++round) {
+		QVERIFY(log.Wait("a ?10") >= 0);
+		log.Clear();
+		// once pushed, at most the slice running finishes before a, round robin would run half of the others
+		scheduler.PushInput(a, std::to_string(round));
+		log.Add("pushed");
+		int output = log.Wait("a " + std::to_string(round));
+		QVERIFY(output >= 0);
+		auto events = log.Get();
+		int pushed = int(std::find(events.begin(), events.end(), "pushed") - events.begin());
+		std::set<basic::String> ran;
+		for (int i = pushed + 1; i < output; ++i)
+			if (events[i][0] == 'b')
+				ran.insert(events[i].substr(0, events[i].find(' ')));
+		QVERIFY2(ran.size() <= 1, std::to_string(ran.size()).c_str());
+	}
+	for (const auto &session : busy)
+		scheduler.Terminate(session);
+	scheduler.Terminate(a);
+}
+
+QTEST_MAIN(SchedulerTest)
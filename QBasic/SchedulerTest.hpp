@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class SchedulerTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testSlicing();
+	static void testPriority();
+	static void testInput();
+	static void testTerminate();
+	static void testLatency();
+
+public:
+	SchedulerTest() = default;
+};
@@ -0,0 +1,100 @@
+#include "TraceTest.hpp"
+
+#include "basic/Machine.hpp"
+#include "basic/Script.hpp"
+#include "basic/Trace.hpp"
+
+#include <sstream>
+
+// Run a script with its inputs on a Machine, return the trace and write the outputs to ostr
+static std::string record_script(const basic::Script &script, std::ostream &ostr) {
+	std::ostringstream trace;
+	{
+		basic::TraceWriter tracer{trace, script.GetProgram(), nullptr};
+		std::unique_ptr<basic::Context> context;
+		for (std::size_t input_id = 0;;) {
+			auto machine =
+			    basic::Machine::Execute(script.GetProgram(), std::move(context), [] {}, {.p_tracer = &tracer});
+			auto result = basic::Machine::GetResult(&machine);
+			context = std::move(result.context);
+			basic::String outputs = context ? context->PopOutputs() : basic::String{};
+			if (!outputs.empty())
+				ostr << outputs << '\n';
+
+			auto error = result.result.PopError();
+			bool resume = false;
+			error.Visit([&](const auto &error) {
+				using Error = std::decay_t<decltype(error)>;
+				if constexpr (std::is_same_v<Error, basic::MsgRequestInput>) {
+					if ((resume = input_id < script.GetInputs().size()))
+						context->PushInput(script.GetInputs()[input_id++]);
+				} else
+					resume = std::is_same_v<Error, basic::MsgPrint>;
+			});
+			if (!resume) {
+				ostr << '[' << context->GetLine() << ']' << error.Format() << '\n';
+				break;
+			}
+		}
+	}
+	return trace.str();
+}
+
+static basic::Script load_script(const char *script_str) {
+	std::istringstream sin{script_str};
+	auto script_res = basic::Script::Load(sin);
+	return script_res.PopValue();
+}
+
+void TraceTest::testReplay() {
+	auto script = load_script("100 INPUT max\n"
+	                          "110 LET n1 = 0\n"
+	                          "120 LET n2 = 1\n"
+	                          "130 IF n1 > max THEN 180\n"
+	                          "140 PRINT n1\n"
+	                          "150 LET n3 = n1 + n2\n"
+	                          "160 LET n1 = n2\n"
+	                          "170 LET n2 = n3\n"
+	                          "175 GOTO 130\n"
+	                          "180 INPUT again\n"
+	                          "190 IF again = 1 THEN 100\n"
+	                          "? 1000\n"
+	                          "? 1\n"
+	                          "? 100000\n"
+	                          "? 1\n"
+	                          "? 10\n"
+	                          "? 2 2\n");
+	std::ostringstream recorded, replayed;
+	std::istringstream trace{record_script(script, recorded)};
+
+	auto opt_result = basic::ReplayTrace(trace, replayed);
+	QVERIFY(opt_result.has_value());
+	QVERIFY(!opt_result->divergence.has_value());
+	QVERIFY(opt_result->lines > 0);
+	QCOMPARE(replayed.str(), recorded.str());
+}
+
+void TraceTest::testDivergence() {
+	auto script = load_script("10 INPUT a\n"
+	                          "20 LET b = a * 2\n"
+	                          "30 PRINT b\n"
+	                          "? 21\n");
+	std::ostringstream recorded;
+	std::string trace_str = record_script(script, recorded);
+
+	// the input is the last string in the trace
+	auto input_pos = trace_str.rfind("21");
+	QVERIFY(input_pos != std::string::npos);
+	trace_str[input_pos] = '3';
+
+	std::ostringstream replayed;
+	std::istringstream trace{trace_str};
+	auto opt_result = basic::ReplayTrace(trace, replayed);
+	QVERIFY(opt_result.has_value());
+	QVERIFY(opt_result->divergence.has_value());
+
+	std::istringstream invalid_trace{"QBasicCkpt1.0"};
+	QVERIFY(!basic::ReplayTrace(invalid_trace, replayed).has_value());
+}
+
+QTEST_MAIN(TraceTest)
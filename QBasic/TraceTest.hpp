@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class TraceTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testReplay();
+	static void testDivergence();
+
+public:
+	TraceTest() = default;
+};
@@ -0,0 +1,145 @@
+#include "TranspilerTest.hpp"
+
+#include "basic/Script.hpp"
+#include "basic/Transpiler.hpp"
+
+#include <sstream>
+
+// Run a script with the interpreter and as compiled C++, both outputs should be the same
+static void verify_script(const char *script_str) {
+	std::istringstream sin{script_str};
+	auto script_res = basic::Script::Load(sin);
+	QVERIFY(script_res.IsOK());
+	auto script = script_res.PopValue();
+
+	std::ostringstream interpreted;
+	script.Run(interpreted);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString source_path = dir.filePath("program.cpp"), exe_path = dir.filePath("program");
+	{
+		QFile source{source_path};
+		QVERIFY(source.open(QIODevice::WriteOnly));
+		source.write(QByteArray::fromStdString(basic::Transpiler::Transpile(script.GetProgram())));
+	}
+
+	QProcess compiler;
+	compiler.start(QBASIC_CXX_COMPILER, {"-std=c++17", "-O1", source_path, "-o", exe_path});
+	QVERIFY(compiler.waitForFinished(60000));
+	QCOMPARE(compiler.exitCode(), 0);
+
+	QProcess program;
+	program.start(exe_path, {});
+	QVERIFY(program.waitForStarted());
+	for (const auto &input : script.GetInputs())
+		program.write(QByteArray::fromStdString(input + '\n'));
+	program.closeWriteChannel();
+	QVERIFY(program.waitForFinished(10000));
+
+	QCOMPARE(program.readAllStandardOutput().toStdString(), interpreted.str());
+}
+
+void TranspilerTest::testFibonacci() {
+	verify_script("100 REM Program to print the Fibonacci sequence\n"
+	              "110 INPUT max\n"
+	              "120 LET n1 = 0\n"
+	              "130 LET n2 = 1\n"
+	              "140 IF n1 > max THEN 190\n"
+	              "145 PRINT n1\n"
+	              "150 LET n3 = n1 + n2\n"
+	              "160 LET n1 = n2\n"
+	              "170 LET n2 = n3\n"
+	              "180 GOTO 140\n"
+	              "190 END\n"
+	              "? 1000000\n");
+}
+
+void TranspilerTest::testRuntimeErrors() {
+	verify_script("10 LET a = 7\n"
+	              "20 PRINT -a / 2 + a MOD -3 * 2 ** 3 ** 2\n"
+	              "30 PRINT a / (a - 7)\n");
+	verify_script("10 LET a = 7\n"
+	              "20 PRINT a MOD (a - 7)\n");
+	verify_script("10 LET a = 2\n"
+	              "20 PRINT a ** (1 - a)\n");
+	verify_script("10 LET a = 2\n"
+	              "20 PRINT b / 0\n");
+	verify_script("");
+}
+
+void TranspilerTest::testInputs() {
+	verify_script("10 INPUT a\n"
+	              "20 PRINT a\n"
+	              "30 GOTO 10\n"
+	              "? 42\n"
+	              "? -  7\n"
+	              "? +3\n");
+	verify_script("10 INPUT a\n"
+	              "20 PRINT a\n"
+	              "30 GOTO 10\n"
+	              "? 1\n"
+	              "? --5\n");
+	verify_script("10 INPUT a\n"
+	              "20 PRINT a\n"
+	              "30 GOTO 10\n"
+	              "? 12a\n");
+}
+
+void TranspilerTest::testUndefinedLines() {
+	verify_script("10 LET a = 1\n"
+	              "20 IF a = 1 THEN 40\n"
+	              "30 END\n");
+	verify_script("10 LET a = 1\n"
+	              "20 IF a < 1 THEN 40\n"
+	              "30 GOTO 5\n");
+}
+
+void TranspilerTest::testModulo() {
+	// signs of both operands, and near MAX, where r + l MOD r would wrap
+	basic::String half = "2 ** " + std::to_string(BASIC_INT_BITS - 2);
+	verify_script(("10 LET m = " + half + " - 1 + " + half + "\n"
+	               "20 PRINT -7 MOD 3\n30 PRINT 7 MOD -3\n40 PRINT -6 MOD 3\n"
+	               "50 PRINT (m - 1) MOD m\n60 PRINT -1 MOD m\n70 PRINT 1 MOD (0 - m)\n80 PRINT (m - 2) MOD (m - 1)\n")
+	                  .c_str());
+}
+
+void TranspilerTest::testLoops() {
+	verify_script("10 INPUT n\n"
+	              "20 FOR i = 1 TO n\n"
+	              "30 FOR j = i TO 1 STEP -2\n"
+	              "40 IF j = 5 THEN 70\n"
+	              "50 PRINT i * 100 + j\n"
+	              "60 NEXT j\n"
+	              "70 FOR k = n TO i STEP i - 3\n"
+	              "80 PRINT k\n"
+	              "90 NEXT k\n"
+	              "100 NEXT i\n"
+	              "110 PRINT i + j\n"
+	              "? 7\n");
+	verify_script("10 FOR i = 1 TO 2\n"
+	              "20 FOR j = 1 TO 2\n"
+	              "30 NEXT i\n"
+	              "40 NEXT j\n");
+	verify_script("10 FOR i = 2 TO 1\n"
+	              "20 NEXT j\n");
+	verify_script("10 FOR i = 2 TO 1\n"
+	              "20 NEXT i\n");
+}
+
+void TranspilerTest::testArrays() {
+	verify_script("10 INPUT n\n"
+	              "20 DIM a(n)\n"
+	              "30 FOR i = 1 TO n - 1\n"
+	              "40 LET a(i) = a(i - 1) * 3 + i\n"
+	              "50 INPUT a(a(i) MOD n)\n"
+	              "60 NEXT i\n"
+	              "70 PRINT a(n - 1) + a(0)\n"
+	              "80 PRINT a(n)\n"
+	              "? 6\n? 1\n? -2\n? 3\n? 4\n? 5\n");
+	verify_script("10 DIM a(0 - 1)\n");
+	verify_script("10 LET a(0) = 1\n");
+	verify_script("10 DIM a(2)\n20 INPUT a(-1)\n");
+}
+
+QTEST_MAIN(TranspilerTest)
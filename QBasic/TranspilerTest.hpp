@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class TranspilerTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testFibonacci();
+	static void testRuntimeErrors();
+	static void testInputs();
+	static void testUndefinedLines();
+	static void testModulo();
+	static void testLoops();
+	static void testArrays();
+
+public:
+	TranspilerTest() = default;
+};
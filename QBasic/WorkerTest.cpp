@@ -0,0 +1,155 @@
+#include "WorkerTest.hpp"
+
+#include "basic/Script.hpp"
+#include "basic/Worker.hpp"
+
+#include <csignal>
+#include <sstream>
+
+static bool start_pool() {
+	// forked on first use, as early as the test allows
+	static bool started = basic::WorkerPool::Start(2);
+	return started;
+}
+
+static basic::Program load(const char *code) {
+	std::istringstream sin{code};
+	return basic::Script::Load(sin).PopValue().GetProgram();
+}
+
+static std::unique_ptr<basic::Statement> parse(const basic::String &stmt_str) {
+	return basic::Statement::Parse(basic::Token::Tokenize(stmt_str)).PopValue();
+}
+
+// resume through PRINTs, returns the outputs followed by the message the run stopped with
+static basic::String run(basic::ExecuteResult *p_result, const basic::ExecuteOptions &options) {
+	basic::String ret;
+	while (true) {
+		auto machine = basic::Machine::Execute(std::move(p_result->program), std::move(p_result->context), [] {},
+		                                       options);
+		*p_result = basic::Machine::GetResult(&machine);
+		if (p_result->context)
+			ret += p_result->context->PopOutputs();
+		auto error = p_result->result.PopError();
+		if (!error.Format().empty())
+			return ret + "|" + error.Format();
+		ret += ",";
+	}
+}
+
+void WorkerTest::testRoundTrip() {
+	QVERIFY(start_pool());
+	const char *code = "10 INPUT n\n"
+	                   "20 LET i = 0\n"
+	                   "30 LET s = 0\n"
+	                   "40 LET i = i + 1\n"
+	                   "50 LET s = s + i * i\n"
+	                   "60 IF i < n THEN 40\n"
+	                   "70 PRINT s\n"
+	                   "80 PRINT s MOD 7\n"
+	                   "90 INPUT x\n"
+	                   "100 PRINT x / 0\n";
+	basic::String expected;
+	for (bool isolated : {false, true}) {
+		basic::ExecuteResult result{load(code)};
+		basic::String outputs = run(&result, {.isolated = isolated});
+		QCOMPARE(outputs, "|" + basic::MsgRequestInput{}.Format());
+		result.context->PushInput("1000");
+		outputs = run(&result, {.isolated = isolated});
+		result.context->PushInput("-3");
+		outputs += run(&result, {.isolated = isolated});
+		QCOMPARE(*result.context->FindVariable("s"), basic::Int{333833500});
+		QCOMPARE(*result.context->FindVariable("x"), basic::Int{-3});
+		QCOMPARE(result.context->GetLineStat(40), basic::Count{1000});
+		if (isolated)
+			QCOMPARE(outputs, expected);
+		expected = outputs;
+	}
+	QVERIFY(expected.find("333833500,") != std::string::npos);
+
+	// an input pushed while running is forwarded to the worker
+	basic::ExecuteResult result{load("10 LET i = 0\n20 LET i = i + 1\n30 IF i < 300000 THEN 20\n40 INPUT x\n")};
+	auto machine = basic::Machine::Execute(std::move(result.program), nullptr, [] {}, {.isolated = true});
+	machine->PushInput("42");
+	result = basic::Machine::GetResult(&machine);
+	QCOMPARE(result.result.PopError().Format(), basic::MsgEndOfProgram{}.Format());
+	QCOMPARE(*result.context->FindVariable("x"), basic::Int{42});
+}
+
+void WorkerTest::testBreakpoint() {
+	QVERIFY(start_pool());
+	basic::ExecuteResult result{load("10 LET i = 0\n"
+	                                 "20 LET i = i + 1\n"
+	                                 "30 IF i < 3 THEN 20\n"
+	                                 "40 PRINT i\n")};
+	basic::ExecuteOptions options{.debug = {.breakpoints = {30}}, .isolated = true};
+	for (basic::Int i = 1; i <= 3; ++i) {
+		QCOMPARE(run(&result, options), "|" + basic::MsgBreakpoint{}.Format());
+		QCOMPARE(result.context->GetLine(), basic::LineID{30});
+		QCOMPARE(*result.context->FindVariable("i"), i);
+	}
+	QCOMPARE(run(&result, options), "3|" + basic::MsgEndOfProgram{}.Format());
+}
+
+void WorkerTest::testEdit() {
+	QVERIFY(start_pool());
+	// each run sends the edits since the program a worker holds, a lost worker starts over from no lines
+	basic::Program program = load("10 LET i = 0\n"
+	                              "20 LET i = i + 1\n"
+	                              "30 IF i < 5 THEN 20\n"
+	                              "40 PRINT i\n");
+	for (int i = 0; i < 8; ++i) {
+		if (i == 4) {
+			for (int pid : basic::WorkerPool::GetPids()) {
+				if (pid > 0)
+					kill(pid, SIGKILL);
+			}
+		}
+		basic::ExecuteResult result{program};
+		QCOMPARE(run(&result, {.isolated = true}), std::to_string(5 + i) + "|" + basic::MsgEndOfProgram{}.Format());
+		program.InsertStatement(30, parse("IF i < " + std::to_string(6 + i) + " THEN 20"));
+		if (i % 2)
+			program.EraseStatement(15);
+		else
+			program.InsertStatement(15, parse("REM"));
+	}
+}
+
+void WorkerTest::testTerminate() {
+	QVERIFY(start_pool());
+	auto machine = basic::Machine::Execute(load("10 LET i = 0\n20 LET i = i + 1\n30 GOTO 20\n"), nullptr, [] {},
+	                                       {.isolated = true});
+	std::this_thread::sleep_for(std::chrono::milliseconds{50});
+	machine->Terminate();
+	auto result = basic::Machine::GetResult(&machine);
+	QCOMPARE(result.result.PopError().Format(), basic::ErrTerminate{}.Format());
+	// stopped by the worker itself, with the context it reached
+	QVERIFY(*result.context->FindVariable("i") > 0);
+}
+
+void WorkerTest::testWorkerLost() {
+	QVERIFY(start_pool());
+	basic::ExecuteResult result{load("10 LET i = 0\n20 LET i = i + 1\n30 GOTO 20\n")};
+	result.context = basic::Context::Create(result.program).PopValue();
+	result.context->SetVariable("j", 7);
+	auto machine =
+	    basic::Machine::Execute(std::move(result.program), std::move(result.context), [] {}, {.isolated = true});
+	std::this_thread::sleep_for(std::chrono::milliseconds{50});
+	for (int pid : basic::WorkerPool::GetPids()) {
+		if (pid > 0)
+			kill(pid, SIGKILL);
+	}
+	result = basic::Machine::GetResult(&machine);
+	QCOMPARE(result.result.PopError().Format(), basic::ErrWorkerLost{}.Format());
+	// as before the run
+	QCOMPARE(result.context->GetLine(), basic::LineID{10});
+	QVERIFY(result.context->FindVariable("i") == nullptr);
+	QCOMPARE(*result.context->FindVariable("j"), basic::Int{7});
+
+	// replaced
+	result.context = nullptr;
+	QCOMPARE(run(&result, {.debug = {.breakpoints = {30}}, .isolated = true}), "|" + basic::MsgBreakpoint{}.Format());
+	QCOMPARE(*result.context->FindVariable("i"), basic::Int{1});
+}
+
+QTEST_MAIN(WorkerTest)
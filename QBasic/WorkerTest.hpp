@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QtTest/QtTest>
+
+class WorkerTest : public QObject {
+	Q_OBJECT
+private slots:
+	static void testRoundTrip();
+	static void testBreakpoint();
+	static void testEdit();
+	static void testTerminate();
+	static void testWorkerLost();
+
+public:
+	WorkerTest() = default;
+};
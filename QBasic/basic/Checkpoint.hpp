@@ -0,0 +1,307 @@
+#pragma once
+
+#include "Context.hpp"
+#include "Program.hpp"
+#include "Token.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <tuple>
+
+namespace basic {
+
+// Compact binary checkpoint: unsigned integers are LEB128 varints, signed integers are zigzag encoded, strings are
+// length-prefixed. Statements are stored as source and re-parsed when read.
+template <typename> struct Serializer;
+
+// Serializer streams over a string, cheaper than string streams for the small messages
+struct StringWriter {
+	String *p_str;
+	inline void put(char c) { p_str->push_back(c); }
+	inline void write(const char *p_data, std::streamsize size) { p_str->append(p_data, size); }
+};
+struct StringReader {
+	StringView view;
+	bool ok{true};
+	inline int get() {
+		if (view.empty()) {
+			ok = false;
+			return std::char_traits<char>::eof();
+		}
+		char c = view.front();
+		view.remove_prefix(1);
+		return (unsigned char)c;
+	}
+	inline void read(char *p_data, std::streamsize size) {
+		ok = ok && std::size_t(size) <= view.size();
+		std::size_t count = std::min<std::size_t>(size, view.size());
+		memcpy(p_data, view.data(), count);
+		view.remove_prefix(count);
+	}
+	inline explicit operator bool() const { return ok; }
+};
+
+template <typename Unsigned> struct VarintSerializer {
+	template <typename Stream> inline static void Write(Stream &&ostr, Unsigned val) {
+		do {
+			char byte = char(val & 0x7fu);
+			val >>= 7u;
+			if (val)
+				byte = char(byte | 0x80u);
+			ostr.put(byte);
+		} while (val);
+	}
+	template <typename Stream> inline static Unsigned Read(Stream &&istr) {
+		Unsigned val = 0;
+		for (uint32_t shift = 0; shift < sizeof(Unsigned) * 8; shift += 7) {
+			int byte = istr.get();
+			if (byte == std::char_traits<char>::eof())
+				break;
+			val |= Unsigned(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				break;
+		}
+		return val;
+	}
+};
+
+template <> struct Serializer<uint64_t> : VarintSerializer<uint64_t> {};
+
+template <> struct Serializer<uint32_t> {
+	template <typename Stream> inline static void Write(Stream &&ostr, uint32_t val) {
+		Serializer<uint64_t>::Write(ostr, val);
+	}
+	template <typename Stream> inline static uint32_t Read(Stream &&istr) { return Serializer<uint64_t>::Read(istr); }
+};
+
+// zigzag, the encoding doesn't depend on the integer width
+template <> struct Serializer<Int> {
+	template <typename Stream> inline static void Write(Stream &&ostr, Int val) {
+		VarintSerializer<UInt>::Write(ostr, (UInt(val) << 1u) ^ UInt(val >> (BASIC_INT_BITS - 1)));
+	}
+	template <typename Stream> inline static Int Read(Stream &&istr) {
+		UInt val = VarintSerializer<UInt>::Read(istr);
+		return Int(val >> 1u) ^ -Int(val & 1u);
+	}
+};
+
+template <> struct Serializer<bool> {
+	template <typename Stream> inline static void Write(Stream &&ostr, bool val) { ostr.put(val ? 1 : 0); }
+	template <typename Stream> inline static bool Read(Stream &&istr) { return istr.get() == 1; }
+};
+
+template <> struct Serializer<String> {
+private:
+	inline static constexpr std::size_t kChunkSize = 4096;
+
+public:
+	template <typename Stream> inline static void Write(Stream &&ostr, const String &val) {
+		Serializer<uint64_t>::Write(ostr, val.size());
+		ostr.write(val.data(), (std::streamsize)val.size());
+	}
+	// in chunks, so that a corrupted size fails at the end of the input instead of being allocated
+	template <typename Stream> inline static String Read(Stream &&istr) {
+		String ret;
+		for (uint64_t size = Serializer<uint64_t>::Read(istr); size && istr;) {
+			std::size_t offset = ret.size(), count = std::min<uint64_t>(size, kChunkSize);
+			ret.resize(offset + count);
+			istr.read(ret.data() + offset, (std::streamsize)count);
+			size -= count;
+		}
+		return ret;
+	}
+};
+
+template <typename Key, typename Value> struct Serializer<PersistentMap<Key, Value>> {
+	template <typename Stream> inline static void Write(Stream &&ostr, const PersistentMap<Key, Value> &val) {
+		Serializer<uint64_t>::Write(ostr, val.Size());
+		val.ForEach([&ostr](const auto &entry) {
+			Serializer<Key>::Write(ostr, entry.first);
+			Serializer<Value>::Write(ostr, entry.second);
+		});
+	}
+	template <typename Stream> inline static PersistentMap<Key, Value> Read(Stream &&istr) {
+		PersistentMap<Key, Value> ret;
+		for (uint64_t size = Serializer<uint64_t>::Read(istr); size-- && istr;) {
+			Key key = Serializer<Key>::Read(istr);
+			ret.Insert(key, Serializer<Value>::Read(istr));
+		}
+		return ret;
+	}
+};
+
+template <> struct Serializer<Program> {
+	template <typename Stream> inline static void Write(Stream &&ostr, const Program &val) {
+		Serializer<uint64_t>::Write(ostr, val.m_statements.Size());
+		val.m_statements.ForEach([&ostr](const auto &entry) {
+			Serializer<LineID>::Write(ostr, entry.first);
+			Serializer<String>::Write(ostr, entry.second->Format());
+		});
+	}
+	template <typename Stream> inline static std::optional<Program> Read(Stream &&istr) {
+		Program ret;
+		for (uint64_t size = Serializer<uint64_t>::Read(istr); size-- && istr;) {
+			LineID line = Serializer<LineID>::Read(istr);
+			auto stmt_res = Statement::Parse(Token::Tokenize(Serializer<String>::Read(istr)));
+			if (stmt_res.IsError())
+				return std::nullopt;
+			ret.InsertStatement(line, stmt_res.PopValue());
+		}
+		return ret;
+	}
+};
+
+template <> struct Serializer<Context> {
+	template <typename Stream> inline static void Write(Stream &&ostr, const Context &val) {
+		Serializer<PersistentMap<String, Int>>::Write(ostr, val.m_variables);
+		Serializer<uint32_t>::Write(ostr, val.m_line);
+		Serializer<uint64_t>::Write(ostr, val.m_inputs.size());
+		for (auto inputs = val.m_inputs; !inputs.empty(); inputs.pop())
+			Serializer<String>::Write(ostr, inputs.front());
+		Serializer<String>::Write(ostr, val.m_outputs);
+		Serializer<bool>::Write(ostr, val.m_terminated);
+		Serializer<PersistentMap<String, Count>>::Write(ostr, val.m_variable_stats);
+		Serializer<PersistentMap<LineID, Count>>::Write(ostr, val.m_line_stats);
+		Serializer<PersistentMap<LineID, Count>>::Write(ostr, val.m_branch_stats);
+		Serializer<uint64_t>::Write(ostr, val.m_step_count);
+		Serializer<uint32_t>::Write(ostr, val.m_break_arrival.first);
+		Serializer<uint32_t>::Write(ostr, val.m_break_arrival.second);
+		Serializer<uint64_t>::Write(ostr, val.m_loops.size());
+		for (const auto &loop : val.m_loops) {
+			Serializer<String>::Write(ostr, loop.var);
+			Serializer<LineID>::Write(ostr, loop.body_line);
+			Serializer<Int>::Write(ostr, loop.limit);
+			Serializer<Int>::Write(ostr, loop.step);
+		}
+		Serializer<uint64_t>::Write(ostr, val.m_arrays.Size());
+		val.m_arrays.ForEach([&ostr](const auto &entry) {
+			Serializer<String>::Write(ostr, entry.first);
+			Serializer<uint64_t>::Write(ostr, entry.second->size());
+			for (Int element : *entry.second)
+				Serializer<Int>::Write(ostr, element);
+		});
+		Serializer<PersistentMap<String, Count>>::Write(ostr, val.m_array_stats);
+	}
+	template <typename Stream> inline static std::unique_ptr<Context> Read(Stream &&istr) {
+		auto ret = std::make_unique<Context>();
+		ret->m_variables = Serializer<PersistentMap<String, Int>>::Read(istr);
+		ret->m_line = Serializer<uint32_t>::Read(istr);
+		for (uint64_t size = Serializer<uint64_t>::Read(istr); size-- && istr;)
+			ret->m_inputs.push(Serializer<String>::Read(istr));
+		ret->m_outputs = Serializer<String>::Read(istr);
+		ret->m_terminated = Serializer<bool>::Read(istr);
+		ret->m_variable_stats = Serializer<PersistentMap<String, Count>>::Read(istr);
+		ret->m_line_stats = Serializer<PersistentMap<LineID, Count>>::Read(istr);
+		ret->m_branch_stats = Serializer<PersistentMap<LineID, Count>>::Read(istr);
+		ret->m_step_count = Serializer<uint64_t>::Read(istr);
+		ret->m_break_arrival.first = Serializer<uint32_t>::Read(istr);
+		ret->m_break_arrival.second = Serializer<uint32_t>::Read(istr);
+		for (uint64_t size = Serializer<uint64_t>::Read(istr); size-- && istr;) {
+			LoopFrame loop;
+			loop.var = Serializer<String>::Read(istr);
+			loop.body_line = Serializer<LineID>::Read(istr);
+			loop.limit = Serializer<Int>::Read(istr);
+			loop.step = Serializer<Int>::Read(istr);
+			ret->m_loops.push_back(std::move(loop));
+		}
+		for (uint64_t size = Serializer<uint64_t>::Read(istr); size-- && istr;) {
+			String var = Serializer<String>::Read(istr);
+			auto array = std::make_shared<std::vector<Int>>();
+			for (uint64_t count = Serializer<uint64_t>::Read(istr); count-- && istr && array->size() < kArrayMaxSize;)
+				array->push_back(Serializer<Int>::Read(istr));
+			ret->m_array_elements += array->size();
+			ret->m_arrays.Insert(var, std::move(array));
+		}
+		ret->m_array_stats = Serializer<PersistentMap<String, Count>>::Read(istr);
+		return ret;
+	}
+};
+
+// fields of the runtime errors carrying data
+inline auto ErrorFields(ErrUndefinedVariable &err) { return std::tie(err.var); }
+inline auto ErrorFields(ErrUndefinedLine &err) { return std::tie(err.line); }
+inline auto ErrorFields(ErrDivByZero &err) { return std::tie(err.zero_expr_str); }
+inline auto ErrorFields(ErrExpByNeg &err) { return std::tie(err.neg_expr_str); }
+inline auto ErrorFields(ErrOverflow &err) { return std::tie(err.operation_str); }
+inline auto ErrorFields(ErrInvalidInput &err) { return std::tie(err.input); }
+inline auto ErrorFields(ErrQuotaExceeded &err) { return std::tie(err.resource, err.limit); }
+inline auto ErrorFields(ErrNextWithoutFor &err) { return std::tie(err.var); }
+inline auto ErrorFields(ErrForWithoutNext &err) { return std::tie(err.var); }
+inline auto ErrorFields(ErrIndexOutOfRange &err) { return std::tie(err.element_str); }
+inline auto ErrorFields(ErrInvalidArraySize &err) { return std::tie(err.dim_str); }
+inline auto ErrorFields(MsgWatchpoint &err) { return std::tie(err.var, err.value); }
+template <typename Err> inline std::tuple<> ErrorFields(Err &) { return {}; }
+
+// index of the alternative, then its fields
+template <> struct Serializer<RuntimeError> {
+private:
+	template <typename Err, typename Stream> inline static Err read_error(Stream &&istr) {
+		Err err{};
+		std::apply(
+		    [&istr](auto &...fields) { ((fields = Serializer<std::decay_t<decltype(fields)>>::Read(istr)), ...); },
+		    ErrorFields(err));
+		return err;
+	}
+	template <typename Stream, std::size_t... Indices>
+	inline static std::optional<RuntimeError> read_alternative(Stream &&istr, uint32_t index,
+	                                                           std::index_sequence<Indices...>) {
+		std::optional<RuntimeError> ret;
+		((index == Indices ? (void)(ret = read_error<std::variant_alternative_t<Indices, RuntimeError::Variant>>(istr))
+		                   : void()),
+		 ...);
+		return ret;
+	}
+
+public:
+	template <typename Stream> inline static void Write(Stream &&ostr, const RuntimeError &val) {
+		Serializer<uint32_t>::Write(ostr, uint32_t(val.GetIndex()));
+		val.Visit([&ostr](auto err) {
+			std::apply(
+			    [&ostr](auto &...fields) { (Serializer<std::decay_t<decltype(fields)>>::Write(ostr, fields), ...); },
+			    ErrorFields(err));
+		});
+	}
+	template <typename Stream> inline static std::optional<RuntimeError> Read(Stream &&istr) {
+		uint32_t index = Serializer<uint32_t>::Read(istr);
+		return read_alternative(istr, index, std::make_index_sequence<std::variant_size_v<RuntimeError::Variant>>{});
+	}
+};
+
+// A session checkpoint, context is nullptr if the program is not running
+struct Checkpoint {
+	inline static constexpr char kVersionStr[] = "QBasicCkpt1.3";
+
+	Program program;
+	std::unique_ptr<Context> context;
+
+	template <typename Stream>
+	inline static void Write(Stream &&ostr, const Program &program, const Context *p_context) {
+		ostr.write(kVersionStr, sizeof(kVersionStr));
+		Serializer<Program>::Write(ostr, program);
+		Serializer<bool>::Write(ostr, p_context != nullptr);
+		if (p_context)
+			Serializer<Context>::Write(ostr, *p_context);
+	}
+	template <typename Stream> inline static std::optional<Checkpoint> Read(Stream &&istr) {
+		char version_str[sizeof(kVersionStr)]{};
+		istr.read(version_str, sizeof(kVersionStr));
+		if (!istr || memcmp(kVersionStr, version_str, sizeof(kVersionStr)) != 0)
+			return std::nullopt;
+
+		Checkpoint ret;
+		{
+			auto opt_program = Serializer<Program>::Read(istr);
+			if (!opt_program.has_value())
+				return std::nullopt;
+			ret.program = std::move(opt_program.value());
+		}
+		if (Serializer<bool>::Read(istr))
+			ret.context = Serializer<Context>::Read(istr);
+		if (!istr)
+			return std::nullopt;
+		return ret;
+	}
+};
+
+} // namespace basic
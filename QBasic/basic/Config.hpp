@@ -1,18 +1,61 @@
 #pragma once
 
+#include <charconv>
 #include <cinttypes>
 #include <string>
 #include <variant>
 
 namespace basic {
 
+// Width of the integers, set by the QBASIC_INT_BITS CMake option. 32 and 64-bit arithmetic wraps around (two's
+// complement), 128-bit arithmetic is checked and fails with ErrOverflow. Literals and inputs are read modulo 2^bits.
+#ifndef BASIC_INT_BITS
+#define BASIC_INT_BITS 64
+#endif
+#if BASIC_INT_BITS == 32
+using Int = int32_t;
+using UInt = uint32_t;
+#elif BASIC_INT_BITS == 64
 using Int = int64_t;
+using UInt = uint64_t;
+#elif BASIC_INT_BITS == 128
+using Int = __int128;
+using UInt = unsigned __int128;
+#else
+#error "BASIC_INT_BITS should be 32, 64 or 128"
+#endif
+constexpr bool kCheckedInt = BASIC_INT_BITS == 128;
+constexpr Int kIntMin = Int(UInt(1) << (BASIC_INT_BITS - 1));
+
 using Char = char;
 using String = std::string;
 using StringView = std::string_view;
 using Count = uint32_t;
 using LineID = uint32_t;
 
+// digits and sign of any value
+constexpr std::size_t kIntStringSize = BASIC_INT_BITS * 3 / 10 + 2;
+
+// formats into the buffer without allocating, the view is valid as long as the buffer
+inline StringView FormatInt(Int value, char (&buffer)[kIntStringSize]) {
+#if BASIC_INT_BITS == 128
+	UInt magnitude = value < 0 ? -UInt(value) : UInt(value);
+	char *p_begin = buffer + kIntStringSize;
+	do
+		*--p_begin = char('0' + int(magnitude % 10));
+	while ((magnitude /= 10) != 0);
+	if (value < 0)
+		*--p_begin = '-';
+	return {p_begin, std::size_t(buffer + kIntStringSize - p_begin)};
+#else
+	return {buffer, std::size_t(std::to_chars(buffer, buffer + kIntStringSize, value).ptr - buffer)};
+#endif
+}
+inline String IntToString(Int value) {
+	char buffer[kIntStringSize];
+	return String{FormatInt(value, buffer)};
+}
+
 template <typename> struct VariantIterator;
 template <typename... Types> struct VariantIterator<std::variant<Types...>> {
 	// return true as break;
@@ -20,5 +63,20 @@ template <typename... Types> struct VariantIterator<std::variant<Types...>> {
 };
 
 constexpr const char *kASTFormatAlign = "  ";
+constexpr Count kSchedulerSliceSteps = 4096;
+constexpr Count kJitThreshold = 1000;
+constexpr Count kArrayMaxSize = 1 << 24;
+constexpr Count kProfilerIntervalUs = 1000;
+constexpr Count kMeterClockSteps = 1024;
+constexpr Count kHistoryInterval = 4096;
+constexpr Count kHistoryMaxSnapshots = 4096;
+constexpr Count kWorkerCount = 2;
+constexpr Count kWorkerRingSize = 1 << 16;
+constexpr Count kWorkerPollUs = 1000;
+constexpr Count kWorkerKillTimeoutUs = 200000;
+constexpr const char *kDaemonSocketPath = "/tmp/qbasicd.sock";
+constexpr Count kDaemonCacheSize = 256;
+constexpr Count kDaemonMaxFrameSize = 1 << 20;
+constexpr Count kDaemonOutputLimit = 1 << 24;
 
 } // namespace basic
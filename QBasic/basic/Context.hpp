@@ -2,25 +2,63 @@
 
 #include <memory>
 #include <queue>
-#include <unordered_map>
+#include <vector>
 
 #include "Config.hpp"
 #include "Error.hpp"
+#include "InputSource.hpp"
+#include "Meter.hpp"
+#include "PersistentMap.hpp"
 #include "Program.hpp"
 
 namespace basic {
 
+class TraceWriter;
+
+// a FOR loop being run, NEXT adds the step to var and goes back to body_line while within the limit
+struct LoopFrame {
+	String var;
+	LineID body_line;
+	Int limit, step;
+};
+
+// Variables and statistics are persistent maps, so copying (forking) a Context is O(1) and the copies only duplicate
+// the slots they write afterwards.
 class Context {
 private:
-	std::unordered_map<String, Int> m_variables;
+	using Array = std::shared_ptr<std::vector<Int>>;
+
+	PersistentMap<String, Int> m_variables;
+	PersistentMap<String, Array> m_arrays; // shared by forks until written
+	Count m_array_elements{};
 	LineID m_line = -1;
+	uint64_t m_step_count{}; // lines arrived at, i.e. statements completed plus the first line
 
 	std::queue<String> m_inputs;
+	String m_popped_input;
 	String m_outputs;
 	bool m_terminated = false;
+	// arrival (line and its execution count) paused at a breakpoint, the breakpoint lets it pass when resumed
+	std::pair<LineID, Count> m_break_arrival{-1, 0};
+	std::vector<LoopFrame> m_loops; // innermost last, at most one per variable
+
+	mutable PersistentMap<String, Count> m_variable_stats, m_array_stats;
+	mutable PersistentMap<LineID, Count> m_line_stats, m_branch_stats;
 
-	mutable std::unordered_map<String, Count> m_variable_stats;
-	mutable std::unordered_map<LineID, Count> m_line_stats, m_branch_stats;
+	// not owned, not saved in checkpoints
+	TraceWriter *m_p_tracer{};
+	Meter *m_p_meter{};
+	std::vector<String> *m_p_input_log{};
+	InputSource *m_p_input_source{};
+	void trace_write(const String &var, Int val) const;
+	void trace_write(const String &var, Int index, Int val) const;
+	inline void meter_variables() const {
+		if (m_p_meter)
+			m_p_meter->Variables(m_variables.Size() + m_array_elements);
+	}
+	void trace_input(StringView input) const;
+
+	template <typename> friend struct Serializer;
 
 public:
 	inline static RuntimeResult<std::unique_ptr<Context>> Create(const Program &program) {
@@ -33,20 +71,110 @@ public:
 		return ret;
 	}
 
+	// fork execution from the current state, e.g. to try different inputs from a shared prefix
+	inline std::unique_ptr<Context> Fork() const {
+		auto ret = std::make_unique<Context>(*this);
+		ret->m_p_tracer = nullptr;
+		ret->m_p_meter = nullptr;
+		ret->m_p_input_log = nullptr;
+		ret->m_p_input_source = nullptr;
+		return ret;
+	}
+
+	inline void SetTracer(TraceWriter *p_tracer) { m_p_tracer = p_tracer; }
+	inline TraceWriter *GetTracer() const { return m_p_tracer; }
+	inline void SetMeter(Meter *p_meter) {
+		m_p_meter = p_meter;
+		meter_variables();
+	}
+	inline Meter *GetMeter() const { return m_p_meter; }
+	// appends the consumed inputs
+	inline void SetInputLog(std::vector<String> *p_input_log) { m_p_input_log = p_input_log; }
+	// read when the pushed inputs run out
+	inline void SetInputSource(InputSource *p_input_source) { m_p_input_source = p_input_source; }
+
 	inline RuntimeResult<Int> ReadVariable(const String &var) const {
-		auto it = m_variables.find(var);
-		if (it == m_variables.end())
+		auto p_entry = m_variables.Find(var);
+		if (p_entry == nullptr)
 			return ErrUndefinedVariable{.var = var};
 		++m_variable_stats[var];
-		return it->second;
+		return p_entry->second;
+	}
+	inline void SetVariable(const String &var, Int val) {
+		m_variables[var] = val;
+		if (m_p_tracer)
+			trace_write(var, val);
+		meter_variables();
+	}
+	// for compiled code: read without counting, then count the uses in bulk
+	inline const Int *FindVariable(const String &var) const {
+		auto p_entry = m_variables.Find(var);
+		return p_entry ? &p_entry->second : nullptr;
+	}
+	inline void AddVariableStat(const String &var, Count count) const { m_variable_stats[var] += count; }
+
+	template <typename Func> inline void ForEachVariable(Func &&func) const {
+		m_variables.ForEach([&func](const auto &entry) { func(entry.first, entry.second); });
+	}
+
+	// DIM: size elements indexed from 0, all zero, replacing the previous array of the name
+	inline void DimArray(const String &var, Count size) {
+		Array &array = m_arrays[var];
+		if (array)
+			m_array_elements -= array->size();
+		array = std::make_shared<std::vector<Int>>(size);
+		m_array_elements += size;
+		meter_variables();
+	}
+	inline RuntimeResult<Int> ReadElement(const String &var, Int index) const {
+		auto p_entry = m_arrays.Find(var);
+		if (p_entry == nullptr)
+			return ErrUndefinedVariable{.var = var + "()"};
+		const auto &array = *p_entry->second;
+		// a negative index wraps above any size
+		if (UInt(index) >= UInt(array.size()))
+			return ErrIndexOutOfRange{.element_str = var + "(" + IntToString(index) + ")"};
+		++m_array_stats[var];
+		return array[index];
+	}
+	// the element to write, checked before the value is computed
+	inline RuntimeResult<Int *> ElementRef(const String &var, Int index) {
+		if (m_arrays.Find(var) == nullptr)
+			return ErrUndefinedVariable{.var = var + "()"};
+		Array &array = m_arrays[var];
+		if (UInt(index) >= UInt(array->size()))
+			return ErrIndexOutOfRange{.element_str = var + "(" + IntToString(index) + ")"};
+		if (array.use_count() != 1)
+			array = std::make_shared<std::vector<Int>>(*array);
+		return &(*array)[index];
+	}
+	// after writing through ElementRef, counts the use, so an INPUT retried after the request counts once
+	inline void WroteElement(const String &var, Int index, Int val) const {
+		++m_array_stats[var];
+		if (m_p_tracer)
+			trace_write(var, index, val);
+	}
+	// for compiled code: the elements without counting, nullptr if not dimensioned
+	inline const std::vector<Int> *FindArray(const String &var) const {
+		auto p_entry = m_arrays.Find(var);
+		return p_entry ? p_entry->second.get() : nullptr;
+	}
+	inline void AddArrayStat(const String &var, Count count) const { m_array_stats[var] += count; }
+
+	template <typename Func> inline void ForEachArray(Func &&func) const {
+		m_arrays.ForEach([&func](const auto &entry) { func(entry.first, *entry.second); });
 	}
-	inline void SetVariable(const String &var, Int val) { m_variables[var] = val; }
 
 	inline LineID GetLine() const { return m_line; }
+	inline uint64_t GetStepCount() const { return m_step_count; }
+
+	inline bool IsBreakPassed() const { return m_break_arrival == std::pair{m_line, GetLineStat(m_line)}; }
+	inline void PassBreak() { m_break_arrival = {m_line, GetLineStat(m_line)}; }
 
 	inline RuntimeResult<void> GotoLine(const Program &program, LineID line) {
 		BASIC_UNWRAP(program.CheckLine(line));
 		m_line = line;
+		++m_step_count;
 		++m_line_stats[line];
 		return {};
 	}
@@ -60,34 +188,101 @@ public:
 		return GotoLine(program, line);
 	}
 
+	// a FOR loop, replacing the loop of its variable and those nested in it, if jumped out of them
+	inline void PushLoop(LoopFrame loop) {
+		DropLoop(loop.var);
+		m_loops.push_back(std::move(loop));
+	}
+	inline void DropLoop(const String &var) {
+		if (FindLoop(var))
+			m_loops.pop_back();
+	}
+	// the innermost loop of the variable after dropping the loops nested in it, nullptr if none
+	inline LoopFrame *FindLoop(const String &var) {
+		for (std::size_t i = m_loops.size(); i-- > 0;)
+			if (m_loops[i].var == var) {
+				m_loops.resize(i + 1);
+				return &m_loops.back();
+			}
+		return nullptr;
+	}
+	inline void PopLoop() { m_loops.pop_back(); }
+	inline const std::vector<LoopFrame> &GetLoops() const { return m_loops; }
+
+	// for NEXT: adds to the variable in a single lookup and counts its use, false (unchanged) if the sum overflows
+	inline bool StepVariable(const String &var, Int step, Int *p_value) {
+		Int &value = m_variables[var];
+		if (__builtin_add_overflow(value, step, p_value))
+			return false;
+		value = *p_value;
+		++m_variable_stats[var];
+		if (m_p_tracer)
+			trace_write(var, value);
+		return true;
+	}
+
 	inline void PushInput(StringView string) { m_inputs.emplace(string); }
-	inline RuntimeResult<String> PopInput() {
-		if (m_inputs.empty())
-			return MsgRequestInput{};
-		String ret = std::move(m_inputs.front());
-		m_inputs.pop();
+	// valid until the next call
+	inline RuntimeResult<StringView> PopInput() {
+		StringView ret;
+		if (!m_inputs.empty()) {
+			m_popped_input = std::move(m_inputs.front());
+			m_inputs.pop();
+			ret = m_popped_input;
+		} else {
+			std::optional<StringView> opt_line;
+			if (m_p_input_source == nullptr || !(opt_line = m_p_input_source->NextLine()).has_value())
+				return MsgRequestInput{};
+			ret = opt_line.value();
+		}
+		if (m_p_tracer)
+			trace_input(ret);
+		if (m_p_input_log)
+			m_p_input_log->emplace_back(ret);
 		return ret;
 	}
 	inline bool HaveInput() const { return !m_inputs.empty(); }
+	inline const std::queue<String> &GetInputs() const { return m_inputs; }
+	inline void ClearInputs() { m_inputs = {}; }
 
 	inline void PushOutput(StringView string) {
 		m_outputs += string;
 		m_outputs += '\n';
+		if (m_p_meter)
+			m_p_meter->Output(string.size() + 1);
+	}
+	// swaps the outputs into *p_outputs, the next outputs reuse its buffer, so popping in a loop doesn't allocate
+	inline void PopOutputs(String *p_outputs) {
+		p_outputs->clear();
+		std::swap(m_outputs, *p_outputs);
+		if (!p_outputs->empty() && p_outputs->back() == '\n')
+			p_outputs->pop_back();
 	}
 	inline String PopOutputs() {
-		String ret = std::move(m_outputs);
-		if (!ret.empty() && ret.back() == '\n')
-			ret.pop_back();
-		m_outputs.clear();
+		String ret;
+		PopOutputs(&ret);
 		return ret;
 	}
 
 	inline void Terminate() { m_terminated = true; }
 	inline bool IsTerminated() const { return m_terminated; }
 
-	inline Count GetVariableStat(const String &var) const { return m_variable_stats[var]; }
-	inline Count GetLineStat(LineID line) const { return m_line_stats[line]; }
-	inline Count GetBranchStat(LineID line) const { return m_branch_stats[line]; }
+	inline Count GetVariableStat(const String &var) const {
+		auto p_entry = m_variable_stats.Find(var);
+		return p_entry ? p_entry->second : 0;
+	}
+	inline Count GetArrayStat(const String &var) const {
+		auto p_entry = m_array_stats.Find(var);
+		return p_entry ? p_entry->second : 0;
+	}
+	inline Count GetLineStat(LineID line) const {
+		auto p_entry = m_line_stats.Find(line);
+		return p_entry ? p_entry->second : 0;
+	}
+	inline Count GetBranchStat(LineID line) const {
+		auto p_entry = m_branch_stats.Find(line);
+		return p_entry ? p_entry->second : 0;
+	}
 };
 
 } // namespace basic
@@ -0,0 +1,468 @@
+#include "Daemon.hpp"
+
+#include "Checkpoint.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace basic {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+constexpr std::size_t kFrameHeaderSize = 5;
+constexpr std::size_t kReadChunkSize = 1 << 16;
+
+// FNV-1a
+uint64_t hash_source(StringView source) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (char c : source)
+		hash = (hash ^ (unsigned char)c) * 0x100000001b3ull;
+	return hash;
+}
+
+// the payload is written by write_payload(StringWriter &)
+template <typename WritePayload> void append_frame(String *p_out, DaemonFrame type, WritePayload &&write_payload) {
+	std::size_t begin = p_out->size();
+	p_out->append(kFrameHeaderSize, '\0');
+	StringWriter writer{p_out};
+	write_payload(writer);
+	auto size = uint32_t(p_out->size() - begin - kFrameHeaderSize);
+	for (uint32_t i = 0; i < 4; ++i)
+		(*p_out)[begin + i] = char(size >> (8 * i));
+	(*p_out)[begin + 4] = char(type);
+}
+
+// Size of the first frame of buffer, 0 if incomplete, npos if too large
+std::size_t peek_frame(StringView buffer, DaemonFrame *p_type, StringView *p_payload) {
+	if (buffer.size() < kFrameHeaderSize)
+		return 0;
+	uint32_t size = 0;
+	for (uint32_t i = 0; i < 4; ++i)
+		size |= uint32_t((unsigned char)buffer[i]) << (8 * i);
+	if (size > kDaemonMaxFrameSize)
+		return StringView::npos;
+	if (buffer.size() < kFrameHeaderSize + size)
+		return 0;
+	*p_type = DaemonFrame(buffer[4]);
+	*p_payload = buffer.substr(kFrameHeaderSize, size);
+	return kFrameHeaderSize + size;
+}
+
+bool set_nonblocking(int fd) {
+	int flags = fcntl(fd, F_GETFL);
+	return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+bool make_address(const String &path, sockaddr_un *p_address) {
+	*p_address = {};
+	p_address->sun_family = AF_UNIX;
+	if (path.size() >= sizeof(p_address->sun_path)) {
+		errno = ENAMETOOLONG;
+		return false;
+	}
+	memcpy(p_address->sun_path, path.data(), path.size());
+	return true;
+}
+
+} // namespace
+
+struct Daemon::Connection {
+	int fd;
+	String in; // Serve thread only
+	std::size_t in_offset{};
+
+	std::mutex mutex;
+	String out;
+	bool closed{};
+	std::unordered_map<uint64_t, Scheduler::SessionHandle> sessions; // requests not finished yet
+
+	inline explicit Connection(int fd) : fd{fd} {}
+
+	// from the scheduler threads, false if the connection is closed
+	template <typename WritePayload> inline bool Post(DaemonFrame type, WritePayload &&write_payload) {
+		std::scoped_lock lock{mutex};
+		if (closed)
+			return false;
+		append_frame(&out, type, std::forward<WritePayload>(write_payload));
+		return true;
+	}
+	inline bool Finish(uint64_t id, DaemonStatus status, LineID line, const String &message) {
+		std::scoped_lock lock{mutex};
+		if (closed)
+			return false;
+		sessions.erase(id);
+		append_frame(&out, DaemonFrame::kFinish, [&](StringWriter &writer) {
+			Serializer<uint64_t>::Write(writer, id);
+			writer.put(char(status));
+			Serializer<LineID>::Write(writer, line);
+			Serializer<String>::Write(writer, message);
+		});
+		return true;
+	}
+};
+
+Daemon::Daemon(String path, int listen_fd, const int wake_fds[2], std::size_t thread_count, std::size_t cache_size)
+    : m_path{std::move(path)}, m_listen_fd{listen_fd}, m_wake_fds{wake_fds[0], wake_fds[1]},
+      m_scheduler{std::make_unique<Scheduler>(thread_count)}, m_cache_capacity{std::max<std::size_t>(cache_size, 1)} {
+}
+
+Daemon::~Daemon() {
+	// no callback runs after the scheduler is gone
+	m_scheduler = nullptr;
+	for (auto &connection : m_connections)
+		close_connection(connection.get());
+	close(m_listen_fd);
+	close(m_wake_fds[0]);
+	close(m_wake_fds[1]);
+	unlink(m_path.c_str());
+}
+
+std::unique_ptr<Daemon> Daemon::Listen(const String &path, std::size_t thread_count, std::size_t cache_size) {
+	sockaddr_un address{};
+	if (!make_address(path, &address))
+		return nullptr;
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd == -1)
+		return nullptr;
+	int wake_fds[2] = {-1, -1};
+	unlink(path.c_str());
+	if (bind(listen_fd, (const sockaddr *)&address, sizeof(address)) == -1 || listen(listen_fd, SOMAXCONN) == -1 ||
+	    !set_nonblocking(listen_fd) || pipe(wake_fds) == -1 || !set_nonblocking(wake_fds[0]) ||
+	    !set_nonblocking(wake_fds[1])) {
+		int error = errno;
+		close(listen_fd);
+		if (wake_fds[0] != -1) {
+			close(wake_fds[0]);
+			close(wake_fds[1]);
+		}
+		errno = error;
+		return nullptr;
+	}
+	return std::make_unique<Daemon>(path, listen_fd, wake_fds, thread_count, cache_size);
+}
+
+void Daemon::wake() {
+	// one pending byte is enough
+	if (!m_wake_pending.exchange(true, std::memory_order_acq_rel)) {
+		char byte = 0;
+		[[maybe_unused]] auto written = write(m_wake_fds[1], &byte, 1);
+	}
+}
+
+void Daemon::Stop() {
+	m_stopped.store(true, std::memory_order_release);
+	wake();
+}
+
+DaemonStats Daemon::GetStats() const {
+	return {.requests = m_requests.load(std::memory_order_relaxed),
+	        .cache_hits = m_cache_hits.load(std::memory_order_relaxed),
+	        .cache_misses = m_cache_misses.load(std::memory_order_relaxed)};
+}
+
+void Daemon::Serve() {
+	std::vector<pollfd> poll_fds;
+	while (!m_stopped.load(std::memory_order_acquire)) {
+		poll_fds.clear();
+		poll_fds.push_back({.fd = m_listen_fd, .events = POLLIN, .revents = 0});
+		poll_fds.push_back({.fd = m_wake_fds[0], .events = POLLIN, .revents = 0});
+		for (const auto &connection : m_connections) {
+			std::scoped_lock lock{connection->mutex};
+			auto events = short(connection->out.empty() ? POLLIN : POLLIN | POLLOUT);
+			poll_fds.push_back({.fd = connection->fd, .events = events, .revents = 0});
+		}
+		if (poll(poll_fds.data(), poll_fds.size(), -1) == -1 && errno != EINTR)
+			break;
+
+		// drained before clearing the flag, a later wake() writes again
+		if (poll_fds[1].revents) {
+			char buffer[64];
+			while (read(m_wake_fds[0], buffer, sizeof(buffer)) > 0) {
+			}
+			m_wake_pending.store(false, std::memory_order_release);
+		}
+		// the connections accepted now are not in poll_fds
+		std::size_t polled_count = m_connections.size();
+		if (poll_fds[0].revents)
+			accept_connections();
+
+		// outputs are posted from the scheduler threads at any time, so every connection is flushed
+		for (std::size_t i = 0; i < m_connections.size(); ++i) {
+			Connection *p_connection = m_connections[i].get();
+			bool readable = i < polled_count && poll_fds[i + 2].revents;
+			if ((readable && !read_connection(m_connections[i])) || !flush_connection(p_connection)) {
+				close_connection(p_connection);
+				m_connections[i] = nullptr;
+			}
+		}
+		std::erase(m_connections, nullptr);
+	}
+}
+
+void Daemon::accept_connections() {
+	while (true) {
+		int fd = accept(m_listen_fd, nullptr, nullptr);
+		if (fd == -1)
+			return;
+		if (!set_nonblocking(fd)) {
+			close(fd);
+			continue;
+		}
+		m_connections.push_back(std::make_shared<Connection>(fd));
+	}
+}
+
+bool Daemon::read_connection(const std::shared_ptr<Connection> &connection) {
+	Connection *p_connection = connection.get();
+	auto &in = p_connection->in;
+	while (true) {
+		std::size_t size = in.size();
+		in.resize(size + kReadChunkSize);
+		ssize_t count = recv(p_connection->fd, in.data() + size, kReadChunkSize, 0);
+		in.resize(size + std::max<ssize_t>(count, 0));
+		if (count == 0)
+			return false;
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return false;
+			break;
+		}
+	}
+
+	DaemonFrame type;
+	StringView payload;
+	while (true) {
+		std::size_t size = peek_frame(StringView{in}.substr(p_connection->in_offset), &type, &payload);
+		if (size == StringView::npos)
+			return false;
+		if (size == 0)
+			break;
+		if (!handle_frame(connection, type, payload))
+			return false;
+		p_connection->in_offset += size;
+	}
+	// keep the buffer from growing with the frames already handled
+	if (p_connection->in_offset >= in.size() / 2) {
+		in.erase(0, p_connection->in_offset);
+		p_connection->in_offset = 0;
+	}
+	return true;
+}
+
+bool Daemon::flush_connection(Connection *p_connection) {
+	std::scoped_lock lock{p_connection->mutex};
+	auto &out = p_connection->out;
+	std::size_t sent = 0;
+	while (sent < out.size()) {
+		ssize_t count = send(p_connection->fd, out.data() + sent, out.size() - sent, kSendFlags);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				return false;
+			break;
+		}
+		sent += count;
+	}
+	out.erase(0, sent);
+	// a client not reading its outputs is dropped
+	return out.size() <= kDaemonOutputLimit;
+}
+
+void Daemon::close_connection(Connection *p_connection) {
+	std::unordered_map<uint64_t, Scheduler::SessionHandle> sessions;
+	{
+		std::scoped_lock lock{p_connection->mutex};
+		p_connection->closed = true;
+		p_connection->out.clear();
+		sessions.swap(p_connection->sessions);
+	}
+	if (m_scheduler)
+		for (const auto &entry : sessions)
+			m_scheduler->Terminate(entry.second);
+	close(p_connection->fd);
+}
+
+ParseResult<const Script *> Daemon::find_script(const String &source) {
+	uint64_t hash = hash_source(source);
+	auto index_it = m_cache_index.find(hash);
+	// a hash collision replaces the entry
+	if (index_it != m_cache_index.end() && index_it->second->source == source) {
+		m_cache.splice(m_cache.begin(), m_cache, index_it->second);
+		m_cache_hits.fetch_add(1, std::memory_order_relaxed);
+		return &m_cache.front().script;
+	}
+	m_cache_misses.fetch_add(1, std::memory_order_relaxed);
+
+	std::istringstream sin{source};
+	Script script;
+	BASIC_UNWRAP_ASSIGN(script, Script::Load(sin));
+	if (index_it != m_cache_index.end()) {
+		m_cache.erase(index_it->second);
+		m_cache_index.erase(index_it);
+	} else if (m_cache.size() >= m_cache_capacity) {
+		m_cache_index.erase(m_cache.back().hash);
+		m_cache.pop_back();
+	}
+	m_cache.push_front({hash, source, std::move(script)});
+	m_cache_index[hash] = m_cache.begin();
+	return &m_cache.front().script;
+}
+
+bool Daemon::handle_frame(const std::shared_ptr<Connection> &connection, DaemonFrame type, StringView payload) {
+	if (type != DaemonFrame::kSubmit)
+		return false;
+	StringReader reader{payload};
+	uint64_t id = Serializer<uint64_t>::Read(reader);
+	uint32_t priority = Serializer<uint32_t>::Read(reader);
+	String source = Serializer<String>::Read(reader);
+	std::vector<String> inputs(std::min<uint64_t>(Serializer<uint64_t>::Read(reader), payload.size()));
+	for (auto &input : inputs)
+		input = Serializer<String>::Read(reader);
+	if (!reader)
+		return false;
+	m_requests.fetch_add(1, std::memory_order_relaxed);
+
+	auto script_res = find_script(source);
+	if (script_res.IsError()) {
+		connection->Finish(id, DaemonStatus::kParseError, 0, script_res.PopError().Format());
+		return true;
+	}
+	const Script &script = *script_res.PopValue();
+	auto context_res = Context::Create(script.GetProgram());
+	if (context_res.IsError()) {
+		connection->Finish(id, DaemonStatus::kParseError, 0, context_res.PopError().Format());
+		return true;
+	}
+	auto context = context_res.PopValue();
+	for (const auto &input : script.GetInputs())
+		context->PushInput(input);
+	for (const auto &input : inputs)
+		context->PushInput(input);
+
+	SessionCallbacks callbacks{
+	    .on_output =
+	        [this, connection, id](const String &outputs) {
+		        bool posted = connection->Post(DaemonFrame::kOutput, [&](StringWriter &writer) {
+			        Serializer<uint64_t>::Write(writer, id);
+			        Serializer<String>::Write(writer, outputs);
+		        });
+		        if (posted)
+			        wake();
+	        },
+	    // the blocked session is released with its handle
+	    .on_input_request =
+	        [this, connection, id](LineID line) {
+		        if (connection->Finish(id, DaemonStatus::kInputRequest, line, MsgRequestInput{}.Format()))
+			        wake();
+	        },
+	    .on_finish =
+	        [this, connection, id](ExecuteResult result) {
+		        auto error = result.result.PopError();
+		        bool end = false;
+		        error.Visit([&end](const auto &error) {
+			        end = std::is_same_v<std::decay_t<decltype(error)>, MsgEndOfProgram>;
+		        });
+		        LineID line = result.context ? result.context->GetLine() : 0;
+		        if (connection->Finish(id, end ? DaemonStatus::kEnd : DaemonStatus::kError, line, error.Format()))
+			        wake();
+	        },
+	};
+	// the callbacks wait for the handle to be stored
+	std::scoped_lock lock{connection->mutex};
+	connection->sessions[id] =
+	    m_scheduler->Submit(script.GetProgram(), std::move(context), priority, std::move(callbacks));
+	return true;
+}
+
+DaemonClient::~DaemonClient() { close(m_fd); }
+
+std::unique_ptr<DaemonClient> DaemonClient::Connect(const String &path) {
+	sockaddr_un address{};
+	if (!make_address(path, &address))
+		return nullptr;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1)
+		return nullptr;
+	if (connect(fd, (const sockaddr *)&address, sizeof(address)) == -1) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return nullptr;
+	}
+	return std::make_unique<DaemonClient>(fd);
+}
+
+void DaemonClient::Submit(uint64_t id, StringView source, const std::vector<String> &inputs, uint32_t priority) {
+	append_frame(&m_out, DaemonFrame::kSubmit, [&](StringWriter &writer) {
+		Serializer<uint64_t>::Write(writer, id);
+		Serializer<uint32_t>::Write(writer, priority);
+		Serializer<uint64_t>::Write(writer, source.size());
+		writer.write(source.data(), (std::streamsize)source.size());
+		Serializer<uint64_t>::Write(writer, inputs.size());
+		for (const auto &input : inputs)
+			Serializer<String>::Write(writer, input);
+	});
+}
+
+bool DaemonClient::Flush() {
+	std::size_t sent = 0;
+	while (sent < m_out.size()) {
+		ssize_t count = send(m_fd, m_out.data() + sent, m_out.size() - sent, kSendFlags);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return false;
+		sent += count;
+	}
+	m_out.clear();
+	return true;
+}
+
+std::optional<DaemonReply> DaemonClient::Receive() {
+	if (!Flush())
+		return std::nullopt;
+	DaemonFrame type;
+	StringView payload;
+	std::size_t size;
+	while ((size = peek_frame(StringView{m_in}.substr(m_in_offset), &type, &payload)) == 0) {
+		if (m_in_offset) {
+			m_in.erase(0, m_in_offset);
+			m_in_offset = 0;
+		}
+		std::size_t in_size = m_in.size();
+		m_in.resize(in_size + kReadChunkSize);
+		ssize_t count = recv(m_fd, m_in.data() + in_size, kReadChunkSize, 0);
+		m_in.resize(in_size + std::max<ssize_t>(count, 0));
+		if (count == 0 || (count < 0 && errno != EINTR))
+			return std::nullopt;
+	}
+	if (size == StringView::npos)
+		return std::nullopt;
+	m_in_offset += size;
+
+	StringReader reader{payload};
+	DaemonReply reply{.type = type, .id = Serializer<uint64_t>::Read(reader), .status = {}, .line = 0, .text = {}};
+	if (type == DaemonFrame::kFinish) {
+		reply.status = DaemonStatus(reader.get());
+		reply.line = Serializer<LineID>::Read(reader);
+	}
+	reply.text = Serializer<String>::Read(reader);
+	if (!reader)
+		return std::nullopt;
+	return reply;
+}
+
+} // namespace basic
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Scheduler.hpp"
+#include "Script.hpp"
+
+#include <list>
+#include <unordered_map>
+
+namespace basic {
+
+// Wire protocol of qbasicd, over a Unix stream socket. Each frame is its payload size (4 bytes, little-endian), its
+// type (1 byte) and its payload, whose fields are encoded like a checkpoint (varints, length-prefixed strings).
+// A client may send any number of kSubmit frames without waiting (a batch). For each one the daemon streams kOutput
+// frames and ends with one kFinish frame. The frames of different requests interleave, the request id tells them
+// apart.
+enum class DaemonFrame : uint8_t {
+	kSubmit, // id, priority, source (LOAD script format, may contain "? value" inputs), input count, inputs
+	kOutput, // id, outputs of one or more PRINTs, without the trailing newline
+	kFinish, // id, status, line, message
+};
+enum class DaemonStatus : uint8_t {
+	kEnd,          // reached the end of the program
+	kInputRequest, // stopped at an INPUT after the inputs ran out
+	kError,        // runtime error, or terminated by the daemon stopping
+	kParseError,   // the source didn't parse, or the program is empty
+};
+
+struct DaemonReply {
+	DaemonFrame type;
+	uint64_t id;
+	DaemonStatus status; // kFinish only
+	LineID line;         // kFinish only
+	String text;         // outputs, or the message
+};
+
+struct DaemonStats {
+	uint64_t requests, cache_hits, cache_misses;
+};
+
+// Serves the protocol on one thread (Serve), runs the requests on a shared Scheduler. Parsed scripts are cached by the
+// hash of their source, so a program submitted again is neither tokenized nor parsed.
+class Daemon {
+private:
+	struct Connection;
+	struct CacheEntry {
+		uint64_t hash;
+		String source;
+		Script script;
+	};
+
+	String m_path;
+	int m_listen_fd, m_wake_fds[2];
+	std::atomic_bool m_stopped{false}, m_wake_pending{false};
+	std::unique_ptr<Scheduler> m_scheduler;
+
+	// Serve thread only
+	std::size_t m_cache_capacity;
+	std::list<CacheEntry> m_cache; // most recently used first
+	std::unordered_map<uint64_t, std::list<CacheEntry>::iterator> m_cache_index;
+	std::vector<std::shared_ptr<Connection>> m_connections;
+
+	std::atomic<uint64_t> m_requests{}, m_cache_hits{}, m_cache_misses{};
+
+	void wake();
+	void accept_connections();
+	// false when the connection should close
+	bool read_connection(const std::shared_ptr<Connection> &connection);
+	bool flush_connection(Connection *p_connection);
+	void close_connection(Connection *p_connection);
+	bool handle_frame(const std::shared_ptr<Connection> &connection, DaemonFrame type, StringView payload);
+	ParseResult<const Script *> find_script(const String &source);
+
+public:
+	Daemon(String path, int listen_fd, const int wake_fds[2], std::size_t thread_count, std::size_t cache_size);
+	~Daemon();
+	Daemon(const Daemon &) = delete;
+	Daemon &operator=(const Daemon &) = delete;
+
+	// bind the socket (replacing a stale one), nullptr on failure with errno set
+	static std::unique_ptr<Daemon> Listen(const String &path,
+	                                      std::size_t thread_count = std::thread::hardware_concurrency(),
+	                                      std::size_t cache_size = kDaemonCacheSize);
+
+	// serve until Stop, on the calling thread
+	void Serve();
+	// from any thread, or a signal handler
+	void Stop();
+
+	DaemonStats GetStats() const;
+};
+
+// Blocking client, submissions are buffered until Flush or Receive.
+class DaemonClient {
+private:
+	int m_fd;
+	String m_out, m_in;
+	std::size_t m_in_offset{};
+
+public:
+	explicit DaemonClient(int fd) : m_fd{fd} {}
+	~DaemonClient();
+	DaemonClient(const DaemonClient &) = delete;
+	DaemonClient &operator=(const DaemonClient &) = delete;
+
+	// nullptr on failure with errno set
+	static std::unique_ptr<DaemonClient> Connect(const String &path);
+
+	void Submit(uint64_t id, StringView source, const std::vector<String> &inputs = {}, uint32_t priority = 0);
+	bool Flush();
+	// nullopt when the connection is closed
+	std::optional<DaemonReply> Receive();
+};
+
+} // namespace basic
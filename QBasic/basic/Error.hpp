@@ -90,13 +90,43 @@ struct ErrExpByNeg {
 		return RUNTIME_ERROR_HEAD "Exponentiated by negative value expression \'" + neg_expr_str + "\'";
 	}
 };
+struct ErrOverflow {
+	String operation_str; // with the operand values
+	inline String Format() const { return RUNTIME_ERROR_HEAD "Integer overflow in \'" + operation_str + "\'"; }
+};
 struct ErrInvalidInput {
 	String input;
 	inline String Format() const { return RUNTIME_ERROR_HEAD "Invalid input \'" + input + "\'"; }
 };
+struct ErrQuotaExceeded {
+	String resource; // with its unit, e.g. "statements" or "us of CPU time"
+	uint64_t limit;
+	inline String Format() const {
+		return RUNTIME_ERROR_HEAD "Exceeded the quota of " + std::to_string(limit) + " " + resource;
+	}
+};
+struct ErrIndexOutOfRange {
+	String element_str; // with the index value, e.g. "a(-1)"
+	inline String Format() const { return RUNTIME_ERROR_HEAD "Index out of range in \'" + element_str + "\'"; }
+};
+struct ErrInvalidArraySize {
+	String dim_str; // with the size value
+	inline String Format() const { return RUNTIME_ERROR_HEAD "Invalid array size in \'DIM " + dim_str + "\'"; }
+};
+struct ErrNextWithoutFor {
+	String var;
+	inline String Format() const { return RUNTIME_ERROR_HEAD "NEXT without FOR for \'" + var + "\'"; }
+};
+struct ErrForWithoutNext {
+	String var;
+	inline String Format() const { return RUNTIME_ERROR_HEAD "FOR without NEXT for \'" + var + "\'"; }
+};
 struct ErrTerminate {
 	static inline String Format() { return RUNTIME_ERROR_HEAD "Program terminated by user"; }
 };
+struct ErrWorkerLost {
+	inline String Format() const { return RUNTIME_ERROR_HEAD "Lost the worker process running the program"; }
+};
 
 // messages, not error, but used as error
 struct MsgPrint {
@@ -108,6 +138,19 @@ struct MsgEndOfProgram {
 struct MsgRequestInput {
 	inline String Format() const { return RUNTIME_MSG_HEAD "Input requested"; }
 };
+struct MsgBreakpoint {
+	inline String Format() const { return RUNTIME_MSG_HEAD "Breakpoint"; }
+};
+struct MsgWatchpoint {
+	String var;
+	Int value;
+	inline String Format() const {
+		return RUNTIME_MSG_HEAD "Watched variable \'" + var + "\' = " + IntToString(value);
+	}
+};
+struct MsgStep {
+	inline String Format() const { return RUNTIME_MSG_HEAD "Stepped"; }
+};
 
 #undef PARSE_ERROR_HEAD
 #undef RUNTIME_ERROR_HEAD
@@ -118,7 +161,10 @@ private:
 	std::variant<Errors...> m_err;
 
 public:
+	using Variant = std::variant<Errors...>;
+
 	template <typename T> inline Error(T &&val) : m_err{std::forward<T>(val)} {}
+	inline std::size_t GetIndex() const { return m_err.index(); }
 	inline String Format() const {
 		return std::visit([](const auto &err) -> String { return err.Format(); }, m_err);
 	}
@@ -129,8 +175,10 @@ public:
 
 using ParseError = Error<ErrNoOperand, ErrEmptyExpr, ErrOrphanExpr, ErrBracketUnmatched, ErrInvalidToken,
                          ErrMissingToken, ErrInvalidVariable, ErrInvalidDigit, ErrEmptyStmt>;
-using RuntimeError = Error<ErrUndefinedVariable, ErrUndefinedLine, ErrDivByZero, ErrExpByNeg, ErrTerminate,
-                           ErrInvalidInput, MsgPrint, MsgEndOfProgram, MsgRequestInput>;
+using RuntimeError =
+    Error<ErrUndefinedVariable, ErrUndefinedLine, ErrDivByZero, ErrExpByNeg, ErrOverflow, ErrTerminate, ErrWorkerLost,
+          ErrInvalidInput, ErrQuotaExceeded, ErrNextWithoutFor, ErrForWithoutNext, ErrIndexOutOfRange,
+          ErrInvalidArraySize, MsgPrint, MsgEndOfProgram, MsgRequestInput, MsgBreakpoint, MsgWatchpoint, MsgStep>;
 
 template <typename Type, typename ErrorType> class Result {
 private:
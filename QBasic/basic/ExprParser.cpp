@@ -36,6 +36,12 @@ ParseResult<std::unique_ptr<Expression>> Expression::Parse(std::span<const Token
 			});
 		}
 
+		// a name followed by '(' is an array element, its index is the bracketed expression
+		std::vector<bool> token_is_index(tokens.size());
+		for (std::size_t i = 0; i + 1 < tokens.size(); ++i)
+			if (!token_is_operator[i] && tokens[i].IsVariable() && tokens[i + 1].GetView().front() == '(')
+				token_is_operator[i] = token_is_index[i] = true;
+
 		// determine whether the operators are binary or unary
 		std::vector<bool> token_is_unary_operator(tokens.size());
 		for (std::size_t i = 0; i < tokens.size(); ++i) {
@@ -45,6 +51,10 @@ ParseResult<std::unique_ptr<Expression>> Expression::Parse(std::span<const Token
 
 		// create token expressions, detect invalid expressions
 		for (std::size_t i = 0; i < tokens.size(); ++i) {
+			if (token_is_index[i]) {
+				token_exprs[i] = std::make_unique<Expression>(ExprIndex{.var = tokens[i].GetString()});
+				continue;
+			}
 			// match expression
 			foreach_expr([&](auto &&expr) -> bool {
 				using Expr = std::decay_t<decltype(expr)>;
@@ -9,23 +9,43 @@ RuntimeResult<Int> ExprVar::Eval(const Context &context) const {
 	BASIC_UNWRAP_ASSIGN(v, context.ReadVariable(var));
 	return v;
 }
+RuntimeResult<Int> ExprIndex::Eval(const Context &context, Int index) const { return context.ReadElement(var, index); }
 RuntimeResult<Int> ExprDiv::Eval(Int l, Int r) const {
 	if (r == 0)
 		return ErrDivByZero{.zero_expr_str = right->Format()};
+	// MIN / -1 overflows
+	if (r == -1)
+		return IntArith::Neg(l);
 	return l / r;
 }
 RuntimeResult<Int> ExprMod::Eval(Int l, Int r) const {
 	if (r == 0)
 		return ErrDivByZero{.zero_expr_str = right->Format()};
-	return (r + (l % r)) % r;
+	// MIN % -1 overflows
+	if (r == -1)
+		return 0;
+	// the sign of r, m + r can't overflow as their signs differ
+	Int m = l % r;
+	return m != 0 && (m < 0) != (r < 0) ? m + r : m;
 }
-inline static Int fast_pow(Int a, Int b) {
+inline static RuntimeResult<Int> fast_pow(Int a, Int b) {
+	if (!kCheckedInt) {
+		UInt res = 1, base = UInt(a);
+		for (; b > 0; b >>= 1) {
+			if (b & 1)
+				res *= base;
+			base *= base;
+		}
+		return Int(res);
+	}
 	Int res = 1;
 	while (b > 0) {
 		if (b & 1)
-			res *= a;
-		a *= a;
+			BASIC_UNWRAP_ASSIGN(res, IntArith::Mul(res, a));
 		b >>= 1;
+		// the last square is not used, it may overflow
+		if (b > 0)
+			BASIC_UNWRAP_ASSIGN(a, IntArith::Mul(a, a));
 	}
 	return res;
 }
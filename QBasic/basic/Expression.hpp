@@ -7,12 +7,48 @@
 
 #include "Config.hpp"
 #include "Error.hpp"
+#include "Profiler.hpp"
 #include "Token.hpp"
 
 namespace basic {
 
 class Context;
 
+// Integer operations, wrapping around or checked depending on the width (see Config.hpp)
+struct IntArith {
+	inline static RuntimeResult<Int> Add(Int l, Int r) {
+		Int ret;
+		if (!kCheckedInt)
+			return Int(UInt(l) + UInt(r));
+		if (__builtin_add_overflow(l, r, &ret))
+			return ErrOverflow{.operation_str = IntToString(l) + " + " + IntToString(r)};
+		return ret;
+	}
+	inline static RuntimeResult<Int> Sub(Int l, Int r) {
+		Int ret;
+		if (!kCheckedInt)
+			return Int(UInt(l) - UInt(r));
+		if (__builtin_sub_overflow(l, r, &ret))
+			return ErrOverflow{.operation_str = IntToString(l) + " - " + IntToString(r)};
+		return ret;
+	}
+	inline static RuntimeResult<Int> Mul(Int l, Int r) {
+		Int ret;
+		if (!kCheckedInt)
+			return Int(UInt(l) * UInt(r));
+		if (__builtin_mul_overflow(l, r, &ret))
+			return ErrOverflow{.operation_str = IntToString(l) + " * " + IntToString(r)};
+		return ret;
+	}
+	inline static RuntimeResult<Int> Neg(Int v) {
+		if (!kCheckedInt)
+			return Int(-UInt(v));
+		if (v == kIntMin)
+			return ErrOverflow{.operation_str = "-" + IntToString(v)};
+		return -v;
+	}
+};
+
 enum class ExpressionType { kOperand, kUnary, kBinary };
 enum class ExpressionAsso { kLeft, kRight };
 
@@ -42,7 +78,7 @@ struct ExprNum {
 
 	Int value;
 	inline RuntimeResult<Int> Eval(const Context &context) const { return value; }
-	inline String Format() const { return std::to_string(value); }
+	inline String Format() const { return IntToString(value); }
 };
 struct ExprVar {
 	inline static constexpr ExpressionType kType = ExpressionType::kOperand;
@@ -55,15 +91,15 @@ struct ExprVar {
 };
 struct ExprSub {
 	BASIC_OPERATOR_BINARY("-", 0, kLeft)
-	inline static RuntimeResult<Int> Eval(Int l, Int r) { return l - r; }
+	inline static RuntimeResult<Int> Eval(Int l, Int r) { return IntArith::Sub(l, r); }
 };
 struct ExprNeg {
 	BASIC_OPERATOR_UNARY("-", 30)
-	inline static RuntimeResult<Int> Eval(Int v) { return -v; }
+	inline static RuntimeResult<Int> Eval(Int v) { return IntArith::Neg(v); }
 };
 struct ExprAdd {
 	BASIC_OPERATOR_BINARY("+", 0, kLeft)
-	inline static RuntimeResult<Int> Eval(Int l, Int r) { return l + r; }
+	inline static RuntimeResult<Int> Eval(Int l, Int r) { return IntArith::Add(l, r); }
 };
 struct ExprPos {
 	BASIC_OPERATOR_UNARY("+", 30)
@@ -71,7 +107,7 @@ struct ExprPos {
 };
 struct ExprMul {
 	BASIC_OPERATOR_BINARY("*", 10, kLeft)
-	inline static RuntimeResult<Int> Eval(Int l, Int r) { return l * r; }
+	inline static RuntimeResult<Int> Eval(Int l, Int r) { return IntArith::Mul(l, r); }
 };
 struct ExprDiv {
 	BASIC_OPERATOR_BINARY("/", 10, kLeft)
@@ -89,36 +125,62 @@ struct ExprExp {
 #undef BASIC_OPERATOR_UNARY
 #undef BASIC_OPERATOR_BINARY
 
+// element of an array, applied by the parser to the bracketed index following the array's name
+struct ExprIndex {
+	inline static constexpr ExpressionType kType = ExpressionType::kUnary;
+	inline static constexpr const char *kSymbol = "()"; // never a token
+	inline static constexpr int kPrecedence = 40;
+
+	String var;
+	std::unique_ptr<Expression> child;
+	RuntimeResult<Int> Eval(const Context &context, Int index) const;
+};
+
 class Expression {
 private:
-	using Variant =
-	    std::variant<ExprNum, ExprAdd, ExprPos, ExprSub, ExprNeg, ExprMul, ExprDiv, ExprMod, ExprExp, ExprVar>;
+	using Variant = std::variant<ExprNum, ExprAdd, ExprPos, ExprSub, ExprNeg, ExprMul, ExprDiv, ExprMod, ExprExp,
+	                             ExprIndex, ExprVar>;
 	// ExprVar should be placed at last to be the last one to be matched
 	Variant m_expr;
 
-public:
-	template <typename T> inline Expression(T &&expr) : m_expr{std::forward<T>(expr)} {}
-
-	static ParseResult<std::unique_ptr<Expression>> Parse(std::span<const Token> tokens);
-
-	inline RuntimeResult<Int> Eval(const Context &context) const {
-		return std::visit(
-		    [&context](const auto &expr) -> RuntimeResult<Int> {
+	template <bool kProfile> inline RuntimeResult<Int> eval(const Context &context, ProfileProbe *p_probe) const {
+		const Expression *p_parent{};
+		if constexpr (kProfile)
+			p_parent = p_probe->Enter(this);
+		auto ret = std::visit(
+		    [&context, p_probe](const auto &expr) -> RuntimeResult<Int> {
 			    using Expr = std::decay_t<decltype(expr)>;
 			    if constexpr (Expr::kType == ExpressionType::kOperand)
 				    return expr.Eval(context);
 			    else if constexpr (Expr::kType == ExpressionType::kUnary) {
 				    Int v;
-				    BASIC_UNWRAP_ASSIGN(v, expr.child->Eval(context));
-				    return expr.Eval(v);
+				    BASIC_UNWRAP_ASSIGN(v, expr.child->template eval<kProfile>(context, p_probe));
+				    if constexpr (std::is_same_v<Expr, ExprIndex>)
+					    return expr.Eval(context, v);
+				    else
+					    return expr.Eval(v);
 			    } else {
 				    Int l, r;
-				    BASIC_UNWRAP_ASSIGN(l, expr.left->Eval(context));
-				    BASIC_UNWRAP_ASSIGN(r, expr.right->Eval(context));
+				    BASIC_UNWRAP_ASSIGN(l, expr.left->template eval<kProfile>(context, p_probe));
+				    BASIC_UNWRAP_ASSIGN(r, expr.right->template eval<kProfile>(context, p_probe));
 				    return expr.Eval(l, r);
 			    }
 		    },
 		    m_expr);
+		if constexpr (kProfile)
+			p_probe->Leave(p_parent);
+		return ret;
+	}
+
+public:
+	template <typename T> inline Expression(T &&expr) : m_expr{std::forward<T>(expr)} {}
+
+	static ParseResult<std::unique_ptr<Expression>> Parse(std::span<const Token> tokens);
+
+	// the profiler probe of the thread (if any) tracks the innermost expression being evaluated
+	inline RuntimeResult<Int> Eval(const Context &context) const {
+		ProfileProbe *p_probe = ProfileProbe::GetCurrent();
+		return p_probe ? eval<true>(context, p_probe) : eval<false>(context, nullptr);
 	}
 	inline String Format() const {
 		return std::visit(
@@ -126,6 +188,8 @@ public:
 			    using Expr = std::decay_t<decltype(expr)>;
 			    if constexpr (Expr::kType == ExpressionType::kOperand)
 				    return expr.Format();
+			    else if constexpr (std::is_same_v<Expr, ExprIndex>)
+				    return expr.var + '(' + expr.child->Format() + ')';
 			    else if constexpr (Expr::kType == ExpressionType::kUnary) {
 				    String cs = expr.child->Format();
 				    if (expr.child->GetPrecedence() < Expr::kPrecedence)
@@ -155,6 +219,8 @@ public:
 			    using Expr = std::decay_t<decltype(expr)>;
 			    if constexpr (Expr::kType == ExpressionType::kOperand)
 				    return align + expr.Format() + "\n";
+			    else if constexpr (std::is_same_v<Expr, ExprIndex>)
+				    return align + expr.var + "()\n" + expr.child->FormatAST(align + kASTFormatAlign);
 			    else if constexpr (Expr::kType == ExpressionType::kUnary)
 				    return align + Expr::kSymbol + "\n" + expr.child->FormatAST(align + kASTFormatAlign);
 			    else
@@ -163,6 +229,19 @@ public:
 		    },
 		    m_expr);
 	}
+	inline Count GetNodeCount() const {
+		return std::visit(
+		    [](const auto &expr) -> Count {
+			    using Expr = std::decay_t<decltype(expr)>;
+			    if constexpr (Expr::kType == ExpressionType::kOperand)
+				    return 1;
+			    else if constexpr (Expr::kType == ExpressionType::kUnary)
+				    return 1 + expr.child->GetNodeCount();
+			    else
+				    return 1 + expr.left->GetNodeCount() + expr.right->GetNodeCount();
+		    },
+		    m_expr);
+	}
 	inline int GetPrecedence() const {
 		return std::visit(
 		    [](const auto &expr) {
@@ -174,6 +253,14 @@ public:
 		    },
 		    m_expr);
 	}
+	template <typename Visitor> inline decltype(auto) Visit(Visitor &&visitor) const {
+		return std::visit(std::forward<Visitor>(visitor), m_expr);
+	}
+	// moves the index out of an array element, nullptr for other expressions
+	inline std::unique_ptr<Expression> ReleaseIndex() {
+		auto p_index = std::get_if<ExprIndex>(&m_expr);
+		return p_index ? std::move(p_index->child) : nullptr;
+	}
 	inline ExpressionAsso GetAssociative() const {
 		return std::visit(
 		    [](const auto &expr) -> ExpressionAsso {
@@ -0,0 +1,117 @@
+#include "History.hpp"
+
+#include <algorithm>
+
+namespace basic {
+
+History::History(uint64_t interval, std::size_t max_snapshots)
+    : m_interval{std::max<uint64_t>(interval, 1)}, m_max_snapshots{std::max<std::size_t>(max_snapshots, 2)} {}
+
+void History::Reset() {
+	m_next_step = 0;
+	m_snapshots.clear();
+	m_inputs.clear();
+}
+
+void History::take_snapshot(const Context &context) {
+	m_snapshots.push_back(
+	    {.step = context.GetStepCount(), .input_count = m_inputs.size(), .context = context.Fork()});
+	if (m_snapshots.size() > m_max_snapshots) {
+		// thin out, keeping the first one
+		std::size_t size = 1;
+		for (std::size_t i = 2; i < m_snapshots.size(); i += 2)
+			m_snapshots[size++] = std::move(m_snapshots[i]);
+		m_snapshots.resize(size);
+		m_interval *= 2;
+	}
+	m_next_step = m_snapshots.back().step + m_interval;
+}
+
+RuntimeResult<std::unique_ptr<Context>> History::replay(const Program &program, const Context &current,
+                                                        std::size_t snapshot_id, uint64_t target_step,
+                                                        const std::function<void(const Context &)> &on_step,
+                                                        std::size_t *p_input_count) const {
+	const Snapshot &snapshot = m_snapshots[snapshot_id];
+	auto context = snapshot.context->Fork();
+
+	// the inputs consumed since the snapshot, then the ones still pending
+	context->ClearInputs();
+	for (std::size_t i = snapshot.input_count; i < m_inputs.size(); ++i)
+		context->PushInput(m_inputs[i]);
+	for (auto inputs = current.GetInputs(); !inputs.empty(); inputs.pop())
+		context->PushInput(inputs.front());
+
+	std::vector<String> consumed_inputs;
+	context->SetInputLog(&consumed_inputs);
+	while (context->GetStepCount() < target_step) {
+		if (on_step)
+			on_step(*context);
+		auto run_res = program.Step(context.get());
+		if (run_res.IsOK())
+			continue;
+		auto error = run_res.PopError();
+		bool print = false;
+		error.Visit([&print](const auto &error) { print = std::is_same_v<std::decay_t<decltype(error)>, MsgPrint>; });
+		if (!print)
+			return error;
+	}
+	// already shown when recorded
+	context->PopOutputs();
+	context->SetInputLog(nullptr);
+
+	if (p_input_count)
+		*p_input_count = snapshot.input_count + consumed_inputs.size();
+	return context;
+}
+
+RuntimeResult<std::unique_ptr<Context>> History::Rewind(const Program &program, const Context &current,
+                                                        uint64_t target_step) {
+	target_step = std::min(target_step, current.GetStepCount());
+	auto it = std::upper_bound(m_snapshots.begin(), m_snapshots.end(), target_step,
+	                           [](uint64_t step, const Snapshot &snapshot) { return step < snapshot.step; });
+	if (it == m_snapshots.begin())
+		return std::unique_ptr<Context>{};
+	std::size_t snapshot_id = it - m_snapshots.begin() - 1, input_count;
+
+	std::unique_ptr<Context> context;
+	BASIC_UNWRAP_ASSIGN(context, replay(program, current, snapshot_id, target_step, nullptr, &input_count));
+
+	// continuing from the target re-records what follows
+	m_snapshots.resize(snapshot_id + 1);
+	m_inputs.resize(input_count);
+	m_next_step = m_snapshots.back().step + m_interval;
+	return context;
+}
+
+std::optional<uint64_t> History::FindLastWrite(const Program &program, const Context &current,
+                                               const String &var) const {
+	const auto is_write = [&program, &var](const Context &context) {
+		auto stmt_res = program.GetStatement(context.GetLine());
+		if (stmt_res.IsError())
+			return false;
+		const String *p_var = stmt_res.PopValue()->GetVariable();
+		return p_var && *p_var == var;
+	};
+
+	// search the intervals between snapshots backwards
+	uint64_t end_step = current.GetStepCount();
+	for (std::size_t i = m_snapshots.size(); i-- > 0; end_step = m_snapshots[i].step) {
+		if (m_snapshots[i].step >= end_step)
+			continue;
+		std::optional<uint64_t> opt_step;
+		auto replay_res = replay(
+		    program, current, i, end_step,
+		    [&is_write, &opt_step](const Context &context) {
+			    if (is_write(context))
+				    opt_step = context.GetStepCount();
+		    },
+		    nullptr);
+		if (replay_res.IsError())
+			return std::nullopt;
+		if (opt_step.has_value())
+			return opt_step;
+	}
+	return std::nullopt;
+}
+
+} // namespace basic
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Context.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace basic {
+
+// Records a run for reverse execution. Execution is deterministic given its inputs, so the history only keeps
+// snapshots (O(1) context forks) every interval statements and the inputs consumed, and goes back by re-executing
+// from the nearest snapshot. When the snapshots exceed the limit, every other one is dropped and the interval doubles,
+// so memory stays bounded and a backward step never re-executes more than about run length / (limit / 2) statements.
+// Positions are step counts of the context (Context::GetStepCount).
+class History {
+private:
+	struct Snapshot {
+		uint64_t step;
+		std::size_t input_count; // inputs consumed before it
+		std::unique_ptr<Context> context;
+	};
+
+	uint64_t m_interval, m_next_step{};
+	std::size_t m_max_snapshots;
+	std::vector<Snapshot> m_snapshots; // ascending steps
+	std::vector<String> m_inputs;
+
+	void take_snapshot(const Context &context);
+	// re-execute from a snapshot to the target step, on_step is called before each statement
+	RuntimeResult<std::unique_ptr<Context>> replay(const Program &program, const Context &current,
+	                                              std::size_t snapshot_id, uint64_t target_step,
+	                                              const std::function<void(const Context &)> &on_step,
+	                                              std::size_t *p_input_count) const;
+
+public:
+	explicit History(uint64_t interval = kHistoryInterval, std::size_t max_snapshots = kHistoryMaxSnapshots);
+	History(const History &) = delete;
+	History &operator=(const History &) = delete;
+
+	void Reset();
+
+	// before each statement of the recorded context, which also logs its inputs here (Context::SetInputLog)
+	inline void Record(const Context &context) {
+		if (context.GetStepCount() >= m_next_step)
+			take_snapshot(context);
+	}
+	inline std::vector<String> *GetInputLog() { return &m_inputs; }
+	inline std::size_t GetSnapshotCount() const { return m_snapshots.size(); }
+	inline uint64_t GetInterval() const { return m_interval; }
+
+	// context of the recorded run before the target step (not after current), the history after it is discarded.
+	// Returns nullptr if the target is before the recording.
+	RuntimeResult<std::unique_ptr<Context>> Rewind(const Program &program, const Context &current,
+	                                               uint64_t target_step);
+	// step of the last statement writing var before current, std::nullopt if none was recorded
+	std::optional<uint64_t> FindLastWrite(const Program &program, const Context &current, const String &var) const;
+};
+
+} // namespace basic
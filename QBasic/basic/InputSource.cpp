@@ -0,0 +1,70 @@
+#include "InputSource.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace basic {
+
+InputSource::InputSource(String buffer) : m_eof{true}, m_buffer{std::move(buffer)}, m_end{m_buffer.size()} {}
+
+InputSource::InputSource(int fd, bool owned) : m_fd{fd}, m_owned{owned}, m_buffer(kChunkSize, '\0') {}
+
+InputSource::~InputSource() {
+	if (m_owned)
+		close(m_fd);
+}
+
+std::unique_ptr<InputSource> InputSource::Open(const String &filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return nullptr;
+	return std::make_unique<InputSource>(fd, true);
+}
+
+void InputSource::fill() {
+	// keep the partial line at the front, grow only if it fills the buffer
+	if (m_begin) {
+		memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+		m_end -= m_begin;
+		m_begin = 0;
+	}
+	if (m_end == m_buffer.size())
+		m_buffer.resize(m_buffer.size() * 2);
+	while (true) {
+		auto count = read(m_fd, m_buffer.data() + m_end, (unsigned)(m_buffer.size() - m_end));
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			m_eof = true;
+		else
+			m_end += count;
+		return;
+	}
+}
+
+std::optional<StringView> InputSource::NextLine() {
+	while (true) {
+		const char *p_begin = m_buffer.data() + m_begin;
+		auto p_newline = (const char *)memchr(p_begin, '\n', m_end - m_begin);
+		if (p_newline) {
+			m_begin = p_newline + 1 - m_buffer.data();
+			return StringView{p_begin, p_newline};
+		}
+		if (m_eof) {
+			if (m_begin == m_end)
+				return std::nullopt;
+			StringView last{p_begin, m_end - m_begin};
+			m_begin = m_end;
+			return last;
+		}
+		fill();
+	}
+}
+
+} // namespace basic
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Config.hpp"
+
+#include <memory>
+#include <optional>
+
+namespace basic {
+
+// Lines for INPUT read in bulk from a file, a pipe or a memory buffer. A line is a view into the buffer, so reading
+// one doesn't allocate once the buffer has grown to the longest line. Reads return what is available, so a pipe
+// feeding the lines one by one works too.
+class InputSource {
+private:
+	inline static constexpr std::size_t kChunkSize = 1 << 16;
+
+	int m_fd{-1};
+	bool m_owned{}, m_eof{};
+	String m_buffer;
+	std::size_t m_begin{}, m_end{};
+
+	void fill();
+
+public:
+	explicit InputSource(String buffer);
+	// the file descriptor is closed with the source if owned
+	InputSource(int fd, bool owned);
+	~InputSource();
+	InputSource(const InputSource &) = delete;
+	InputSource &operator=(const InputSource &) = delete;
+
+	// nullptr if the file can't be opened
+	static std::unique_ptr<InputSource> Open(const String &filename);
+
+	// the next line without its '\n', valid until the next call, nullopt after the last one
+	std::optional<StringView> NextLine();
+};
+
+} // namespace basic
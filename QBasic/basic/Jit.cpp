@@ -0,0 +1,288 @@
+#include "Jit.hpp"
+
+#include "Context.hpp"
+#include "Expression.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__unix__) && !defined(BASIC_NO_JIT) && BASIC_INT_BITS == 64
+#define BASIC_JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+namespace basic {
+
+static JitMode get_env_mode() {
+	const char *env = std::getenv("QBASIC_JIT");
+	if (env == nullptr)
+		return JitMode::kEnabled;
+	if (strcmp(env, "0") == 0)
+		return JitMode::kDisabled;
+	if (strcmp(env, "diff") == 0)
+		return JitMode::kDifferential;
+	return JitMode::kEnabled;
+}
+std::atomic<JitMode> Jit::s_mode{get_env_mode()};
+
+// Stack machine on the native stack: operands are pushed, operators pop into rax (left) and rcx (right).
+// Signature: int func(const Int *vars [rdi], Int *p_out [rsi]), returns 0 on success, 1 to exit to the interpreter.
+class JitCode::Assembler {
+private:
+	std::vector<uint8_t> m_bytes;
+	std::vector<std::size_t> m_exit_fixups;
+
+	inline void emit(std::initializer_list<uint8_t> bytes) { m_bytes.insert(m_bytes.end(), bytes); }
+	template <typename T> inline void emit_value(T value) {
+		uint8_t bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+		m_bytes.insert(m_bytes.end(), bytes, bytes + sizeof(T));
+	}
+	// jcc rel32 to the exit label
+	inline void emit_exit_jump(uint8_t opcode) {
+		emit({0x0f, opcode});
+		m_exit_fixups.push_back(m_bytes.size());
+		emit_value<int32_t>(0);
+	}
+
+public:
+	inline Assembler() { emit({0x55, 0x48, 0x89, 0xe5}); } // push rbp; mov rbp, rsp
+
+	inline void PushNum(Int value) {
+		emit({0x48, 0xb8}); // mov rax, imm64
+		emit_value<int64_t>(value);
+		emit({0x50}); // push rax
+	}
+	inline void PushVar(uint32_t slot) {
+		emit({0x48, 0x8b, 0x87}); // mov rax, [rdi + disp32]
+		emit_value<int32_t>(int32_t(slot * sizeof(Int)));
+		emit({0x50}); // push rax
+	}
+	// the element of the array in slots [base, base + 1] at the popped index, exits if out of range
+	inline void Index(uint32_t base) {
+		emit({0x59, 0x48, 0x8b, 0x87}); // pop rcx; mov rax, [rdi + disp32] (size)
+		emit_value<int32_t>(int32_t((base + 1) * sizeof(Int)));
+		emit({0x48, 0x39, 0xc1}); // cmp rcx, rax
+		emit_exit_jump(0x83);     // jae exit (unsigned, so a negative index too)
+		emit({0x48, 0x8b, 0x87}); // mov rax, [rdi + disp32] (data)
+		emit_value<int32_t>(int32_t(base * sizeof(Int)));
+		emit({0x48, 0x8b, 0x04, 0xc8, 0x50}); // mov rax, [rax + rcx * 8]; push rax
+	}
+	inline void Neg() { emit({0x58, 0x48, 0xf7, 0xd8, 0x50}); } // pop rax; neg rax; push rax
+	inline void PopOperands() { emit({0x59, 0x58}); }           // pop rcx; pop rax
+	inline void Add() { emit({0x48, 0x01, 0xc8, 0x50}); }       // add rax, rcx; push rax
+	inline void Sub() { emit({0x48, 0x29, 0xc8, 0x50}); }       // sub rax, rcx; push rax
+	inline void Mul() { emit({0x48, 0x0f, 0xaf, 0xc1, 0x50}); } // imul rax, rcx; push rax
+	inline void Div() {
+		emit({0x48, 0x85, 0xc9});                // test rcx, rcx
+		emit_exit_jump(0x84);                    // jz exit
+		emit({0x48, 0x83, 0xf9, 0xff});          // cmp rcx, -1 (idiv traps on MIN / -1)
+		emit_exit_jump(0x84);                    // je exit
+		emit({0x48, 0x99, 0x48, 0xf7, 0xf9, 0x50}); // cqo; idiv rcx; push rax
+	}
+	inline void Mod() {
+		emit({0x48, 0x85, 0xc9});       // test rcx, rcx
+		emit_exit_jump(0x84);           // jz exit
+		emit({0x48, 0x83, 0xf9, 0xff}); // cmp rcx, -1
+		emit_exit_jump(0x84);           // je exit
+		emit({0x48, 0x99, 0x48, 0xf7, 0xf9,       // cqo; idiv rcx
+		      0x48, 0x85, 0xd2, 0x74, 0x0b,       // test rdx, rdx; jz done
+		      0x48, 0x89, 0xd0, 0x48, 0x31, 0xc8, // mov rax, rdx; xor rax, rcx
+		      0x79, 0x03,                         // jns done (same signs)
+		      0x48, 0x01, 0xca,                   // add rdx, rcx
+		      0x52});                             // done: push rdx
+	}
+	inline void Exp() {
+		emit({0x48, 0x85, 0xc9}); // test rcx, rcx
+		emit_exit_jump(0x88);     // js exit
+		emit({0x48, 0xc7, 0xc2, 0x01, 0x00, 0x00, 0x00, // mov rdx, 1
+		      0x48, 0x85, 0xc9, 0x7e, 0x12,             // loop: test rcx, rcx; jle done
+		      0xf6, 0xc1, 0x01, 0x74, 0x04,             // test cl, 1; jz skip
+		      0x48, 0x0f, 0xaf, 0xd0,                   // imul rdx, rax
+		      0x48, 0x0f, 0xaf, 0xc0,                   // skip: imul rax, rax
+		      0x48, 0xd1, 0xf9, 0xeb, 0xe9,             // sar rcx, 1; jmp loop
+		      0x52});                                   // done: push rdx
+	}
+	inline void Compare(Char cmp) {
+		emit({0x59, 0x58, 0x48, 0x39, 0xc8}); // pop rcx; pop rax; cmp rax, rcx
+		emit({0x0f, uint8_t(cmp == '<' ? 0x9c : (cmp == '=' ? 0x94 : 0x9f)), 0xc0}); // setl/sete/setg al
+		emit({0x0f, 0xb6, 0xc0, 0x50});                                               // movzx eax, al; push rax
+	}
+	inline std::vector<uint8_t> Finish() {
+		emit({0x58, 0x48, 0x89, 0x06});             // pop rax; mov [rsi], rax
+		emit({0x48, 0x89, 0xec, 0x5d, 0x31, 0xc0, 0xc3}); // mov rsp, rbp; pop rbp; xor eax, eax; ret
+		for (std::size_t fixup : m_exit_fixups) {
+			auto rel = int32_t(m_bytes.size() - (fixup + 4));
+			memcpy(m_bytes.data() + fixup, &rel, sizeof(rel));
+		}
+		emit({0x48, 0x89, 0xec, 0x5d, 0xb8, 0x01, 0x00, 0x00, 0x00, 0xc3}); // exit: ...; mov eax, 1; ret
+		return std::move(m_bytes);
+	}
+};
+
+std::unique_ptr<JitCode> JitCode::compile(const Expression *p_expr_l, Char cmp, const Expression *p_expr_r) {
+#ifdef BASIC_JIT_X86_64
+	if constexpr (sizeof(Int) != 8)
+		return nullptr;
+
+	auto code = std::make_unique<JitCode>();
+	Assembler assembler;
+	bool supported = true;
+
+	const auto emit_expr = [&](const Expression &expression, const auto &emit_expr) -> void {
+		expression.Visit([&](const auto &expr) {
+			using Expr = std::decay_t<decltype(expr)>;
+			if constexpr (std::is_same_v<Expr, ExprNum>)
+				assembler.PushNum(expr.value);
+			else if constexpr (std::is_same_v<Expr, ExprVar>) {
+				auto it = std::find(code->m_vars.begin(), code->m_vars.end(), expr.var);
+				if (it == code->m_vars.end()) {
+					if (code->m_vars.size() == kMaxVariables) {
+						supported = false;
+						return;
+					}
+					code->m_vars.push_back(expr.var);
+					code->m_var_uses.push_back(0);
+					it = code->m_vars.end() - 1;
+				}
+				auto slot = uint32_t(it - code->m_vars.begin());
+				++code->m_var_uses[slot];
+				assembler.PushVar(slot);
+			} else if constexpr (std::is_same_v<Expr, ExprIndex>) {
+				auto it = std::find(code->m_arrays.begin(), code->m_arrays.end(), expr.var);
+				if (it == code->m_arrays.end()) {
+					if (code->m_arrays.size() == kMaxArrays) {
+						supported = false;
+						return;
+					}
+					code->m_arrays.push_back(expr.var);
+					code->m_array_uses.push_back(0);
+					it = code->m_arrays.end() - 1;
+				}
+				auto id = uint32_t(it - code->m_arrays.begin());
+				++code->m_array_uses[id];
+				emit_expr(*expr.child, emit_expr);
+				assembler.Index(uint32_t(kMaxVariables + 2 * id));
+			} else if constexpr (Expr::kType == ExpressionType::kUnary) {
+				emit_expr(*expr.child, emit_expr);
+				if constexpr (std::is_same_v<Expr, ExprNeg>)
+					assembler.Neg();
+			} else {
+				emit_expr(*expr.left, emit_expr);
+				emit_expr(*expr.right, emit_expr);
+				assembler.PopOperands();
+				if constexpr (std::is_same_v<Expr, ExprAdd>)
+					assembler.Add();
+				else if constexpr (std::is_same_v<Expr, ExprSub>)
+					assembler.Sub();
+				else if constexpr (std::is_same_v<Expr, ExprMul>)
+					assembler.Mul();
+				else if constexpr (std::is_same_v<Expr, ExprDiv>)
+					assembler.Div();
+				else if constexpr (std::is_same_v<Expr, ExprMod>)
+					assembler.Mod();
+				else if constexpr (std::is_same_v<Expr, ExprExp>)
+					assembler.Exp();
+				else
+					supported = false;
+			}
+		});
+	};
+	emit_expr(*p_expr_l, emit_expr);
+	if (p_expr_r) {
+		emit_expr(*p_expr_r, emit_expr);
+		assembler.Compare(cmp);
+	}
+	if (!supported)
+		return nullptr;
+
+	std::vector<uint8_t> bytes = assembler.Finish();
+	code->m_size = bytes.size();
+	code->m_memory = mmap(nullptr, code->m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code->m_memory == MAP_FAILED) {
+		code->m_memory = nullptr;
+		return nullptr;
+	}
+	memcpy(code->m_memory, bytes.data(), bytes.size());
+	if (mprotect(code->m_memory, code->m_size, PROT_READ | PROT_EXEC) != 0)
+		return nullptr;
+
+	code->m_expr_l = p_expr_l;
+	code->m_expr_r = p_expr_r;
+	code->m_cmp = cmp;
+	return code;
+#else
+	return nullptr;
+#endif
+}
+
+JitCode::~JitCode() {
+#ifdef BASIC_JIT_X86_64
+	if (m_memory)
+		munmap(m_memory, m_size);
+#endif
+}
+
+bool JitCode::Run(Context *p_context, Int *p_out) const {
+	Int vars[kMaxVariables + 2 * kMaxArrays];
+	for (std::size_t i = 0; i < m_vars.size(); ++i) {
+		const Int *p_value = p_context->FindVariable(m_vars[i]);
+		if (p_value == nullptr)
+			return false;
+		vars[i] = *p_value;
+	}
+	for (std::size_t i = 0; i < m_arrays.size(); ++i) {
+		const std::vector<Int> *p_array = p_context->FindArray(m_arrays[i]);
+		if (p_array == nullptr)
+			return false;
+		vars[kMaxVariables + 2 * i] = Int(reinterpret_cast<intptr_t>(p_array->data()));
+		vars[kMaxVariables + 2 * i + 1] = Int(p_array->size());
+	}
+	if (reinterpret_cast<Func>(m_memory)(vars, p_out) != 0)
+		return false;
+
+	if (Jit::GetMode() == JitMode::kDifferential)
+		verify(*p_context, *p_out);
+
+	for (std::size_t i = 0; i < m_vars.size(); ++i)
+		p_context->AddVariableStat(m_vars[i], m_var_uses[i]);
+	for (std::size_t i = 0; i < m_arrays.size(); ++i)
+		p_context->AddArrayStat(m_arrays[i], m_array_uses[i]);
+	return true;
+}
+
+void JitCode::verify(const Context &context, Int value) const {
+	// evaluate on a fork so that the statistics are not counted twice, an interpreter error is a divergence too
+	auto fork = context.Fork();
+	auto l_res = m_expr_l->Eval(*fork);
+	bool ok = l_res.IsOK();
+	Int expected = ok ? l_res.PopValue() : 0;
+	if (ok && m_expr_r) {
+		auto r_res = m_expr_r->Eval(*fork);
+		ok = r_res.IsOK();
+		Int r = ok ? r_res.PopValue() : 0;
+		expected = m_cmp == '<' ? expected < r : (m_cmp == '=' ? expected == r : expected > r);
+	}
+	if (!ok || expected != value) {
+		fprintf(stderr, "JIT divergence at line %u: compiled %lld, interpreted %s\n", context.GetLine(),
+		        (long long)value, ok ? IntToString(expected).c_str() : "error");
+		std::abort();
+	}
+}
+
+bool JitSlot::is_hot(const Context &context) { return context.GetLineStat(context.GetLine()) >= Jit::GetThreshold(); }
+
+JitCode *JitSlot::publish(std::unique_ptr<JitCode> code) const {
+	if (code == nullptr) {
+		m_failed.store(true, std::memory_order_relaxed);
+		return nullptr;
+	}
+	JitCode *p_expected = nullptr;
+	if (m_code.compare_exchange_strong(p_expected, code.get(), std::memory_order_acq_rel))
+		return code.release();
+	return p_expected; // compiled by another thread
+}
+
+} // namespace basic
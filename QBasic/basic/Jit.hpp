@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Config.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace basic {
+
+class Context;
+class Expression;
+
+enum class JitMode { kDisabled, kEnabled, kDifferential };
+
+// Template JIT for hot LET and IF lines (x86-64 only). Once a line has executed GetThreshold() times, its
+// expressions are compiled to machine code in an mmap'd buffer. Compiled code exits to the interpreter on any
+// error path (undefined variable, division by zero, negative exponent, index out of range), which then reports the
+// error as usual. The mode defaults to the QBASIC_JIT environment variable: "0" disables it (kill switch), "diff"
+// runs the interpreter alongside and aborts on any divergence.
+class Jit {
+private:
+	static std::atomic<JitMode> s_mode;
+	inline static std::atomic<Count> s_threshold{kJitThreshold};
+
+public:
+	inline static JitMode GetMode() { return s_mode.load(std::memory_order_relaxed); }
+	inline static void SetMode(JitMode mode) { s_mode.store(mode, std::memory_order_relaxed); }
+	// executions of a line before it is compiled, lowered by tests to compile short runs
+	inline static Count GetThreshold() { return s_threshold.load(std::memory_order_relaxed); }
+	inline static void SetThreshold(Count threshold) { s_threshold.store(threshold, std::memory_order_relaxed); }
+};
+
+class JitCode {
+private:
+	using Func = int (*)(const Int *vars, Int *p_out);
+
+	void *m_memory{};
+	std::size_t m_size{};
+	std::vector<String> m_vars, m_arrays;
+	std::vector<Count> m_var_uses, m_array_uses;
+
+	// for differential mode, owned by the same statement
+	const Expression *m_expr_l{}, *m_expr_r{};
+	Char m_cmp{};
+
+	// each array takes two slots after the variables: its data pointer and its size
+	inline static constexpr std::size_t kMaxVariables = 16, kMaxArrays = 4;
+
+	class Assembler;
+	static std::unique_ptr<JitCode> compile(const Expression *p_expr_l, Char cmp, const Expression *p_expr_r);
+	void verify(const Context &context, Int value) const;
+
+public:
+	JitCode() = default;
+	JitCode(const JitCode &) = delete;
+	JitCode &operator=(const JitCode &) = delete;
+	~JitCode();
+
+	// nullptr if the expression is not supported on this platform
+	inline static std::unique_ptr<JitCode> CompileLet(const Expression &expr) { return compile(&expr, 0, nullptr); }
+	inline static std::unique_ptr<JitCode> CompileIf(const Expression &expr_l, Char cmp, const Expression &expr_r) {
+		return compile(&expr_l, cmp, &expr_r);
+	}
+
+	// evaluate with compiled code (IF gives 0 or 1), false if the interpreter should take over
+	bool Run(Context *p_context, Int *p_out) const;
+};
+
+// Per-statement slot holding the compiled code, copies of a statement don't share it
+class JitSlot {
+private:
+	mutable std::atomic<JitCode *> m_code{nullptr};
+	mutable std::atomic_bool m_failed{false};
+
+	static bool is_hot(const Context &context);
+	JitCode *publish(std::unique_ptr<JitCode> code) const;
+
+public:
+	inline JitSlot() = default;
+	inline JitSlot(const JitSlot &) {}
+	inline JitSlot &operator=(const JitSlot &) { return *this; }
+	inline ~JitSlot() { delete m_code.load(std::memory_order_acquire); }
+
+	template <typename CompileFunc> inline bool Run(Context *p_context, CompileFunc &&compile, Int *p_out) const {
+		if (Jit::GetMode() == JitMode::kDisabled)
+			return false;
+		JitCode *p_code = m_code.load(std::memory_order_acquire);
+		if (p_code == nullptr) {
+			if (m_failed.load(std::memory_order_relaxed) || !is_hot(*p_context))
+				return false;
+			p_code = publish(compile());
+			if (p_code == nullptr)
+				return false;
+		}
+		return p_code->Run(p_context, p_out);
+	}
+};
+
+} // namespace basic
@@ -1,5 +1,8 @@
 #include "Machine.hpp"
 
+#include "Trace.hpp"
+#include "Worker.hpp"
+
 namespace basic {
 
 void Machine::transfer_context_data(Context *p_context) {
@@ -20,8 +23,25 @@ struct ReturnCaller {
 	inline ~ReturnCaller() { func(); }
 };
 
-ExecuteResult Machine::execute(std::unique_ptr<Program> program, std::unique_ptr<Context> context,
-                               const std::function<void()> &callback) {
+struct ProbeAttacher {
+	inline explicit ProbeAttacher(ProfileProbe *p_probe) { ProfileProbe::SetCurrent(p_probe); }
+	inline ~ProbeAttacher() { ProfileProbe::SetCurrent(nullptr); }
+};
+
+struct MeterAttacher {
+	Meter *p_meter;
+	inline explicit MeterAttacher(Meter *p_meter) : p_meter{p_meter} {
+		if (p_meter)
+			p_meter->Attach();
+	}
+	inline ~MeterAttacher() {
+		if (p_meter)
+			p_meter->Detach();
+	}
+};
+
+ExecuteResult Machine::execute(Program program, std::unique_ptr<Context> context,
+                               const std::function<void()> &callback, ExecuteOptions options) {
 #define UNWRAP_ASSIGN(L_VALUE, RESULT) \
 	do { \
 		auto result = RESULT; \
@@ -44,12 +64,44 @@ ExecuteResult Machine::execute(std::unique_ptr<Program> program, std::unique_ptr
 
 	// Call callback function when return
 	ReturnCaller return_caller{callback};
+	ProbeAttacher probe_attacher{options.p_probe};
+	MeterAttacher meter_attacher{options.p_meter};
 
 	if (context == nullptr) {
 		std::unique_ptr<Context> new_context;
-		UNWRAP_ASSIGN(new_context, Context::Create(*program));
+		UNWRAP_ASSIGN(new_context, Context::Create(program));
 		context = std::move(new_context);
 	}
+	if (options.isolated && WorkerPool::IsStarted()) {
+		return WorkerPool::Run(
+		    std::move(program), std::move(context), options.debug,
+		    [this] { return m_terminated.load(std::memory_order_acquire); },
+		    [this]() -> std::optional<String> {
+			    std::scoped_lock input_lock{m_input_mutex};
+			    if (m_inputs.empty())
+				    return std::nullopt;
+			    String input = std::move(m_inputs.front());
+			    m_inputs.pop();
+			    return input;
+		    });
+	}
+	// without breakpoints or watchpoints the program itself runs
+	Program patched_program;
+	const Program *p_run_program = &program;
+	if (!options.debug.breakpoints.empty() || !options.debug.watchpoints.empty()) {
+		patched_program = program.Patch(options.debug.breakpoints, options.debug.watchpoints);
+		p_run_program = &patched_program;
+	}
+
+	TraceWriter *p_tracer = options.p_tracer;
+	ProfileProbe *p_probe = options.p_probe;
+	context->SetTracer(p_tracer);
+	context->SetMeter(options.p_meter);
+	History *p_history = options.p_history;
+	context->SetInputLog(p_history ? p_history->GetInputLog() : nullptr);
+	context->SetInputSource(options.p_input_source);
+	if (p_tracer)
+		p_tracer->Resume();
 
 	while (true) {
 		transfer_context_data(context.get());
@@ -57,9 +109,15 @@ ExecuteResult Machine::execute(std::unique_ptr<Program> program, std::unique_ptr
 		if (context->IsTerminated())
 			RET_ERROR(ErrTerminate{});
 
-		const Statement *p_stmt;
-		UNWRAP_ASSIGN(p_stmt, program->GetStatement(context->GetLine()));
-		UNWRAP(p_stmt->Run(*program, context.get()));
+		if (p_tracer)
+			p_tracer->Line(context->GetLine());
+		if (p_probe)
+			p_probe->SetLine(context->GetLine());
+		if (p_history)
+			p_history->Record(*context);
+		UNWRAP(p_run_program->Step(context.get()));
+		if (options.debug.step)
+			RET_ERROR(MsgStep{});
 	}
 
 	return {std::move(program), std::move(context), {}};
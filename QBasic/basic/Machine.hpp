@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Context.hpp"
+#include "History.hpp"
 #include "Program.hpp"
 
 #include <atomic>
@@ -11,8 +12,29 @@
 
 namespace basic {
 
+// A run pauses with MsgBreakpoint before a breakpoint line, MsgWatchpoint after a watched variable changed, or
+// MsgStep after one statement. Resuming the paused context runs the statement it stopped before, the paused context
+// can be inspected meanwhile and the options can change for the next run.
+struct DebugOptions {
+	std::set<LineID> breakpoints;
+	std::set<String> watchpoints;
+	bool step{};
+};
+
+struct ExecuteOptions {
+	TraceWriter *p_tracer{}; // records the execution, pass it again when resuming the same context
+	ProfileProbe *p_probe{}; // published position for a Profiler
+	Meter *p_meter{};        // counters and quotas, keeps accumulating when resuming the same context
+	DebugOptions debug;
+	History *p_history{};          // snapshots for reverse execution, pass it again when resuming the same context
+	InputSource *p_input_source{}; // inputs once the pushed ones run out, pass it again when resuming the context
+	// run in a worker process (WorkerPool) if started, the tracer, probe, meter, history and input source are not
+	// used then
+	bool isolated{};
+};
+
 struct ExecuteResult {
-	std::unique_ptr<Program> program;
+	Program program;
 	std::unique_ptr<Context> context;
 	RuntimeResult<void> result;
 };
@@ -28,16 +50,18 @@ private:
 	std::future<ExecuteResult> m_result_future;
 
 	void transfer_context_data(Context *p_context);
-	ExecuteResult execute(std::unique_ptr<Program> program, std::unique_ptr<Context> context,
-	                      const std::function<void()> &callback);
+	ExecuteResult execute(Program program, std::unique_ptr<Context> context, const std::function<void()> &callback,
+	                      ExecuteOptions options);
 
 public:
-	inline static std::unique_ptr<Machine> Execute(std::unique_ptr<Program> program, std::unique_ptr<Context> context,
-	                                               const std::function<void()> &callback) {
+	// program is a snapshot, later edits to the caller's copy don't affect the execution
+	inline static std::unique_ptr<Machine> Execute(Program program, std::unique_ptr<Context> context,
+	                                               const std::function<void()> &callback,
+	                                               ExecuteOptions options = {}) {
 		auto machine = std::make_unique<Machine>();
 		machine->m_terminated.store(false, std::memory_order_release);
-		machine->m_result_future =
-		    std::async(&Machine::execute, machine.get(), std::move(program), std::move(context), callback);
+		machine->m_result_future = std::async(&Machine::execute, machine.get(), std::move(program), std::move(context),
+		                                      callback, options);
 		return machine;
 	}
 	inline static ExecuteResult GetResult(std::unique_ptr<Machine> *p_machine) {
@@ -0,0 +1,82 @@
+#include "Meter.hpp"
+
+#include <ctime>
+
+namespace basic {
+
+Meter::Meter(MeterQuota quota) { SetQuota(quota); }
+
+void Meter::SetQuota(const MeterQuota &quota) {
+	m_quota = quota;
+	m_limits = {.statements = to_limit(quota.statements),
+	            .expression_nodes = to_limit(quota.expression_nodes),
+	            .variables = to_limit(quota.variables),
+	            .output_bytes = to_limit(quota.output_bytes),
+	            .wall_us = to_limit(quota.wall_time),
+	            .cpu_us = to_limit(quota.cpu_time)};
+}
+
+void Meter::Reset() {
+	m_statements.store(0, std::memory_order_relaxed);
+	m_expression_nodes.store(0, std::memory_order_relaxed);
+	m_peak_variables.store(0, std::memory_order_relaxed);
+	m_output_bytes.store(0, std::memory_order_relaxed);
+	m_wall_us.store(0, std::memory_order_relaxed);
+	m_cpu_us.store(0, std::memory_order_relaxed);
+	m_wall_base_us = m_cpu_base_us = 0;
+	m_clock_countdown = kMeterClockSteps;
+	m_opt_exceeded.reset();
+}
+
+MeterReading Meter::Read() const {
+	return {.statements = m_statements.load(std::memory_order_relaxed),
+	        .expression_nodes = m_expression_nodes.load(std::memory_order_relaxed),
+	        .peak_variables = m_peak_variables.load(std::memory_order_relaxed),
+	        .output_bytes = m_output_bytes.load(std::memory_order_relaxed),
+	        .wall_time = std::chrono::microseconds{m_wall_us.load(std::memory_order_relaxed)},
+	        .cpu_time = std::chrono::microseconds{m_cpu_us.load(std::memory_order_relaxed)}};
+}
+
+int64_t Meter::get_wall_us() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+	           std::chrono::steady_clock::now().time_since_epoch())
+	    .count();
+}
+
+int64_t Meter::get_cpu_us() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	timespec time{};
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return int64_t(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+#else
+	// process time, includes the other threads
+	return int64_t(std::clock()) * 1000000 / CLOCKS_PER_SEC;
+#endif
+}
+
+void Meter::Attach() {
+	m_wall_start_us = get_wall_us();
+	m_cpu_start_us = get_cpu_us();
+	m_clock_countdown = kMeterClockSteps;
+}
+
+void Meter::Detach() {
+	update_clock();
+	m_wall_base_us = m_wall_us.load(std::memory_order_relaxed);
+	m_cpu_base_us = m_cpu_us.load(std::memory_order_relaxed);
+}
+
+RuntimeResult<void> Meter::update_clock() {
+	m_clock_countdown = kMeterClockSteps;
+	int64_t wall_us = m_wall_base_us + get_wall_us() - m_wall_start_us;
+	int64_t cpu_us = m_cpu_base_us + get_cpu_us() - m_cpu_start_us;
+	m_wall_us.store(wall_us, std::memory_order_relaxed);
+	m_cpu_us.store(cpu_us, std::memory_order_relaxed);
+	if (wall_us > m_limits.wall_us)
+		return ErrQuotaExceeded{.resource = "us of wall time", .limit = uint64_t(m_quota.wall_time.count())};
+	if (cpu_us > m_limits.cpu_us)
+		return ErrQuotaExceeded{.resource = "us of CPU time", .limit = uint64_t(m_quota.cpu_time.count())};
+	return {};
+}
+
+} // namespace basic
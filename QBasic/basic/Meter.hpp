@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Config.hpp"
+#include "Error.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <optional>
+
+namespace basic {
+
+// zero means unlimited
+struct MeterQuota {
+	uint64_t statements{}, expression_nodes{}, variables{}, output_bytes{};
+	std::chrono::microseconds wall_time{}, cpu_time{};
+};
+
+struct MeterReading {
+	uint64_t statements, expression_nodes, peak_variables, output_bytes;
+	std::chrono::microseconds wall_time, cpu_time; // while executing, not waiting for inputs
+};
+
+// Counters of the runs attached to a context. The executing thread is the only writer, so it updates them with
+// relaxed loads and stores instead of read-modify-writes, and other threads can Read them at any time. Times are
+// refreshed every kMeterClockSteps statements. A quota exceeded stops the program before its next statement.
+class Meter {
+private:
+	struct Limits {
+		uint64_t statements, expression_nodes, variables, output_bytes;
+		int64_t wall_us, cpu_us;
+	};
+
+	Limits m_limits;
+	MeterQuota m_quota;
+
+	std::atomic<uint64_t> m_statements{}, m_expression_nodes{}, m_peak_variables{}, m_output_bytes{};
+	std::atomic<int64_t> m_wall_us{}, m_cpu_us{};
+
+	// owned by the executing thread
+	int64_t m_wall_start_us{}, m_cpu_start_us{}, m_wall_base_us{}, m_cpu_base_us{};
+	Count m_clock_countdown{kMeterClockSteps};
+	std::optional<ErrQuotaExceeded> m_opt_exceeded;
+
+	static int64_t get_wall_us();
+	static int64_t get_cpu_us(); // of the calling thread
+	RuntimeResult<void> update_clock();
+
+	inline static uint64_t to_limit(uint64_t quota) {
+		return quota ? quota : std::numeric_limits<uint64_t>::max();
+	}
+	inline static int64_t to_limit(std::chrono::microseconds quota) {
+		return quota.count() > 0 ? quota.count() : std::numeric_limits<int64_t>::max();
+	}
+
+public:
+	explicit Meter(MeterQuota quota = {});
+	Meter(const Meter &) = delete;
+	Meter &operator=(const Meter &) = delete;
+
+	inline const MeterQuota &GetQuota() const { return m_quota; }
+	// not while attached
+	void SetQuota(const MeterQuota &quota);
+	void Reset();
+
+	MeterReading Read() const;
+
+	// start and stop timing on the executing thread, a run can be resumed on another thread
+	void Attach();
+	void Detach();
+
+	// before a statement evaluating nodes expression nodes
+	inline RuntimeResult<void> Step(Count nodes) {
+		uint64_t statements = m_statements.load(std::memory_order_relaxed);
+		uint64_t expression_nodes = m_expression_nodes.load(std::memory_order_relaxed) + nodes;
+		if (statements >= m_limits.statements)
+			return ErrQuotaExceeded{.resource = "statements", .limit = m_quota.statements};
+		if (expression_nodes > m_limits.expression_nodes)
+			return ErrQuotaExceeded{.resource = "expression nodes", .limit = m_quota.expression_nodes};
+		if (m_opt_exceeded.has_value())
+			return m_opt_exceeded.value();
+		m_statements.store(statements + 1, std::memory_order_relaxed);
+		m_expression_nodes.store(expression_nodes, std::memory_order_relaxed);
+		if (--m_clock_countdown == 0)
+			return update_clock();
+		return {};
+	}
+	inline void Variables(std::size_t count) {
+		if (count <= m_peak_variables.load(std::memory_order_relaxed))
+			return;
+		m_peak_variables.store(count, std::memory_order_relaxed);
+		if (count > m_limits.variables)
+			m_opt_exceeded = ErrQuotaExceeded{.resource = "variables", .limit = m_quota.variables};
+	}
+	inline void Output(std::size_t bytes) {
+		uint64_t output_bytes = m_output_bytes.load(std::memory_order_relaxed) + bytes;
+		m_output_bytes.store(output_bytes, std::memory_order_relaxed);
+		if (output_bytes > m_limits.output_bytes)
+			m_opt_exceeded = ErrQuotaExceeded{.resource = "output bytes", .limit = m_quota.output_bytes};
+	}
+};
+
+} // namespace basic
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace basic {
+
+// Ordered map with structural sharing (treap with path copying).
+// Copying a map is O(1), a modification only duplicates the O(log n) nodes on its path that are shared with other
+// copies, nodes owned by a single map are modified in place.
+template <typename Key, typename Value> class PersistentMap {
+public:
+	using Entry = std::pair<const Key, Value>;
+
+private:
+	struct Node;
+	using NodePtr = std::shared_ptr<Node>;
+	struct Node {
+		Entry entry;
+		uint64_t priority;
+		NodePtr left, right;
+	};
+
+	NodePtr m_root;
+	std::size_t m_size{};
+
+	inline static uint64_t get_priority(const Key &key) {
+		// splitmix64 finalizer, keeps the treap balanced for sequential keys
+		uint64_t x = std::hash<Key>{}(key) + 0x9e3779b97f4a7c15ull;
+		x = (x ^ (x >> 30u)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27u)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31u);
+	}
+	inline static Node *mutate(NodePtr *p_node) {
+		if (p_node->use_count() != 1)
+			*p_node = std::make_shared<Node>(**p_node);
+		return p_node->get();
+	}
+	// split a tree into keys < key and keys > key, key should not be in the tree
+	inline static void split(NodePtr node, const Key &key, NodePtr *p_left, NodePtr *p_right) {
+		if (!node) {
+			*p_left = *p_right = nullptr;
+			return;
+		}
+		Node *p_node = mutate(&node);
+		if (p_node->entry.first < key) {
+			split(std::move(p_node->right), key, &p_node->right, p_right);
+			*p_left = std::move(node);
+		} else {
+			split(std::move(p_node->left), key, p_left, &p_node->left);
+			*p_right = std::move(node);
+		}
+	}
+	inline static NodePtr merge(NodePtr left, NodePtr right) {
+		if (!left || !right)
+			return left ? std::move(left) : std::move(right);
+		if (left->priority > right->priority) {
+			Node *p_left = mutate(&left);
+			p_left->right = merge(std::move(p_left->right), std::move(right));
+			return left;
+		}
+		Node *p_right = mutate(&right);
+		p_right->left = merge(std::move(left), std::move(p_right->left));
+		return right;
+	}
+	inline static Value *insert(NodePtr *p_node, const Key &key, uint64_t priority, std::size_t *p_size) {
+		if (!*p_node || priority > (*p_node)->priority) {
+			++*p_size;
+			auto node = std::make_shared<Node>(Node{.entry = {key, Value{}}, .priority = priority});
+			split(std::move(*p_node), key, &node->left, &node->right);
+			*p_node = std::move(node);
+			return &(*p_node)->entry.second;
+		}
+		Node *p_mut = mutate(p_node);
+		if (key < p_mut->entry.first)
+			return insert(&p_mut->left, key, priority, p_size);
+		if (p_mut->entry.first < key)
+			return insert(&p_mut->right, key, priority, p_size);
+		return &p_mut->entry.second;
+	}
+	inline static void erase(NodePtr *p_node, const Key &key) {
+		Node *p_mut = mutate(p_node);
+		if (key < p_mut->entry.first)
+			erase(&p_mut->left, key);
+		else if (p_mut->entry.first < key)
+			erase(&p_mut->right, key);
+		else
+			*p_node = merge(std::move(p_mut->left), std::move(p_mut->right));
+	}
+	template <typename Func> inline static void for_each(const Node *p_node, Func &&func) {
+		if (!p_node)
+			return;
+		for_each(p_node->left.get(), func);
+		func(p_node->entry);
+		for_each(p_node->right.get(), func);
+	}
+
+public:
+	inline bool Empty() const { return m_root == nullptr; }
+	inline std::size_t Size() const { return m_size; }
+	// shares all its nodes with other, i.e. one is an unmodified copy of the other
+	inline bool IsSameAs(const PersistentMap &other) const { return m_root == other.m_root; }
+	inline void Clear() {
+		m_root = nullptr;
+		m_size = 0;
+	}
+
+	inline const Entry *Find(const Key &key) const {
+		for (const Node *p_node = m_root.get(); p_node;) {
+			if (key < p_node->entry.first)
+				p_node = p_node->left.get();
+			else if (p_node->entry.first < key)
+				p_node = p_node->right.get();
+			else
+				return &p_node->entry;
+		}
+		return nullptr;
+	}
+	inline const Entry *First() const {
+		const Node *p_node = m_root.get();
+		if (!p_node)
+			return nullptr;
+		while (p_node->left)
+			p_node = p_node->left.get();
+		return &p_node->entry;
+	}
+	inline const Entry *UpperBound(const Key &key) const {
+		const Entry *p_ret = nullptr;
+		for (const Node *p_node = m_root.get(); p_node;) {
+			if (key < p_node->entry.first) {
+				p_ret = &p_node->entry;
+				p_node = p_node->left.get();
+			} else
+				p_node = p_node->right.get();
+		}
+		return p_ret;
+	}
+
+	// get (or default-insert) a mutable value, shared nodes on the path are copied
+	inline Value &operator[](const Key &key) { return *insert(&m_root, key, get_priority(key), &m_size); }
+	inline void Insert(const Key &key, Value value) { (*this)[key] = std::move(value); }
+	inline void Erase(const Key &key) {
+		if (Find(key)) {
+			erase(&m_root, key);
+			--m_size;
+		}
+	}
+
+	template <typename Func> inline void ForEach(Func &&func) const { for_each(m_root.get(), func); }
+
+	// func(key, p_value, p_other_value) for each key whose entry differs from other's, in key order, a null value is
+	// a missing key. Subtrees shared with other are skipped, so diffing a copy edited k times costs O(k log n).
+	template <typename Func> inline void Diff(const PersistentMap &other, Func &&func) const {
+		// the pending subtrees and entries, in reverse key order
+		struct Item {
+			const Node *p_node;
+			bool is_entry;
+		};
+		std::vector<Item> items, other_items;
+		const auto push = [](std::vector<Item> *p_items, const Node *p_node) {
+			if (p_node)
+				p_items->push_back({p_node, false});
+		};
+		const auto expand = [&push](std::vector<Item> *p_items) {
+			const Node *p_node = p_items->back().p_node;
+			p_items->pop_back();
+			push(p_items, p_node->right.get());
+			p_items->push_back({p_node, true});
+			push(p_items, p_node->left.get());
+		};
+		push(&items, m_root.get());
+		push(&other_items, other.m_root.get());
+		while (!items.empty() || !other_items.empty()) {
+			const Item *p_item = items.empty() ? nullptr : &items.back();
+			const Item *p_other = other_items.empty() ? nullptr : &other_items.back();
+			if (p_item && p_other && !p_item->is_entry && !p_other->is_entry && p_item->p_node == p_other->p_node) {
+				items.pop_back();
+				other_items.pop_back();
+				continue;
+			}
+			// the higher subtree first, so that a subtree shared at different depths meets its copy
+			if (p_item && !p_item->is_entry &&
+			    (!p_other || p_other->is_entry || p_item->p_node->priority >= p_other->p_node->priority)) {
+				expand(&items);
+				continue;
+			}
+			if (p_other && !p_other->is_entry) {
+				expand(&other_items);
+				continue;
+			}
+			const Entry *p_entry = p_item ? &p_item->p_node->entry : nullptr;
+			const Entry *p_other_entry = p_other ? &p_other->p_node->entry : nullptr;
+			if (p_entry && (!p_other_entry || p_entry->first < p_other_entry->first)) {
+				func(p_entry->first, &p_entry->second, (const Value *)nullptr);
+				items.pop_back();
+			} else if (!p_entry || p_other_entry->first < p_entry->first) {
+				func(p_other_entry->first, (const Value *)nullptr, &p_other_entry->second);
+				other_items.pop_back();
+			} else {
+				if (!(p_entry->second == p_other_entry->second))
+					func(p_entry->first, &p_entry->second, &p_other_entry->second);
+				items.pop_back();
+				other_items.pop_back();
+			}
+		}
+	}
+};
+
+} // namespace basic
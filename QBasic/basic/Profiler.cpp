@@ -0,0 +1,141 @@
+#include "Profiler.hpp"
+
+#include "Program.hpp"
+
+#include <algorithm>
+
+namespace basic {
+
+Profiler::Profiler(std::chrono::microseconds interval) : m_interval{interval} {
+	m_thread = std::thread{&Profiler::sample_loop, this};
+}
+
+Profiler::~Profiler() {
+	m_stopped.store(true, std::memory_order_release);
+	m_thread.join();
+}
+
+void Profiler::sample_loop() {
+	while (!m_stopped.load(std::memory_order_acquire)) {
+		std::this_thread::sleep_for(m_interval);
+		if (!m_probe.m_active.load(std::memory_order_relaxed))
+			continue;
+
+		const Expression *p_expr = m_probe.m_expr.load(std::memory_order_relaxed);
+		LineID line = m_probe.m_line.load(std::memory_order_relaxed);
+		std::scoped_lock lock{m_mutex};
+		++m_total_samples;
+		if (p_expr)
+			++m_expr_samples[p_expr];
+		else
+			++m_line_samples[line];
+	}
+}
+
+void Profiler::Reset() {
+	std::scoped_lock lock{m_mutex};
+	m_expr_samples.clear();
+	m_line_samples.clear();
+	m_total_samples = 0;
+}
+
+namespace {
+
+template <typename Func> void for_each_expression(const Statement &statement, Func &&func) {
+	statement.Visit([&func](const auto &stmt) {
+		if constexpr (requires { stmt.expr_index; })
+			if (stmt.expr_index)
+				func(*stmt.expr_index);
+		if constexpr (requires { stmt.expr_size; })
+			func(*stmt.expr_size);
+		if constexpr (requires { stmt.expr; })
+			func(*stmt.expr);
+		if constexpr (requires { stmt.expr_l; }) {
+			func(*stmt.expr_l);
+			func(*stmt.expr_r);
+		}
+		if constexpr (requires { stmt.expr_from; }) {
+			func(*stmt.expr_from);
+			func(*stmt.expr_to);
+			if (stmt.expr_step)
+				func(*stmt.expr_step);
+		}
+	});
+}
+
+String get_frame(const Expression &expression) {
+	return expression.Visit([&expression](const auto &expr) -> String {
+		using Expr = std::decay_t<decltype(expr)>;
+		if constexpr (Expr::kType == ExpressionType::kOperand)
+			return expr.Format();
+		else
+			return expression.Format();
+	});
+}
+
+} // namespace
+
+ProfileReport Profiler::Report(const Program &program) const {
+	std::unordered_map<const Expression *, Count> expr_samples;
+	std::map<LineID, Count> line_samples;
+	ProfileReport ret{};
+	{
+		std::scoped_lock lock{m_mutex};
+		expr_samples = m_expr_samples;
+		line_samples = m_line_samples;
+		ret.total_samples = m_total_samples;
+	}
+
+	// resolve the sampled expressions by walking the program, each expression's stack is its path from the root
+	std::map<LineID, ProfileLine> lines;
+	std::map<String, Count> folded_stacks; // identical subexpressions (e.g. "i * i") share stacks
+	for (const auto &[line, samples] : line_samples)
+		lines[line] = {.line = line, .samples = samples};
+	program.ForEachStatement([&](LineID line, const Statement &statement) {
+		String line_frame = std::to_string(line) + " " + statement.Format();
+		auto line_it = line_samples.find(line);
+		if (line_it != line_samples.end()) {
+			folded_stacks[line_frame] += line_it->second;
+			lines[line].statement_str = statement.Format();
+		}
+
+		std::vector<const Expression *> path;
+		const auto visit = [&](const Expression &expression, const auto &visit) -> void {
+			path.push_back(&expression);
+			auto expr_it = expr_samples.find(&expression);
+			if (expr_it != expr_samples.end()) {
+				String stack = line_frame;
+				for (const Expression *p_expr : path)
+					stack += ";" + get_frame(*p_expr);
+				folded_stacks[stack] += expr_it->second;
+
+				auto &profile_line = lines[line];
+				profile_line.line = line;
+				profile_line.samples += expr_it->second;
+				profile_line.statement_str = statement.Format();
+				expr_samples.erase(expr_it);
+			}
+			expression.Visit([&visit](const auto &expr) {
+				using Expr = std::decay_t<decltype(expr)>;
+				if constexpr (Expr::kType == ExpressionType::kUnary)
+					visit(*expr.child, visit);
+				else if constexpr (Expr::kType == ExpressionType::kBinary) {
+					visit(*expr.left, visit);
+					visit(*expr.right, visit);
+				}
+			});
+			path.pop_back();
+		};
+		for_each_expression(statement, [&visit](const Expression &expression) { visit(expression, visit); });
+	});
+
+	for (const auto &[stack, samples] : folded_stacks)
+		ret.folded_stacks += stack + " " + std::to_string(samples) + "\n";
+	for (auto &entry : lines)
+		ret.lines.push_back(std::move(entry.second));
+	std::stable_sort(ret.lines.begin(), ret.lines.end(),
+	                 [](const ProfileLine &l, const ProfileLine &r) { return l.samples > r.samples; });
+	return ret;
+}
+
+} // namespace basic
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Config.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace basic {
+
+class Expression;
+class Program;
+
+// Position of the executing thread, written with relaxed stores and read by the sampler without locks.
+// The expression is the innermost one being evaluated (nullptr between expressions), the line is only used for
+// samples outside of expressions since the expression determines its line.
+class ProfileProbe {
+private:
+	inline static thread_local ProfileProbe *s_p_current = nullptr;
+
+	std::atomic<LineID> m_line{};
+	std::atomic<const Expression *> m_expr{};
+	std::atomic_bool m_active{false};
+
+	friend class Profiler;
+
+public:
+	// probe of the calling thread, nullptr if not profiled
+	inline static ProfileProbe *GetCurrent() { return s_p_current; }
+	// attach to the calling thread while executing, detach with nullptr
+	inline static void SetCurrent(ProfileProbe *p_probe) {
+		if (s_p_current)
+			s_p_current->m_active.store(false, std::memory_order_relaxed);
+		s_p_current = p_probe;
+		if (p_probe)
+			p_probe->m_active.store(true, std::memory_order_relaxed);
+	}
+
+	inline void SetLine(LineID line) {
+		m_line.store(line, std::memory_order_relaxed);
+		m_expr.store(nullptr, std::memory_order_relaxed);
+	}
+	// returns the previous expression to restore with Leave
+	inline const Expression *Enter(const Expression *p_expr) {
+		const Expression *p_parent = m_expr.load(std::memory_order_relaxed);
+		m_expr.store(p_expr, std::memory_order_relaxed);
+		return p_parent;
+	}
+	inline void Leave(const Expression *p_parent) { m_expr.store(p_parent, std::memory_order_relaxed); }
+};
+
+struct ProfileLine {
+	LineID line;
+	Count samples;        // including the samples of its expressions
+	String statement_str; // formatted statement, empty if the line is not in the program
+};
+
+struct ProfileReport {
+	Count total_samples;
+	std::vector<ProfileLine> lines; // most samples first
+	// flame graph input, one "line;expression;subexpression... count" per sampled stack
+	String folded_stacks;
+};
+
+// Samples a probe from a background thread at a fixed interval. Samples only hold expression addresses, they are
+// resolved against the (immutable) program snapshot that was executed when a report is made.
+class Profiler {
+private:
+	ProfileProbe m_probe;
+	std::chrono::microseconds m_interval;
+
+	mutable std::mutex m_mutex;
+	std::unordered_map<const Expression *, Count> m_expr_samples;
+	std::map<LineID, Count> m_line_samples;
+	Count m_total_samples{};
+
+	std::atomic_bool m_stopped{false};
+	std::thread m_thread;
+
+	void sample_loop();
+
+public:
+	explicit Profiler(std::chrono::microseconds interval = std::chrono::microseconds{kProfilerIntervalUs});
+	~Profiler();
+	Profiler(const Profiler &) = delete;
+	Profiler &operator=(const Profiler &) = delete;
+
+	inline ProfileProbe *GetProbe() { return &m_probe; }
+	void Reset();
+	ProfileReport Report(const Program &program) const;
+};
+
+} // namespace basic
@@ -1 +1,97 @@
-#include "Program.hpp"
\ No newline at end of file
+#include "Program.hpp"
+
+#include "Context.hpp"
+
+namespace basic {
+
+RuntimeResult<void> Program::Step(Context *p_context) const {
+	const Statement *p_stmt;
+	BASIC_UNWRAP_ASSIGN(p_stmt, GetStatement(p_context->GetLine()));
+	if (Meter *p_meter = p_context->GetMeter())
+		BASIC_UNWRAP(p_meter->Step(p_stmt->GetNodeCount()));
+	return p_stmt->Run(*this, p_context);
+}
+
+void Program::index_statement(LineID line, const Statement &statement, bool insert) {
+	const auto update = [line, insert](PersistentMap<String, LineSet> *p_index, const String &var) {
+		if (insert) {
+			(*p_index)[var].Insert(line, true);
+			return;
+		}
+		LineSet &lines = (*p_index)[var];
+		lines.Erase(line);
+		if (lines.Empty())
+			p_index->Erase(var);
+	};
+	if (const String *p_var = statement.GetVariable())
+		update(&m_writers, *p_var);
+	statement.Visit([this, &update](const auto &stmt) {
+		if constexpr (std::is_same_v<std::decay_t<decltype(stmt)>, StmtNext>)
+			update(&m_nexts, stmt.var);
+	});
+}
+
+void Program::insert_statement(LineID line, std::shared_ptr<const Statement> statement) {
+	if (auto p_entry = m_statements.Find(line))
+		index_statement(line, *p_entry->second, false);
+	index_statement(line, *statement, true);
+	m_statements.Insert(line, std::move(statement));
+}
+
+void Program::EraseStatement(LineID line) {
+	if (auto p_entry = m_statements.Find(line)) {
+		index_statement(line, *p_entry->second, false);
+		m_statements.Erase(line);
+	}
+}
+
+bool Program::SwapEdits(const Program &edited, const Program &base, LineID paused_line) {
+	std::vector<std::pair<LineID, std::shared_ptr<const Statement>>> edits;
+	edited.m_statements.Diff(base.m_statements, [&edits](LineID line, const auto *p_stmt, const auto *) {
+		edits.emplace_back(line, p_stmt ? *p_stmt : nullptr);
+	});
+
+	// the context resumes at its line, waiting on the same input if it was at an INPUT
+	const auto is_input = [](const Statement &statement) {
+		return statement.Visit([](const auto &stmt) {
+			return std::is_same_v<std::decay_t<decltype(stmt)>, StmtInput>;
+		});
+	};
+	for (const auto &[line, statement] : edits) {
+		if (line != paused_line)
+			continue;
+		auto p_entry = m_statements.Find(line);
+		if (!statement || (p_entry && is_input(*p_entry->second) && !is_input(*statement)))
+			return false;
+	}
+
+	for (auto &[line, statement] : edits) {
+		if (statement)
+			insert_statement(line, std::move(statement));
+		else
+			EraseStatement(line);
+	}
+	return true;
+}
+
+Program Program::Patch(const std::set<LineID> &breakpoints, const std::set<String> &watchpoints) const {
+	Program ret = *this;
+	const auto patch = [&ret, &breakpoints, &watchpoints](LineID line, const std::shared_ptr<const Statement> &stmt) {
+		const String *p_var = stmt->GetVariable();
+		String watch_var = p_var && watchpoints.count(*p_var) ? *p_var : String{};
+		bool breakpoint = breakpoints.count(line);
+		if (breakpoint || !watch_var.empty())
+			ret.m_statements.Insert(line, Statement::Trap(stmt, breakpoint, std::move(watch_var)));
+	};
+
+	// only the lines found through the index, a breakpoint line may also write a watched variable
+	std::set<LineID> lines = breakpoints;
+	for (const String &var : watchpoints)
+		ForEachWriter(var, [&lines](LineID line) { lines.insert(line); });
+	for (LineID line : lines)
+		if (auto p_entry = m_statements.Find(line))
+			patch(line, p_entry->second);
+	return ret;
+}
+
+} // namespace basic
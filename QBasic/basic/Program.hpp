@@ -1,74 +1,125 @@
 #pragma once
 
 #include "Error.hpp"
+#include "PersistentMap.hpp"
 #include "Statement.hpp"
 
-#include <map>
 #include <memory>
 #include <optional>
+#include <set>
 
 namespace basic {
 
+// A Program is a snapshot of statements, copying it is O(1) and editing a copy is O(log n) without affecting the
+// others, so a Machine can keep running one version while the UI views or edits another.
 class Program {
 private:
-	std::map<LineID, std::unique_ptr<Statement>> m_statements;
+	using LineSet = PersistentMap<LineID, bool>;
 
-public:
-	inline static std::unique_ptr<Program> Create() { return std::make_unique<Program>(); }
+	PersistentMap<LineID, std::shared_ptr<const Statement>> m_statements;
+	// the lines depending on a variable, kept up to date by each edit so that no lookup goes through all the lines:
+	// the statements writing it and the NEXTs of its loops
+	PersistentMap<String, LineSet> m_writers, m_nexts;
+
+	void index_statement(LineID line, const Statement &statement, bool insert);
+	void insert_statement(LineID line, std::shared_ptr<const Statement> statement);
 
+	template <typename> friend struct Serializer;
+
+public:
 	inline RuntimeResult<LineID> GetFirstLine() const {
-		if (m_statements.empty())
+		auto p_entry = m_statements.First();
+		if (p_entry == nullptr)
 			return MsgEndOfProgram{};
-
-		return m_statements.begin()->first;
+		return p_entry->first;
 	}
 	inline RuntimeResult<LineID> GetNextLine(LineID line) const {
-		if (m_statements.empty())
-			return MsgEndOfProgram{};
-
-		auto it = m_statements.upper_bound(line);
-		if (it == m_statements.end())
+		auto p_entry = m_statements.UpperBound(line);
+		if (p_entry == nullptr)
 			return MsgEndOfProgram{};
-		return it->first;
+		return p_entry->first;
 	}
 	inline RuntimeResult<void> CheckLine(LineID line) const {
-		if (m_statements.empty())
+		if (m_statements.Empty())
 			return MsgEndOfProgram{};
 
-		auto it = m_statements.find(line);
-		if (it == m_statements.end())
+		if (m_statements.Find(line) == nullptr)
 			return ErrUndefinedLine{.line = line};
 		return {};
 	}
 	inline RuntimeResult<const Statement *> GetStatement(LineID line) const {
-		if (m_statements.empty())
+		if (m_statements.Empty())
 			return MsgEndOfProgram{};
 
-		auto it = m_statements.find(line);
-		if (it == m_statements.end())
+		auto p_entry = m_statements.Find(line);
+		if (p_entry == nullptr)
 			return ErrUndefinedLine{.line = line};
-		return it->second.get();
+		return p_entry->second.get();
+	}
+
+	// the line of the first NEXT of the variable after the line, where a FOR with an empty range goes past
+	inline RuntimeResult<LineID> FindNext(LineID line, const String &var) const {
+		auto p_lines = m_nexts.Find(var);
+		auto p_entry = p_lines ? p_lines->second.UpperBound(line) : nullptr;
+		if (p_entry == nullptr)
+			return ErrForWithoutNext{.var = var};
+		return p_entry->first;
+	}
+	template <typename Func> inline void ForEachWriter(const String &var, Func &&func) const {
+		if (auto p_lines = m_writers.Find(var))
+			p_lines->second.ForEach([&func](const auto &entry) { func(entry.first); });
 	}
 
+	// run the statement at the context's current line
+	RuntimeResult<void> Step(Context *p_context) const;
+
+	// snapshot with traps in place of the breakpoint lines and of the statements writing a watched variable, the
+	// others are shared, so running it costs nothing more than running this one
+	Program Patch(const std::set<LineID> &breakpoints, const std::set<String> &watchpoints) const;
+
+	// O(log n), only the index entries of the line change
 	inline void InsertStatement(LineID line, std::unique_ptr<Statement> statement) {
 		if (statement)
-			m_statements[line] = std::move(statement);
+			insert_statement(line, std::move(statement));
 	}
-	inline void EraseStatement(LineID line) { m_statements.erase(line); }
+	void EraseStatement(LineID line);
+	// for a program paused before paused_line: the lines of edited changed since base swapped in, the others keep
+	// their statements and their compiled code. False, leaving this unchanged, if the paused line would be erased or
+	// its INPUT turned into another statement.
+	bool SwapEdits(const Program &edited, const Program &base, LineID paused_line);
 
-	inline void Clear() { m_statements.clear(); }
+	inline void Clear() {
+		m_statements.Clear();
+		m_writers.Clear();
+		m_nexts.Clear();
+	}
+	// O(1), false for equal programs edited separately
+	inline bool IsSameAs(const Program &other) const { return m_statements.IsSameAs(other.m_statements); }
+	// func(line, p_statement) for each line edited since base, a null statement is an erased line, O(k log n) for k
+	// edits of a copy of base
+	template <typename Func> inline void ForEachEdit(const Program &base, Func &&func) const {
+		m_statements.Diff(base.m_statements, [&func](LineID line, const auto *p_stmt, const auto *) {
+			func(line, p_stmt ? p_stmt->get() : nullptr);
+		});
+	}
+
+	template <typename Func> inline void ForEachStatement(Func &&func) const {
+		m_statements.ForEach([&func](const auto &it) { func(it.first, *it.second); });
+	}
 
 	inline String Format() const {
 		String lines;
-		for (const auto &it : m_statements)
+		m_statements.ForEach([&lines](const auto &it) {
 			lines += std::to_string(it.first) + ' ' + it.second->Format() + '\n';
+		});
 		return lines;
 	}
 
 	inline String FormatAST(const Context *p_state) const {
 		String lines;
-		for (const auto &it : m_statements)
+		m_statements.ForEach([&lines, p_state](const auto &it) {
 			lines += std::to_string(it.first) + ' ' + it.second->FormatAST(it.first, p_state);
+		});
 		return lines;
 	}
 };
@@ -0,0 +1,160 @@
+#include "Scheduler.hpp"
+
+namespace basic {
+
+Scheduler::Scheduler(std::size_t thread_count, Count slice_steps) : m_slice_steps{slice_steps} {
+	thread_count = std::max<std::size_t>(thread_count, 1);
+	m_workers.reserve(thread_count);
+	for (std::size_t i = 0; i < thread_count; ++i)
+		m_workers.emplace_back(&Scheduler::worker_loop, this);
+}
+
+Scheduler::~Scheduler() {
+	{
+		std::scoped_lock lock{m_mutex};
+		m_stopped = true;
+	}
+	m_condition.notify_all();
+	for (auto &worker : m_workers)
+		worker.join();
+}
+
+Scheduler::SessionHandle Scheduler::Submit(Program program, std::unique_ptr<Context> context, uint32_t priority,
+                                           SessionCallbacks callbacks) {
+	auto session = std::make_shared<Session>(std::move(program), std::move(context), priority, std::move(callbacks));
+	{
+		std::scoped_lock lock{m_mutex};
+		make_ready(session, false);
+	}
+	m_condition.notify_one();
+	return session;
+}
+
+void Scheduler::PushInput(const SessionHandle &session, StringView string) {
+	bool notify = false;
+	{
+		std::scoped_lock lock{m_mutex};
+		session->m_inputs.emplace(string);
+		if (session->m_state == Session::State::kBlocked) {
+			make_ready(session, true);
+			notify = true;
+		}
+	}
+	if (notify)
+		m_condition.notify_one();
+}
+
+void Scheduler::Terminate(const SessionHandle &session) {
+	session->m_terminated.store(true, std::memory_order_release);
+	bool notify = false;
+	{
+		std::scoped_lock lock{m_mutex};
+		if (session->m_state == Session::State::kBlocked) {
+			make_ready(session, true);
+			notify = true;
+		}
+	}
+	if (notify)
+		m_condition.notify_one();
+}
+
+void Scheduler::make_ready(const SessionHandle &session, bool woken) {
+	// A session waking up keeps neither the credit of its idle time nor the debt of its last run: no ready session has
+	// a lower virtual time than m_min_pass, so it runs before busy ones
+	session->m_pass = woken ? m_min_pass : std::max(session->m_pass, m_min_pass);
+	session->m_seq = m_seq++;
+	session->m_woken = woken;
+	session->m_state = Session::State::kReady;
+	m_ready.insert(session);
+}
+
+std::optional<RuntimeError> Scheduler::run_slice(Session *p_session, Count *p_steps) {
+	auto &context = p_session->m_context;
+	const auto &program = p_session->m_program;
+
+	if (context == nullptr) {
+		auto context_res = Context::Create(program);
+		if (context_res.IsError())
+			return context_res.PopError();
+		context = context_res.PopValue();
+	}
+
+	for (Count &step = *p_steps; step < m_slice_steps; ++step) {
+		if (p_session->m_terminated.load(std::memory_order_acquire))
+			context->Terminate();
+		if (context->IsTerminated())
+			return ErrTerminate{};
+
+		auto run_res = program.Step(context.get());
+		if (run_res.IsOK())
+			continue;
+
+		auto error = run_res.PopError();
+		bool print = false;
+		error.Visit([&print](const auto &error) { print = std::is_same_v<std::decay_t<decltype(error)>, MsgPrint>; });
+		if (!print)
+			return error;
+
+		if (p_session->m_callbacks.on_output)
+			p_session->m_callbacks.on_output(context->PopOutputs());
+	}
+	return std::nullopt;
+}
+
+void Scheduler::worker_loop() {
+	std::unique_lock lock{m_mutex};
+	while (true) {
+		m_condition.wait(lock, [this] { return m_stopped || !m_ready.empty(); });
+		if (m_stopped)
+			return;
+
+		SessionHandle session = *m_ready.begin();
+		m_ready.erase(m_ready.begin());
+		m_min_pass = session->m_pass;
+		session->m_state = Session::State::kRunning;
+		if (session->m_context)
+			for (; !session->m_inputs.empty(); session->m_inputs.pop())
+				session->m_context->PushInput(session->m_inputs.front());
+		lock.unlock();
+
+		Count steps = 0;
+		auto opt_error = run_slice(session.get(), &steps);
+		bool request_input = false;
+		if (opt_error.has_value()) {
+			opt_error->Visit([&request_input](const auto &error) {
+				request_input = std::is_same_v<std::decay_t<decltype(error)>, MsgRequestInput>;
+			});
+			auto outputs = session->m_context ? session->m_context->PopOutputs() : String{};
+			if (!outputs.empty() && session->m_callbacks.on_output)
+				session->m_callbacks.on_output(outputs);
+		}
+
+		lock.lock();
+		session->m_pass += steps * kStride / session->m_weight;
+
+		// preempted, or inputs (termination) arrived while running
+		if (!opt_error.has_value() ||
+		    (request_input && (!session->m_inputs.empty() || session->m_terminated.load(std::memory_order_acquire)))) {
+			make_ready(session, opt_error.has_value());
+			m_condition.notify_one();
+			continue;
+		}
+
+		if (request_input) {
+			session->m_state = Session::State::kBlocked;
+			LineID line = session->m_context->GetLine();
+			lock.unlock();
+			if (session->m_callbacks.on_input_request)
+				session->m_callbacks.on_input_request(line);
+		} else {
+			session->m_state = Session::State::kFinished;
+			lock.unlock();
+			if (session->m_callbacks.on_finish)
+				session->m_callbacks.on_finish(
+				    {std::move(session->m_program), std::move(session->m_context), std::move(opt_error.value())});
+		}
+		lock.lock();
+	}
+}
+
+} // namespace basic
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Machine.hpp"
+
+#include <condition_variable>
+#include <set>
+#include <vector>
+
+namespace basic {
+
+struct SessionCallbacks {
+	// called from worker threads, without the scheduler lock held
+	std::function<void(const String &outputs)> on_output;
+	std::function<void(LineID line)> on_input_request;
+	std::function<void(ExecuteResult result)> on_finish;
+};
+
+// Multiplexes many sessions onto a fixed thread pool. A session runs for a slice of statements, then is preempted
+// and re-queued. Sessions are picked by stride scheduling: each one advances its virtual time by the executed
+// statements divided by its weight (priority + 1), the one with the lowest virtual time runs next. Sessions waiting
+// for input are not queued until PushInput is called.
+class Scheduler {
+public:
+	class Session;
+	using SessionHandle = std::shared_ptr<Session>;
+
+	class Session {
+	private:
+		enum class State { kReady, kRunning, kBlocked, kFinished };
+
+		Program m_program;
+		std::unique_ptr<Context> m_context;
+		SessionCallbacks m_callbacks;
+		uint64_t m_weight, m_pass{}, m_seq{};
+		bool m_woken{};
+		State m_state{State::kReady};
+
+		// guarded by the scheduler mutex
+		std::queue<String> m_inputs;
+		std::atomic_bool m_terminated{false};
+
+		friend class Scheduler;
+
+	public:
+		inline Session(Program program, std::unique_ptr<Context> context, uint32_t priority,
+		               SessionCallbacks callbacks)
+		    : m_program{std::move(program)}, m_context{std::move(context)}, m_callbacks{std::move(callbacks)},
+		      m_weight{priority + 1ull} {}
+	};
+
+private:
+	inline static constexpr uint64_t kStride = 1u << 16u;
+
+	struct PassCompare {
+		inline bool operator()(const SessionHandle &l, const SessionHandle &r) const {
+			if (l->m_pass != r->m_pass)
+				return l->m_pass < r->m_pass;
+			if (l->m_woken != r->m_woken)
+				return l->m_woken;
+			return l->m_seq < r->m_seq;
+		}
+	};
+
+	Count m_slice_steps;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::set<SessionHandle, PassCompare> m_ready;
+	uint64_t m_min_pass{}, m_seq{};
+	bool m_stopped{false};
+	std::vector<std::thread> m_workers;
+
+	// woken for input (or termination), it takes the lowest virtual time and runs before the busy sessions with it
+	void make_ready(const SessionHandle &session, bool woken);
+	void worker_loop();
+	// run a slice of statements, returns the error if the session finished or is blocked on input
+	std::optional<RuntimeError> run_slice(Session *p_session, Count *p_steps);
+
+public:
+	explicit Scheduler(std::size_t thread_count = std::thread::hardware_concurrency(),
+	                   Count slice_steps = kSchedulerSliceSteps);
+	~Scheduler();
+
+	SessionHandle Submit(Program program, std::unique_ptr<Context> context, uint32_t priority,
+	                     SessionCallbacks callbacks);
+	void PushInput(const SessionHandle &session, StringView string);
+	void Terminate(const SessionHandle &session);
+};
+
+} // namespace basic
@@ -0,0 +1,62 @@
+#include "Script.hpp"
+
+#include "Context.hpp"
+
+namespace basic {
+
+ParseResult<Script> Script::Load(std::istream &istr) {
+	Script script;
+	String line;
+	while (std::getline(istr, line)) {
+		auto tokens = Token::Tokenize(line);
+		if (tokens.empty())
+			continue;
+
+		if (tokens[0].IsDigit()) {
+			auto line_id = tokens[0].ToDigit<LineID>();
+			if (tokens.size() == 1)
+				script.m_program.EraseStatement(line_id);
+			else {
+				std::unique_ptr<Statement> stmt;
+				BASIC_UNWRAP_ASSIGN(stmt, Statement::Parse({tokens.begin() + 1, tokens.end()}));
+				script.m_program.InsertStatement(line_id, std::move(stmt));
+			}
+		} else if (tokens[0].GetView() == "?")
+			script.m_inputs.push_back(Token::DeTokenize({tokens.begin() + 1, tokens.end()}));
+		else if (tokens.size() == 1 && tokens[0].GetView() == "CLEAR")
+			script.m_program.Clear();
+	}
+	return script;
+}
+
+void Script::Run(const Program &program, const std::vector<String> &inputs, std::ostream &ostr) {
+	auto context_res = Context::Create(program);
+	if (context_res.IsError()) {
+		ostr << context_res.PopError().Format() << '\n';
+		return;
+	}
+	auto context = context_res.PopValue();
+	for (const auto &input : inputs)
+		context->PushInput(input);
+
+	String outputs;
+	while (true) {
+		auto result = program.Step(context.get());
+		if (result.IsOK())
+			continue;
+
+		auto error = result.PopError();
+		bool print = false;
+		error.Visit([&print](const auto &error) { print = std::is_same_v<std::decay_t<decltype(error)>, MsgPrint>; });
+
+		context->PopOutputs(&outputs);
+		if (!outputs.empty())
+			ostr << outputs << '\n';
+		if (!print) {
+			ostr << '[' << context->GetLine() << ']' << error.Format() << '\n';
+			return;
+		}
+	}
+}
+
+} // namespace basic
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Program.hpp"
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace basic {
+
+// A script in the format accepted by the LOAD command: numbered lines edit the program, "? value" lines are inputs,
+// CLEAR clears the program, other commands are ignored.
+class Script {
+private:
+	Program m_program;
+	std::vector<String> m_inputs;
+
+public:
+	static ParseResult<Script> Load(std::istream &istr);
+
+	inline const Program &GetProgram() const { return m_program; }
+	inline const std::vector<String> &GetInputs() const { return m_inputs; }
+
+	// Run on the calling thread, write outputs and the final message ("[LINE]MESSAGE") to ostr.
+	// When inputs run out, the program stops with an input request.
+	static void Run(const Program &program, const std::vector<String> &inputs, std::ostream &ostr);
+	inline void Run(std::ostream &ostr) const { Run(m_program, m_inputs, ostr); }
+};
+
+} // namespace basic
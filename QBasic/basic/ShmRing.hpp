@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace basic {
+
+// Single-producer single-consumer byte ring placed in memory shared by two processes. Positions are free-running
+// counters, and a side announces itself before sleeping on a (process-shared) futex, so a transfer costs no syscall
+// unless the peer is asleep. A blocked side spins for a while first, for the peer answering quickly.
+template <uint32_t Capacity> class ShmRing {
+private:
+	static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity should be a power of 2");
+	inline static constexpr uint32_t kSpinCount = 1u << 12u;
+
+	alignas(64) std::atomic<uint32_t> m_head{}, m_reader_waiting{};
+	alignas(64) std::atomic<uint32_t> m_tail{}, m_writer_waiting{};
+	alignas(64) char m_data[Capacity];
+
+	inline static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+	// wait for *p_word to change from value, at most timeout_us (0 for no limit)
+	inline static void wait_change(std::atomic<uint32_t> *p_word, std::atomic<uint32_t> *p_waiting, uint32_t value,
+	                               uint32_t timeout_us) {
+		// on a single CPU the peer cannot run while spinning
+		static const uint32_t spin_count = std::thread::hardware_concurrency() > 1 ? kSpinCount : 0;
+		for (uint32_t i = 0; i < spin_count; ++i) {
+			if (p_word->load(std::memory_order_acquire) != value)
+				return;
+			cpu_relax();
+		}
+		p_waiting->store(1, std::memory_order_seq_cst);
+		if (p_word->load(std::memory_order_seq_cst) == value) {
+			timespec timeout{.tv_sec = timeout_us / 1000000, .tv_nsec = long(timeout_us % 1000000) * 1000};
+			syscall(SYS_futex, p_word, FUTEX_WAIT, value, timeout_us ? &timeout : nullptr, nullptr, 0);
+		}
+		p_waiting->store(0, std::memory_order_relaxed);
+	}
+	inline static void wake(std::atomic<uint32_t> *p_word, std::atomic<uint32_t> *p_waiting) {
+		if (p_waiting->load(std::memory_order_seq_cst))
+			syscall(SYS_futex, p_word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	}
+
+public:
+	// only when neither side is using it
+	inline void Reset() {
+		m_head.store(0, std::memory_order_relaxed);
+		m_tail.store(0, std::memory_order_relaxed);
+		m_reader_waiting.store(0, std::memory_order_relaxed);
+		m_writer_waiting.store(0, std::memory_order_relaxed);
+	}
+
+	// free-running count of the bytes read since the Reset
+	inline uint32_t GetReadCount() const { return m_tail.load(std::memory_order_acquire); }
+	inline uint32_t GetWriteCount() const { return m_head.load(std::memory_order_relaxed); }
+
+	inline bool Empty() const {
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed);
+	}
+
+	// Blocking transfers. poll is called before sleeping, then at least every timeout_us (0 for no limit), returning
+	// false aborts the transfer and returns false.
+	template <typename Poll> inline bool Write(const char *p_data, std::size_t size, uint32_t timeout_us, Poll &&poll) {
+		while (size) {
+			uint32_t head = m_head.load(std::memory_order_relaxed), tail = m_tail.load(std::memory_order_acquire);
+			uint32_t space = Capacity - (head - tail);
+			if (space == 0) {
+				if (!poll())
+					return false;
+				wait_change(&m_tail, &m_writer_waiting, tail, timeout_us);
+				continue;
+			}
+			uint32_t offset = head & (Capacity - 1);
+			uint32_t count = std::min({uint32_t(std::min<std::size_t>(size, Capacity)), space, Capacity - offset});
+			memcpy(m_data + offset, p_data, count);
+			m_head.store(head + count, std::memory_order_seq_cst);
+			wake(&m_head, &m_reader_waiting);
+			p_data += count;
+			size -= count;
+		}
+		return true;
+	}
+	template <typename Poll> inline bool Read(char *p_data, std::size_t size, uint32_t timeout_us, Poll &&poll) {
+		while (size) {
+			uint32_t tail = m_tail.load(std::memory_order_relaxed), head = m_head.load(std::memory_order_acquire);
+			uint32_t available = head - tail;
+			if (available == 0) {
+				if (!poll())
+					return false;
+				wait_change(&m_head, &m_reader_waiting, head, timeout_us);
+				continue;
+			}
+			uint32_t offset = tail & (Capacity - 1);
+			uint32_t count = std::min({uint32_t(std::min<std::size_t>(size, Capacity)), available, Capacity - offset});
+			memcpy(p_data, m_data + offset, count);
+			m_tail.store(tail + count, std::memory_order_seq_cst);
+			wake(&m_tail, &m_writer_waiting);
+			p_data += count;
+			size -= count;
+		}
+		return true;
+	}
+};
+
+} // namespace basic
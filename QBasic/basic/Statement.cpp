@@ -9,32 +9,32 @@ RuntimeResult<void> StmtRem::Run(const Program &program, Context *p_context) {
 	BASIC_UNWRAP(p_context->NextLine(program));
 	return {};
 }
+RuntimeResult<void> StmtDim::Run(const Program &program, Context *p_context) const {
+	Int size;
+	BASIC_UNWRAP_ASSIGN(size, expr_size->Eval(*p_context));
+	if (UInt(size) > UInt(kArrayMaxSize))
+		return ErrInvalidArraySize{.dim_str = var + "(" + IntToString(size) + ")"};
+	p_context->DimArray(var, Count(size));
+	BASIC_UNWRAP(p_context->NextLine(program));
+	return {};
+}
 RuntimeResult<void> StmtInput::Run(const Program &program, Context *p_context) const {
-	String input;
+	StringView input;
 	BASIC_UNWRAP_ASSIGN(input, p_context->PopInput());
 
-	std::vector<Token> tokens = Token::Tokenize(input);
-	if (tokens.empty() || tokens.size() > 2)
-		return ErrInvalidInput{input};
-
-	Int value;
-	if (tokens.size() == 1) {
-		if (!tokens[0].IsDigit())
-			return ErrInvalidInput{input};
-		value = tokens[0].ToDigit<Int>();
-	} else {
-		if (!tokens[1].IsDigit())
-			return ErrInvalidInput{input};
-		value = tokens[1].ToDigit<Int>();
-
-		StringView symbol = tokens[0].GetView();
-		if (symbol == "-")
-			value = -value;
-		else if (symbol != "+")
-			return ErrInvalidInput{input};
-	}
+	auto opt_value = Token::ParseInput(input);
+	if (!opt_value.has_value())
+		return ErrInvalidInput{String{input}};
 
-	p_context->SetVariable(var, value);
+	// the index after the input, a run retried after an input request evaluates it once
+	if (expr_index) {
+		Int index, *p_element;
+		BASIC_UNWRAP_ASSIGN(index, expr_index->Eval(*p_context));
+		BASIC_UNWRAP_ASSIGN(p_element, p_context->ElementRef(var, index));
+		*p_element = opt_value.value();
+		p_context->WroteElement(var, index, opt_value.value());
+	} else
+		p_context->SetVariable(var, opt_value.value());
 
 	BASIC_UNWRAP(p_context->NextLine(program));
 	return {};
@@ -42,14 +42,28 @@ RuntimeResult<void> StmtInput::Run(const Program &program, Context *p_context) c
 RuntimeResult<void> StmtPrint::Run(const Program &program, Context *p_context) const {
 	Int val;
 	BASIC_UNWRAP_ASSIGN(val, this->expr->Eval(*p_context));
-	p_context->PushOutput(std::to_string(val));
+	char buffer[kIntStringSize];
+	p_context->PushOutput(FormatInt(val, buffer));
 	BASIC_UNWRAP(p_context->NextLine(program));
 	return MsgPrint{};
 }
 RuntimeResult<void> StmtLet::Run(const Program &program, Context *p_context) const {
+	// the element is checked before the value is computed, evaluating it only reads, so the reference stays valid
+	Int index{};
+	Int *p_element = nullptr;
+	if (expr_index) {
+		BASIC_UNWRAP_ASSIGN(index, expr_index->Eval(*p_context));
+		BASIC_UNWRAP_ASSIGN(p_element, p_context->ElementRef(var, index));
+	}
+
 	Int value;
-	BASIC_UNWRAP_ASSIGN(value, expr->Eval(*p_context));
-	p_context->SetVariable(var, value);
+	if (!jit.Run(p_context, [this] { return JitCode::CompileLet(*expr); }, &value))
+		BASIC_UNWRAP_ASSIGN(value, expr->Eval(*p_context));
+	if (p_element) {
+		*p_element = value;
+		p_context->WroteElement(var, index, value);
+	} else
+		p_context->SetVariable(var, value);
 	BASIC_UNWRAP(p_context->NextLine(program));
 	return {};
 }
@@ -58,6 +72,12 @@ RuntimeResult<void> StmtGoto::Run(const Program &program, Context *p_context) co
 	return {};
 }
 RuntimeResult<void> StmtIf::Run(const Program &program, Context *p_context) const {
+	Int value;
+	if (jit.Run(p_context, [this] { return JitCode::CompileIf(*expr_l, cmp, *expr_r); }, &value)) {
+		BASIC_UNWRAP(value ? p_context->GotoBranchLine(program, line_then) : p_context->NextLine(program));
+		return {};
+	}
+
 	Int value_l, value_r;
 	BASIC_UNWRAP_ASSIGN(value_l, expr_l->Eval(*p_context));
 	BASIC_UNWRAP_ASSIGN(value_r, expr_r->Eval(*p_context));
@@ -72,22 +92,105 @@ RuntimeResult<void> StmtIf::Run(const Program &program, Context *p_context) cons
 	BASIC_UNWRAP(branch ? p_context->GotoBranchLine(program, line_then) : p_context->NextLine(program));
 	return {};
 }
+RuntimeResult<void> StmtFor::Run(const Program &program, Context *p_context) const {
+	Int from, to, step;
+	BASIC_UNWRAP_ASSIGN(from, expr_from->Eval(*p_context));
+	BASIC_UNWRAP_ASSIGN(to, expr_to->Eval(*p_context));
+	if (opt_step.has_value())
+		step = opt_step.value();
+	else
+		BASIC_UNWRAP_ASSIGN(step, expr_step->Eval(*p_context));
+	p_context->SetVariable(var, from);
+
+	// an empty range goes past the NEXT without running the body
+	if (step < 0 ? from < to : from > to) {
+		p_context->DropLoop(var);
+		LineID next_line;
+		BASIC_UNWRAP_ASSIGN(next_line, program.FindNext(p_context->GetLine(), var));
+		BASIC_UNWRAP_ASSIGN(next_line, program.GetNextLine(next_line));
+		BASIC_UNWRAP(p_context->GotoBranchLine(program, next_line));
+		return {};
+	}
+	LineID body_line;
+	BASIC_UNWRAP_ASSIGN(body_line, program.GetNextLine(p_context->GetLine()));
+	p_context->PushLoop({.var = var, .body_line = body_line, .limit = to, .step = step});
+	BASIC_UNWRAP(p_context->GotoLine(program, body_line));
+	return {};
+}
+RuntimeResult<void> StmtNext::Run(const Program &program, Context *p_context) const {
+	LoopFrame *p_loop = p_context->FindLoop(var);
+	if (p_loop == nullptr)
+		return ErrNextWithoutFor{.var = var};
+
+	// no expression to evaluate, the step and the limit are in the frame
+	Int value;
+	if (p_context->StepVariable(var, p_loop->step, &value) &&
+	    (p_loop->step < 0 ? value >= p_loop->limit : value <= p_loop->limit)) {
+		BASIC_UNWRAP(p_context->GotoBranchLine(program, p_loop->body_line));
+		return {};
+	}
+	p_context->PopLoop();
+	BASIC_UNWRAP(p_context->NextLine(program));
+	return {};
+}
 RuntimeResult<void> StmtEnd::Run(const Program &program, Context *p_context) { return MsgEndOfProgram{}; }
+RuntimeResult<void> StmtTrap::Run(const Program &program, Context *p_context) const {
+	// the statement runs when resumed from its breakpoint, or re-runs after an input request
+	if (breakpoint && !p_context->IsBreakPassed()) {
+		p_context->PassBreak();
+		return MsgBreakpoint{};
+	}
+	if (watch_var.empty())
+		return stmt->Run(program, p_context);
+
+	const Int *p_value = p_context->FindVariable(watch_var);
+	std::optional<Int> opt_prev_value = p_value ? std::optional<Int>{*p_value} : std::nullopt;
+	BASIC_UNWRAP(stmt->Run(program, p_context));
+	Int value = *p_context->FindVariable(watch_var);
+	if (opt_prev_value != value)
+		return MsgWatchpoint{.var = watch_var, .value = value};
+	return {};
+}
+
+std::shared_ptr<const Statement> Statement::Trap(std::shared_ptr<const Statement> stmt, bool breakpoint,
+                                                 String watch_var) {
+	Count node_count = stmt->m_node_count;
+	auto ret = std::make_shared<Statement>(
+	    StmtTrap{.stmt = std::move(stmt), .breakpoint = breakpoint, .watch_var = std::move(watch_var)});
+	ret->m_node_count = node_count;
+	return ret;
+}
 
 // Format AST
 #define AST_STMT_END (p_context ? "[execute:" + std::to_string(p_context->GetLineStat(line)) + "]" : "")
 #define AST_VAR_END (p_context ? "[use:" + std::to_string(p_context->GetVariableStat(this->var)) + "]" : "")
+
+// the written variable, or the array with its index below
+static String format_target_ast(const String &var, const std::unique_ptr<Expression> &expr_index,
+                                const Context *p_context) {
+	String use_str;
+	if (p_context)
+		use_str = "[use:" +
+		          std::to_string(expr_index ? p_context->GetArrayStat(var) : p_context->GetVariableStat(var)) + "]";
+	if (expr_index == nullptr)
+		return kASTFormatAlign + var + " " + use_str + "\n";
+	return kASTFormatAlign + var + "() " + use_str + "\n" +
+	       expr_index->FormatAST(String(kASTFormatAlign) + kASTFormatAlign);
+}
 String StmtRem::FormatAST(LineID line, const Context *p_context) const {
 	return AST_STMT_END + "\n" + (this->comment.empty() ? "" : kASTFormatAlign + this->comment + "\n");
 }
+String StmtDim::FormatAST(LineID line, const Context *p_context) const {
+	return AST_STMT_END + "\n" + format_target_ast(this->var, this->expr_size, p_context);
+}
 String StmtInput::FormatAST(LineID line, const Context *p_context) const {
-	return AST_STMT_END + "\n" + kASTFormatAlign + this->var + " " + AST_VAR_END + "\n";
+	return AST_STMT_END + "\n" + format_target_ast(this->var, this->expr_index, p_context);
 }
 String StmtPrint::FormatAST(LineID line, const Context *p_context) const {
 	return AST_STMT_END + "\n" + this->expr->FormatAST(kASTFormatAlign);
 }
 String StmtLet::FormatAST(LineID line, const Context *p_context) const {
-	return "= " + AST_STMT_END + "\n" + kASTFormatAlign + this->var + " " + AST_VAR_END + "\n" +
+	return "= " + AST_STMT_END + "\n" + format_target_ast(this->var, this->expr_index, p_context) +
 	       this->expr->FormatAST(kASTFormatAlign);
 }
 String StmtGoto::FormatAST(LineID, const Context *p_context) const {
@@ -103,6 +206,29 @@ String StmtIf::FormatAST(LineID line, const Context *p_context) const {
 	return "THEN " + line_end_str + "\n" + this->expr_l->FormatAST(kASTFormatAlign) + kASTFormatAlign + this->cmp +
 	       "\n" + this->expr_r->FormatAST(kASTFormatAlign) + kASTFormatAlign + std::to_string(line_then) + "\n";
 }
+String StmtFor::FormatAST(LineID line, const Context *p_context) const {
+	String line_end_str;
+	if (p_context) {
+		Count skip_cnt = p_context->GetBranchStat(line);
+		Count enter_cnt = p_context->GetLineStat(line) - skip_cnt;
+		line_end_str = "[enter:" + std::to_string(enter_cnt) + "] [skip:" + std::to_string(skip_cnt) + "]";
+	}
+	String ret = "= " + line_end_str + "\n" + kASTFormatAlign + this->var + " " + AST_VAR_END + "\n" +
+	             this->expr_from->FormatAST(kASTFormatAlign) + kASTFormatAlign + "TO\n" +
+	             this->expr_to->FormatAST(kASTFormatAlign);
+	if (this->expr_step)
+		ret += kASTFormatAlign + String("STEP\n") + this->expr_step->FormatAST(kASTFormatAlign);
+	return ret;
+}
+String StmtNext::FormatAST(LineID line, const Context *p_context) const {
+	String line_end_str;
+	if (p_context) {
+		Count continue_cnt = p_context->GetBranchStat(line);
+		Count exit_cnt = p_context->GetLineStat(line) - continue_cnt;
+		line_end_str = "[continue:" + std::to_string(continue_cnt) + "] [exit:" + std::to_string(exit_cnt) + "]";
+	}
+	return line_end_str + "\n" + kASTFormatAlign + this->var + " " + AST_VAR_END + "\n";
+}
 String StmtEnd::FormatAST(LineID line, const Context *p_context) { return AST_STMT_END + "\n"; }
 
 } // namespace basic
@@ -1,15 +1,23 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <variant>
 
 #include "Config.hpp"
 #include "Expression.hpp"
+#include "Jit.hpp"
 
 namespace basic {
 
 class Context;
 class Program;
+class Statement;
+
+// "var", or "var(index)" for an array element, written by LET and INPUT
+inline String FormatTarget(const String &var, const std::unique_ptr<Expression> &expr_index) {
+	return expr_index ? var + "(" + expr_index->Format() + ")" : var;
+}
 
 struct StmtRem {
 	inline static constexpr const char *kKeyWord = "REM";
@@ -21,14 +29,27 @@ struct StmtRem {
 	inline String Format() const { return comment; }
 	String FormatAST(LineID line, const Context *p_context) const;
 };
+// DIM a(n) gives a n zeros, indexed from 0 to n - 1
+struct StmtDim {
+	inline static constexpr const char *kKeyWord = "DIM";
+
+	String var;
+	std::unique_ptr<Expression> expr_size;
+	RuntimeResult<void> Run(const Program &program, Context *p_context) const;
+	ParseResult<void> Parse(std::span<const Token> tokens);
+
+	inline String Format() const { return var + "(" + expr_size->Format() + ")"; }
+	String FormatAST(LineID line, const Context *p_context) const;
+};
 struct StmtInput {
 	inline static constexpr const char *kKeyWord = "INPUT";
 
 	String var;
+	std::unique_ptr<Expression> expr_index; // nullptr for a variable
 	RuntimeResult<void> Run(const Program &program, Context *p_context) const;
 	ParseResult<void> Parse(std::span<const Token> tokens);
 
-	inline String Format() const { return var; }
+	inline String Format() const { return FormatTarget(var, expr_index); }
 	String FormatAST(LineID line, const Context *p_context) const;
 };
 struct StmtPrint {
@@ -45,11 +66,12 @@ struct StmtLet {
 	inline static constexpr const char *kKeyWord = "LET";
 
 	String var;
-	std::unique_ptr<Expression> expr;
+	std::unique_ptr<Expression> expr_index, expr; // expr_index is nullptr for a variable
+	JitSlot jit;
 	RuntimeResult<void> Run(const Program &program, Context *p_context) const;
 	ParseResult<void> Parse(std::span<const Token> tokens);
 
-	inline String Format() const { return var + " = " + expr->Format(); }
+	inline String Format() const { return FormatTarget(var, expr_index) + " = " + expr->Format(); }
 	String FormatAST(LineID line, const Context *p_context) const;
 };
 struct StmtGoto {
@@ -68,6 +90,7 @@ struct StmtIf {
 	std::unique_ptr<Expression> expr_l, expr_r;
 	Char cmp;
 	LineID line_then;
+	JitSlot jit;
 	RuntimeResult<void> Run(const Program &program, Context *p_context) const;
 	ParseResult<void> Parse(std::span<const Token> tokens);
 
@@ -76,6 +99,33 @@ struct StmtIf {
 	}
 	String FormatAST(LineID line, const Context *p_context) const;
 };
+// Loops over var from expr_from to expr_to, the bounds and the step are evaluated once when entered. A constant step
+// (a literal, 1 if omitted) is folded by Parse.
+struct StmtFor {
+	inline static constexpr const char *kKeyWord = "FOR";
+
+	String var;
+	std::unique_ptr<Expression> expr_from, expr_to, expr_step; // expr_step is nullptr if omitted
+	std::optional<Int> opt_step;
+	RuntimeResult<void> Run(const Program &program, Context *p_context) const;
+	ParseResult<void> Parse(std::span<const Token> tokens);
+
+	inline String Format() const {
+		return var + " = " + expr_from->Format() + " TO " + expr_to->Format() +
+		       (expr_step ? " STEP " + expr_step->Format() : "");
+	}
+	String FormatAST(LineID line, const Context *p_context) const;
+};
+struct StmtNext {
+	inline static constexpr const char *kKeyWord = "NEXT";
+
+	String var;
+	RuntimeResult<void> Run(const Program &program, Context *p_context) const;
+	ParseResult<void> Parse(std::span<const Token> tokens);
+
+	inline String Format() const { return var; }
+	String FormatAST(LineID line, const Context *p_context) const;
+};
 struct StmtEnd {
 	inline static constexpr const char *kKeyWord = "END";
 
@@ -86,28 +136,97 @@ struct StmtEnd {
 	static String FormatAST(LineID line, const Context *p_context);
 };
 
+// Installed by Program::Patch in place of a statement of a debugged snapshot, never parsed. A breakpoint pauses
+// before running the statement, a watchpoint runs it and pauses if it changed the watched variable.
+struct StmtTrap {
+	inline static constexpr const char *kKeyWord = "";
+
+	std::shared_ptr<const Statement> stmt;
+	bool breakpoint;
+	String watch_var; // empty if not watched
+	RuntimeResult<void> Run(const Program &program, Context *p_context) const;
+	static ParseResult<void> Parse(std::span<const Token> tokens);
+};
+
 class Statement {
 private:
-	using Variant = std::variant<StmtRem, StmtInput, StmtPrint, StmtLet, StmtGoto, StmtIf, StmtEnd>;
+	using Variant = std::variant<StmtRem, StmtDim, StmtInput, StmtPrint, StmtLet, StmtGoto, StmtIf, StmtFor, StmtNext,
+	                             StmtEnd, StmtTrap>;
 	Variant m_stmt;
+	Count m_node_count{}; // expression nodes evaluated by a run, computed by Parse
+
+	inline Count count_nodes() const {
+		return std::visit(
+		    [](const auto &stmt) -> Count {
+			    if constexpr (requires { stmt.expr_l; })
+				    return stmt.expr_l->GetNodeCount() + stmt.expr_r->GetNodeCount();
+			    else if constexpr (requires { stmt.expr_from; })
+				    return stmt.expr_from->GetNodeCount() + stmt.expr_to->GetNodeCount() +
+				           (stmt.opt_step.has_value() ? 0 : stmt.expr_step->GetNodeCount());
+			    else if constexpr (requires { stmt.expr_size; })
+				    return stmt.expr_size->GetNodeCount();
+			    else {
+				    Count count = 0;
+				    if constexpr (requires { stmt.expr; })
+					    count += stmt.expr->GetNodeCount();
+				    if constexpr (requires { stmt.expr_index; })
+					    count += stmt.expr_index ? stmt.expr_index->GetNodeCount() : 0;
+				    return count;
+			    }
+		    },
+		    m_stmt);
+	}
 
 public:
 	template <typename T> inline Statement(T &&stmt) : m_stmt{std::forward<T>(stmt)} {}
 	static ParseResult<std::unique_ptr<Statement>> Parse(std::span<const Token> tokens);
 
+	inline Count GetNodeCount() const { return m_node_count; }
+	// the variable written by the statement, nullptr if it writes none or an array element
+	inline const String *GetVariable() const {
+		return std::visit(
+		    [](const auto &stmt) -> const String * {
+			    using Stmt = std::decay_t<decltype(stmt)>;
+			    if constexpr (std::is_same_v<Stmt, StmtTrap>)
+				    return stmt.stmt->GetVariable();
+			    else if constexpr (requires { stmt.expr_index; })
+				    return stmt.expr_index ? nullptr : &stmt.var;
+			    else if constexpr (std::is_same_v<Stmt, StmtFor> || std::is_same_v<Stmt, StmtNext>)
+				    return &stmt.var;
+			    else
+				    return nullptr;
+		    },
+		    m_stmt);
+	}
+	static std::shared_ptr<const Statement> Trap(std::shared_ptr<const Statement> stmt, bool breakpoint,
+	                                             String watch_var);
+
 	inline RuntimeResult<void> Run(const Program &program, Context *p_context) const {
 		return std::visit([&program, p_context](const auto &stmt) { return stmt.Run(program, p_context); }, m_stmt);
 	}
 	inline String Format() const {
-		return std::visit([](const auto &stmt) { return String(stmt.kKeyWord) + " " + stmt.Format(); }, m_stmt);
+		return std::visit(
+		    [](const auto &stmt) {
+			    if constexpr (std::is_same_v<std::decay_t<decltype(stmt)>, StmtTrap>)
+				    return stmt.stmt->Format();
+			    else
+				    return String(stmt.kKeyWord) + " " + stmt.Format();
+		    },
+		    m_stmt);
 	}
 	inline String FormatAST(LineID line, const Context *p_context) const {
 		return std::visit(
 		    [line, p_context](const auto &stmt) {
-			    return String(stmt.kKeyWord) + " " + stmt.FormatAST(line, p_context);
+			    if constexpr (std::is_same_v<std::decay_t<decltype(stmt)>, StmtTrap>)
+				    return stmt.stmt->FormatAST(line, p_context);
+			    else
+				    return String(stmt.kKeyWord) + " " + stmt.FormatAST(line, p_context);
 		    },
 		    m_stmt);
 	}
+	template <typename Visitor> inline decltype(auto) Visit(Visitor &&visitor) const {
+		return std::visit(std::forward<Visitor>(visitor), m_stmt);
+	}
 };
 
 } // namespace basic
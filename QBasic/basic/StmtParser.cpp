@@ -5,6 +5,53 @@
 
 namespace basic {
 
+namespace {
+
+// value of a literal, optionally signed, nullopt for other expressions or if negating it overflows
+std::optional<Int> constant_value(const Expression &expression) {
+	return expression.Visit([](const auto &expr) -> std::optional<Int> {
+		using Expr = std::decay_t<decltype(expr)>;
+		if constexpr (std::is_same_v<Expr, ExprNum>)
+			return expr.value;
+		else if constexpr (std::is_same_v<Expr, ExprPos> || std::is_same_v<Expr, ExprNeg>) {
+			auto opt_value = constant_value(*expr.child);
+			if (!opt_value.has_value())
+				return std::nullopt;
+			auto value_res = expr.Eval(opt_value.value());
+			return value_res.IsOK() ? std::optional<Int>{value_res.PopValue()} : std::nullopt;
+		} else
+			return std::nullopt;
+	});
+}
+
+// position of the first keyword in tokens[begin, end)
+std::optional<std::size_t> find_keyword(std::span<const Token> tokens, std::size_t begin, StringView keyword) {
+	for (std::size_t i = begin; i < tokens.size(); ++i)
+		if (tokens[i].IsKeyword(keyword))
+			return i;
+	return std::nullopt;
+}
+
+// a variable, or an array element with its index moved to *p_expr_index (nullptr for a variable)
+ParseResult<void> parse_target(std::span<const Token> tokens, std::span<const Token> target_tokens, String *p_var,
+                               std::unique_ptr<Expression> *p_expr_index) {
+	const auto invalid = [&] {
+		return ErrInvalidVariable{.stmt_str = Token::DeTokenize(tokens), .var_str = Token::DeTokenize(target_tokens)};
+	};
+	if (target_tokens.empty() || !target_tokens[0].IsVariable())
+		return invalid();
+	*p_var = target_tokens[0].GetString();
+	if (target_tokens.size() == 1)
+		return {};
+
+	auto expr_res = Expression::Parse(target_tokens);
+	if (expr_res.IsError() || (*p_expr_index = expr_res.PopValue()->ReleaseIndex()) == nullptr)
+		return invalid();
+	return {};
+}
+
+} // namespace
+
 ParseResult<std::unique_ptr<Statement>> Statement::Parse(std::span<const Token> tokens) {
 	if (tokens.empty())
 		return ErrEmptyStmt{};
@@ -26,20 +73,27 @@ ParseResult<std::unique_ptr<Statement>> Statement::Parse(std::span<const Token>
 		return ErrInvalidToken{.stmt_str = Token::DeTokenize(tokens), .token_str = tokens[0].GetString()};
 
 	BASIC_UNWRAP(std::visit([&](auto &&stmt) -> ParseResult<void> { return stmt.Parse(tokens); }, stmt_ptr->m_stmt));
+	stmt_ptr->m_node_count = stmt_ptr->count_nodes();
 	return std::move(stmt_ptr);
 }
 // Parsers (tokens.size() >= 1, tokens[0] is its keyword)
+ParseResult<void> StmtTrap::Parse(std::span<const Token> tokens) {
+	return ErrInvalidToken{.stmt_str = Token::DeTokenize(tokens), .token_str = tokens[0].GetString()};
+}
 ParseResult<void> StmtRem::Parse(std::span<const Token> tokens) {
 	this->comment = Token::DeTokenize(tokens.subspan(1));
 	return {};
 }
-ParseResult<void> StmtInput::Parse(std::span<const Token> tokens) {
-	if (tokens.size() != 2 || !tokens[1].IsVariable())
+ParseResult<void> StmtDim::Parse(std::span<const Token> tokens) {
+	BASIC_UNWRAP(parse_target(tokens, tokens.subspan(1), &this->var, &this->expr_size));
+	if (this->expr_size == nullptr)
 		return ErrInvalidVariable{.stmt_str = Token::DeTokenize(tokens),
 		                          .var_str = Token::DeTokenize(tokens.subspan(1))};
-	this->var = tokens[1].GetString();
 	return {};
 }
+ParseResult<void> StmtInput::Parse(std::span<const Token> tokens) {
+	return parse_target(tokens, tokens.subspan(1), &this->var, &this->expr_index);
+}
 ParseResult<void> StmtPrint::Parse(std::span<const Token> tokens) {
 	BASIC_UNWRAP_ASSIGN(this->expr, Expression::Parse(tokens.subspan(1)));
 	return {};
@@ -57,12 +111,7 @@ ParseResult<void> StmtLet::Parse(std::span<const Token> tokens) {
 
 	BASIC_UNWRAP_ASSIGN(this->expr, Expression::Parse(tokens.subspan(equal_pos + 1)));
 
-	std::span<const Token> var_tokens = tokens.subspan(1, equal_pos - 1);
-	if (var_tokens.size() != 1 || !var_tokens[0].IsVariable())
-		return ErrInvalidVariable{.stmt_str = Token::DeTokenize(tokens), .var_str = Token::DeTokenize(var_tokens)};
-
-	this->var = var_tokens[0].GetString();
-	return {};
+	return parse_target(tokens, tokens.subspan(1, equal_pos - 1), &this->var, &this->expr_index);
 }
 ParseResult<void> StmtGoto::Parse(std::span<const Token> tokens) {
 	if (tokens.size() != 2 || !tokens[1].IsDigit())
@@ -114,6 +163,38 @@ ParseResult<void> StmtIf::Parse(std::span<const Token> tokens) {
 	this->line_then = line_tokens[0].ToDigit<LineID>();
 	return {};
 }
+ParseResult<void> StmtFor::Parse(std::span<const Token> tokens) {
+	auto opt_equal_pos = find_keyword(tokens, 1, "=");
+	if (!opt_equal_pos.has_value())
+		return ErrMissingToken{.stmt_str = Token::DeTokenize(tokens), .token_str = "="};
+	std::size_t equal_pos = opt_equal_pos.value();
+	auto opt_to_pos = find_keyword(tokens, equal_pos + 1, "TO");
+	if (!opt_to_pos.has_value())
+		return ErrMissingToken{.stmt_str = Token::DeTokenize(tokens), .token_str = "TO"};
+	std::size_t to_pos = opt_to_pos.value();
+	std::size_t step_pos = find_keyword(tokens, to_pos + 1, "STEP").value_or(tokens.size());
+
+	std::span<const Token> var_tokens = tokens.subspan(1, equal_pos - 1);
+	if (var_tokens.size() != 1 || !var_tokens[0].IsVariable())
+		return ErrInvalidVariable{.stmt_str = Token::DeTokenize(tokens), .var_str = Token::DeTokenize(var_tokens)};
+	this->var = var_tokens[0].GetString();
+
+	BASIC_UNWRAP_ASSIGN(this->expr_from, Expression::Parse(tokens.subspan(equal_pos + 1, to_pos - equal_pos - 1)));
+	BASIC_UNWRAP_ASSIGN(this->expr_to, Expression::Parse(tokens.subspan(to_pos + 1, step_pos - to_pos - 1)));
+	if (step_pos < tokens.size()) {
+		BASIC_UNWRAP_ASSIGN(this->expr_step, Expression::Parse(tokens.subspan(step_pos + 1)));
+		this->opt_step = constant_value(*this->expr_step);
+	} else
+		this->opt_step = 1;
+	return {};
+}
+ParseResult<void> StmtNext::Parse(std::span<const Token> tokens) {
+	if (tokens.size() != 2 || !tokens[1].IsVariable())
+		return ErrInvalidVariable{.stmt_str = Token::DeTokenize(tokens),
+		                          .var_str = Token::DeTokenize(tokens.subspan(1))};
+	this->var = tokens[1].GetString();
+	return {};
+}
 ParseResult<void> StmtEnd::Parse(std::span<const Token> tokens) {
 	if (tokens.size() > 1)
 		return ErrInvalidToken{.stmt_str = Token::DeTokenize(tokens), .token_str = tokens[1].GetString()};
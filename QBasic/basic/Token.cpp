@@ -2,6 +2,24 @@
 
 namespace basic {
 
+namespace {
+
+// end of the token beginning at a non-space line[i]
+inline std::size_t token_end(StringView line, std::size_t i) {
+	std::size_t j = i + 1;
+	for (; j < line.length(); ++j) {
+		if (isspace(line[j]))
+			break;
+
+		bool merge = isalnum(line[j - 1]) && isalnum(line[j]) || line[j - 1] == line[j];
+		if (!merge)
+			break;
+	}
+	return j;
+}
+
+} // namespace
+
 std::vector<Token> Token::Tokenize(StringView line) {
 	std::shared_ptr<Char[]> shared_str = std::make_shared<Char[]>(line.length());
 	std::copy(line.begin(), line.end(), shared_str.get());
@@ -14,15 +32,7 @@ std::vector<Token> Token::Tokenize(StringView line) {
 			continue;
 		}
 
-		std::size_t j = i + 1;
-		for (; j < line.length(); ++j) {
-			if (isspace(line[j]))
-				break;
-
-			bool merge = isalnum(line[j - 1]) && isalnum(line[j]) || line[j - 1] == line[j];
-			if (!merge)
-				break;
-		}
+		std::size_t j = token_end(line, i);
 
 		Token token;
 		token.m_shared_str = shared_str;
@@ -36,4 +46,35 @@ std::vector<Token> Token::Tokenize(StringView line) {
 	return std::move(tokens);
 }
 
-} // namespace basic
\ No newline at end of file
+std::optional<Int> Token::ParseInput(StringView input) {
+	StringView tokens[2];
+	std::size_t count = 0;
+	for (std::size_t i = 0; i < input.length();) {
+		if (isspace(input[i])) {
+			++i;
+			continue;
+		}
+		if (count == 2)
+			return std::nullopt;
+		std::size_t j = token_end(input, i);
+		tokens[count++] = input.substr(i, j - i);
+		i = j;
+	}
+	if (count == 0)
+		return std::nullopt;
+
+	StringView digits = tokens[count - 1];
+	if (!std::all_of(digits.begin(), digits.end(), isdigit))
+		return std::nullopt;
+	UInt value = 0;
+	for (char c : digits)
+		value = value * 10 + UInt(c - '0');
+
+	if (count == 1 || tokens[0] == "+")
+		return Int(value);
+	if (tokens[0] == "-")
+		return Int(-value);
+	return std::nullopt;
+}
+
+} // namespace basic
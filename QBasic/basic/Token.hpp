@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <cctype>
 #include <memory>
+#include <optional>
 #include <span>
 #include <vector>
 
@@ -22,12 +23,13 @@ public:
 		StringView view = GetView();
 		return std::all_of(view.begin(), view.end(), isdigit);
 	}
+	// modulo the width of T
 	template <typename T> inline T ToDigit() const {
-		T ret = 0;
+		UInt ret = 0;
 		StringView view = GetView();
 		for (char c : view)
-			ret = ret * 10 + c - '0';
-		return ret;
+			ret = ret * 10 + UInt(c - '0');
+		return T(ret);
 	}
 	// TODO: support '_'
 	inline bool IsVariable() const {
@@ -37,6 +39,9 @@ public:
 	inline bool IsKeyword(StringView keyword) const { return GetView() == keyword; }
 
 	static std::vector<Token> Tokenize(StringView line);
+	// An INPUT value: a digit token, optionally after a "+" or "-" token. Accepts exactly what tokenizing the input
+	// accepts, without allocating.
+	static std::optional<Int> ParseInput(StringView input);
 
 	inline static String DeTokenize(std::span<const Token> tokens) {
 		if (tokens.empty())
@@ -0,0 +1,152 @@
+#include "Trace.hpp"
+
+#include "Token.hpp"
+
+namespace basic {
+
+void Context::trace_write(const String &var, Int val) const { m_p_tracer->Write(var, val); }
+void Context::trace_write(const String &var, Int index, Int val) const {
+	m_p_tracer->Write(var + "(" + IntToString(index) + ")", val);
+}
+void Context::trace_input(StringView input) const { m_p_tracer->Input(String{input}); }
+
+TraceWriter::TraceWriter(std::ostream &ostr, const Program &program, const Context *p_context)
+    : m_ostr{ostr} {
+	m_ostr.write(kVersionStr, sizeof(kVersionStr));
+	Checkpoint::Write(m_ostr, program, p_context);
+}
+
+void TraceWriter::Flush() {
+	m_ostr.write(m_buffer.data(), (std::streamsize)m_size);
+	m_ostr.flush();
+	m_size = 0;
+}
+
+std::optional<TraceReader> TraceReader::Open(std::istream &istr) {
+	char version_str[sizeof(TraceWriter::kVersionStr)]{};
+	istr.read(version_str, sizeof(version_str));
+	if (!istr || memcmp(TraceWriter::kVersionStr, version_str, sizeof(version_str)) != 0)
+		return std::nullopt;
+
+	auto opt_checkpoint = Checkpoint::Read(istr);
+	if (!opt_checkpoint.has_value())
+		return std::nullopt;
+	return TraceReader{istr, std::move(opt_checkpoint.value())};
+}
+
+bool TraceReader::Next(TraceRecord *p_record) {
+	int tag = m_istr.get();
+	if (tag == std::char_traits<char>::eof())
+		return false;
+
+	p_record->event = TraceEvent(tag);
+	switch (p_record->event) {
+	case TraceEvent::kLine:
+		p_record->line = Serializer<uint32_t>::Read(m_istr);
+		break;
+	case TraceEvent::kTimedLine:
+		p_record->line = Serializer<uint32_t>::Read(m_istr);
+		p_record->time_ns = Serializer<uint64_t>::Read(m_istr);
+		break;
+	case TraceEvent::kWrite:
+		p_record->str = Serializer<String>::Read(m_istr);
+		p_record->value = Serializer<Int>::Read(m_istr);
+		break;
+	case TraceEvent::kInput:
+		p_record->str = Serializer<String>::Read(m_istr);
+		break;
+	default:
+		return false;
+	}
+	return bool(m_istr);
+}
+
+namespace {
+
+// a variable, or an array element written as "a(5)"
+const Int *find_written(const Context &context, const String &name) {
+	if (name.empty() || name.back() != ')')
+		return context.FindVariable(name);
+	auto bracket = name.find('(');
+	if (bracket == String::npos)
+		return nullptr;
+	auto opt_index = Token::ParseInput(StringView{name}.substr(bracket + 1, name.size() - bracket - 2));
+	const std::vector<Int> *p_array = context.FindArray(name.substr(0, bracket));
+	if (!opt_index.has_value() || p_array == nullptr || UInt(opt_index.value()) >= UInt(p_array->size()))
+		return nullptr;
+	return &(*p_array)[opt_index.value()];
+}
+
+} // namespace
+
+std::optional<TraceReplayResult> ReplayTrace(std::istream &istr, std::ostream &ostr) {
+	auto opt_reader = TraceReader::Open(istr);
+	if (!opt_reader.has_value())
+		return std::nullopt;
+	TraceReader &reader = opt_reader.value();
+
+	const Program &program = reader.GetCheckpoint().program;
+	std::unique_ptr<Context> context = std::move(reader.GetCheckpoint().context);
+	TraceReplayResult ret{};
+	const auto diverge = [&ret](String divergence) -> std::optional<TraceReplayResult> {
+		ret.divergence = std::move(divergence);
+		return ret;
+	};
+
+	// each group is a line record followed by the writes and inputs of that step
+	TraceRecord record;
+	bool has_record = reader.Next(&record);
+	while (has_record) {
+		if (record.event != TraceEvent::kLine && record.event != TraceEvent::kTimedLine)
+			return diverge("Unexpected record without a line");
+		if (context == nullptr) {
+			auto context_res = Context::Create(program);
+			if (context_res.IsError())
+				return diverge("Unable to start: " + context_res.PopError().Format());
+			context = context_res.PopValue();
+		}
+		if (context->GetLine() != record.line)
+			return diverge("Executed line " + std::to_string(context->GetLine()) + " instead of " +
+			               std::to_string(record.line));
+		LineID line = record.line;
+
+		std::vector<std::pair<String, Int>> writes;
+		while ((has_record = reader.Next(&record)) && record.event != TraceEvent::kLine &&
+		       record.event != TraceEvent::kTimedLine) {
+			if (record.event == TraceEvent::kInput)
+				context->PushInput(record.str);
+			else
+				writes.emplace_back(std::move(record.str), record.value);
+		}
+
+		++ret.lines;
+		auto step_res = program.Step(context.get());
+		String outputs = context->PopOutputs();
+		if (!outputs.empty())
+			ostr << outputs << '\n';
+
+		for (const auto &[var, value] : writes) {
+			const Int *p_value = find_written(*context, var);
+			if (p_value == nullptr || *p_value != value)
+				return diverge("Line " + std::to_string(line) + " did not write " + var + " = " +
+				               IntToString(value));
+		}
+
+		if (step_res.IsError()) {
+			auto error = step_res.PopError();
+			bool resume = false;
+			error.Visit([&resume](const auto &error) {
+				using Error = std::decay_t<decltype(error)>;
+				resume = std::is_same_v<Error, MsgPrint> || std::is_same_v<Error, MsgRequestInput>;
+			});
+			if (!resume) {
+				ostr << '[' << line << ']' << error.Format() << '\n';
+				if (has_record)
+					return diverge("Stopped at line " + std::to_string(line) + " before the end of the trace");
+			}
+		}
+	}
+	return ret;
+}
+
+} // namespace basic
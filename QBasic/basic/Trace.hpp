@@ -0,0 +1,130 @@
+#pragma once
+
+#include "Checkpoint.hpp"
+
+#include <array>
+#include <chrono>
+#include <istream>
+#include <ostream>
+
+namespace basic {
+
+enum class TraceEvent : uint8_t { kLine, kTimedLine, kWrite, kInput };
+
+// Binary execution trace: the initial checkpoint, then one record per executed line, variable write and consumed
+// input. Reading the clock costs more than interpreting a simple line, so only randomly sampled lines are timed: the
+// record following a sampled line carries its duration (kTimedLine). Records are encoded into a fixed-size buffer that
+// is flushed to the stream when full, a writer is only used by the thread executing the program.
+class TraceWriter {
+private:
+	inline static constexpr std::size_t kBufferSize = 64 * 1024, kMaxRecordSize = 32;
+	inline static constexpr uint32_t kSampleInterval = 32; // average lines between two timed lines
+	using Clock = std::chrono::steady_clock;
+
+	std::ostream &m_ostr;
+	std::array<char, kBufferSize> m_buffer;
+	std::size_t m_size{};
+	Clock::time_point m_time;
+	bool m_timing{false};
+	uint32_t m_sample_countdown{1}, m_rand_state{0x9e3779b9u};
+
+	inline void reserve(std::size_t size) {
+		if (m_size + size > kBufferSize)
+			Flush();
+	}
+	inline void write_tag(TraceEvent event) { put(char(event)); }
+
+public:
+	inline static constexpr char kVersionStr[] = "QBasicTrace1.0";
+
+	// write the header, p_context is nullptr if the program starts from its first line
+	TraceWriter(std::ostream &ostr, const Program &program, const Context *p_context);
+	inline ~TraceWriter() { Flush(); }
+	TraceWriter(const TraceWriter &) = delete;
+	TraceWriter &operator=(const TraceWriter &) = delete;
+
+	// stream interface for Serializer, callers reserve space beforehand
+	inline void put(char c) { m_buffer[m_size++] = c; }
+	inline void write(const char *data, std::streamsize size) {
+		if (m_size + size > kBufferSize) {
+			Flush();
+			m_ostr.write(data, size);
+			return;
+		}
+		memcpy(m_buffer.data() + m_size, data, size);
+		m_size += size;
+	}
+	void Flush();
+
+	// don't count the time the program was paused (e.g. waiting for input)
+	inline void Resume() { m_timing = false; }
+
+	inline void Line(LineID line) {
+		reserve(kMaxRecordSize);
+		if (m_timing) {
+			write_tag(TraceEvent::kTimedLine);
+			Serializer<uint32_t>::Write(*this, line);
+			Serializer<uint64_t>::Write(*this, (Clock::now() - m_time) / std::chrono::nanoseconds{1});
+			m_timing = false;
+		} else {
+			write_tag(TraceEvent::kLine);
+			Serializer<uint32_t>::Write(*this, line);
+		}
+		if (--m_sample_countdown == 0) {
+			// xorshift32, a random interval in [1, 2 * kSampleInterval) doesn't alias with loops
+			m_rand_state ^= m_rand_state << 13u;
+			m_rand_state ^= m_rand_state >> 17u;
+			m_rand_state ^= m_rand_state << 5u;
+			m_sample_countdown = 1 + m_rand_state % (2 * kSampleInterval - 1);
+			m_timing = true;
+			m_time = Clock::now();
+		}
+	}
+	inline void Write(const String &var, Int value) {
+		reserve(kMaxRecordSize + var.size());
+		write_tag(TraceEvent::kWrite);
+		Serializer<String>::Write(*this, var);
+		Serializer<Int>::Write(*this, value);
+	}
+	inline void Input(const String &input) {
+		reserve(kMaxRecordSize);
+		write_tag(TraceEvent::kInput);
+		Serializer<String>::Write(*this, input);
+	}
+};
+
+struct TraceRecord {
+	TraceEvent event;
+	LineID line;      // kLine, kTimedLine
+	uint64_t time_ns; // kTimedLine, duration of the previous line
+	String str;       // kWrite (variable), kInput (input)
+	Int value;        // kWrite
+};
+
+class TraceReader {
+private:
+	std::istream &m_istr;
+	Checkpoint m_checkpoint;
+
+	inline TraceReader(std::istream &istr, Checkpoint checkpoint)
+	    : m_istr{istr}, m_checkpoint{std::move(checkpoint)} {}
+
+public:
+	static std::optional<TraceReader> Open(std::istream &istr);
+
+	// initial state, the context is moved out by replay
+	inline Checkpoint &GetCheckpoint() { return m_checkpoint; }
+	// false at the end of the trace
+	bool Next(TraceRecord *p_record);
+};
+
+struct TraceReplayResult {
+	uint64_t lines;
+	std::optional<String> divergence; // the first record the re-execution disagrees with
+};
+
+// Re-execute a trace from its initial state with the recorded inputs and check every line and variable write,
+// program outputs are written to ostr
+std::optional<TraceReplayResult> ReplayTrace(std::istream &istr, std::ostream &ostr);
+
+} // namespace basic
@@ -0,0 +1,429 @@
+#include "Transpiler.hpp"
+
+#include <map>
+#include <set>
+
+namespace basic {
+
+namespace {
+
+constexpr const char *kPreludeHead = R"(#include <cctype>
+#include <cinttypes>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#pragma GCC diagnostic ignored "-Wunused-label"
+
+namespace {
+
+// thrown to stop the program with a message
+struct Stop {
+	std::string message;
+};
+
+[[noreturn]] void stop(std::string message) { throw Stop{std::move(message)}; }
+
+)";
+
+// integer types and operations of the configured width, same semantics as IntArith
+#if BASIC_INT_BITS == 128
+constexpr const char *kPreludeInt = R"(using Int = __int128;
+using UInt = unsigned __int128;
+
+std::string int_to_string(Int value) {
+	UInt magnitude = value < 0 ? -UInt(value) : UInt(value);
+	std::string ret;
+	do
+		ret.insert(ret.begin(), char('0' + int(magnitude % 10)));
+	while ((magnitude /= 10) != 0);
+	return value < 0 ? '-' + ret : ret;
+}
+
+Int add(Int a, Int b) {
+	Int res;
+	if (__builtin_add_overflow(a, b, &res))
+		overflow(int_to_string(a) + " + " + int_to_string(b));
+	return res;
+}
+Int sub(Int a, Int b) {
+	Int res;
+	if (__builtin_sub_overflow(a, b, &res))
+		overflow(int_to_string(a) + " - " + int_to_string(b));
+	return res;
+}
+Int mul(Int a, Int b) {
+	Int res;
+	if (__builtin_mul_overflow(a, b, &res))
+		overflow(int_to_string(a) + " * " + int_to_string(b));
+	return res;
+}
+Int neg(Int v) {
+	if (v == Int(UInt(1) << 127))
+		overflow("-" + int_to_string(v));
+	return -v;
+}
+Int mod_int(Int a, Int b) {
+	if (b == -1)
+		return 0;
+	Int m = a % b;
+	return m != 0 && (m < 0) != (b < 0) ? m + b : m;
+}
+Int pow_int(Int a, Int b) {
+	Int res = 1;
+	while (b > 0) {
+		if (b & 1)
+			res = mul(res, a);
+		b >>= 1;
+		if (b > 0)
+			a = mul(a, a);
+	}
+	return res;
+}
+)";
+#else
+constexpr const char *kPreludeInt = R"(std::string int_to_string(Int value) { return std::to_string(value); }
+
+Int add(Int a, Int b) { return Int(UInt(a) + UInt(b)); }
+Int sub(Int a, Int b) { return Int(UInt(a) - UInt(b)); }
+Int mul(Int a, Int b) { return Int(UInt(a) * UInt(b)); }
+Int neg(Int v) { return Int(-UInt(v)); }
+Int mod_int(Int a, Int b) {
+	if (b == -1)
+		return 0;
+	Int m = a % b;
+	return m != 0 && (m < 0) != (b < 0) ? m + b : m;
+}
+Int pow_int(Int a, Int b) {
+	UInt res = 1, base = UInt(a);
+	for (; b > 0; b >>= 1) {
+		if (b & 1)
+			res *= base;
+		base *= base;
+	}
+	return Int(res);
+}
+)";
+#endif
+
+constexpr const char *kPrelude = R"(
+Int div_int(Int a, Int b) { return b == -1 ? neg(a) : a / b; }
+
+// a FOR loop being run, body is the index of its FOR
+struct Loop {
+	int var;
+	Int limit, step;
+	int body;
+};
+
+// the innermost loop of the variable after dropping the loops nested in it, nullptr if none
+Loop *find_loop(std::vector<Loop> &loops, int var) {
+	for (std::size_t i = loops.size(); i-- > 0;)
+		if (loops[i].var == var) {
+			loops.resize(i + 1);
+			return &loops.back();
+		}
+	return nullptr;
+}
+
+// same rules as tokenizing the input: one digit token, optionally preceded by a single '+' or '-' token
+bool parse_input(const std::string &input, Int *p_value) {
+	std::size_t i = 0, n = input.size();
+	const auto skip_space = [&] {
+		while (i < n && isspace(input[i]))
+			++i;
+	};
+	skip_space();
+	bool negative = false;
+	if (i < n && (input[i] == '+' || input[i] == '-')) {
+		if (i + 1 < n && input[i + 1] == input[i])
+			return false;
+		negative = input[i++] == '-';
+		skip_space();
+	}
+	if (i == n || !isdigit(input[i]))
+		return false;
+	UInt value = 0;
+	for (; i < n && isalnum(input[i]); ++i) {
+		if (!isdigit(input[i]))
+			return false;
+		value = value * 10 + UInt(input[i] - '0');
+	}
+	skip_space();
+	if (i != n)
+		return false;
+	*p_value = Int(negative ? -value : value);
+	return true;
+}
+
+)";
+
+String quote(StringView str) {
+	String ret = "\"";
+	for (char c : str) {
+		if (c == '\"' || c == '\\')
+			ret += '\\';
+		if (isprint(c))
+			ret += c;
+		else {
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\%03o", (unsigned char)c);
+			ret += buf;
+		}
+	}
+	return ret + '\"';
+}
+
+String prelude() {
+	String ret = kPreludeHead;
+#if BASIC_INT_BITS == 128
+	String overflow_message = ErrOverflow{.operation_str = "\n"}.Format();
+	std::size_t operation_pos = overflow_message.find('\n');
+	ret += "[[noreturn]] void overflow(const std::string &operation) {\n\tstop(" +
+	       quote(overflow_message.substr(0, operation_pos)) + " + operation + " +
+	       quote(overflow_message.substr(operation_pos + 1)) + ");\n}\n\n";
+#else
+	String bits = std::to_string(BASIC_INT_BITS);
+	ret += "using Int = int" + bits + "_t;\nusing UInt = uint" + bits + "_t;\n\n";
+#endif
+	return ret + kPreludeInt + kPrelude;
+}
+
+class Emitter {
+private:
+	const Program &m_program;
+	std::set<String> m_variables, m_arrays;
+	String m_code;
+	uint32_t m_temp_count{};
+	// the FORs of each loop variable, with the lines of their bodies, the variable's index is its loop's var
+	std::map<String, std::vector<std::pair<uint32_t, LineID>>> m_loop_bodies;
+	uint32_t m_for_count{};
+
+	String emit_stop(const String &message) const { return "stop(" + quote(message) + ");"; }
+	String emit_goto(LineID line) const {
+		if (m_program.CheckLine(line).IsError())
+			return emit_stop(ErrUndefinedLine{.line = line}.Format());
+		return "goto L_" + std::to_string(line) + ";";
+	}
+
+	static String emit_num(Int value) {
+		// through the unsigned type, the literal may be the minimum
+		UInt bits = UInt(value);
+#if BASIC_INT_BITS == 128
+		if (bits >> 64u)
+			return "Int(UInt(UINT64_C(" + std::to_string(uint64_t(bits >> 64u)) + ")) << 64 | UINT64_C(" +
+			       std::to_string(uint64_t(bits)) + "))";
+#endif
+		return "Int(UINT64_C(" + std::to_string(uint64_t(bits)) + "))";
+	}
+
+	// emit the index and its checks, return the temporary holding it, the element is arr_VAR[index]
+	String emit_element(const String &var, const Expression &expr_index) {
+		String index = emit_expr(expr_index);
+		m_arrays.insert(var);
+		m_code += "\t\tif (!dim_" + var + ") " + emit_stop(ErrUndefinedVariable{.var = var + "()"}.Format()) + "\n";
+		m_code += "\t\tif (UInt(" + index + ") >= arr_" + var + ".size()) index_error(\"" + var +
+		          "(\" + int_to_string(" + index + ") + \")\");\n";
+		return index;
+	}
+
+	// emit statements evaluating the expression in order (left operand first), return the temporary holding it
+	String emit_expr(const Expression &expression) {
+		return expression.Visit([this](const auto &expr) -> String {
+			using Expr = std::decay_t<decltype(expr)>;
+			String temp = "t" + std::to_string(m_temp_count++);
+			if constexpr (std::is_same_v<Expr, ExprNum>)
+				m_code += "\t\tInt " + temp + " = " + emit_num(expr.value) + ";\n";
+			else if constexpr (std::is_same_v<Expr, ExprVar>) {
+				m_variables.insert(expr.var);
+				m_code += "\t\tif (!d_" + expr.var + ") " + emit_stop(ErrUndefinedVariable{.var = expr.var}.Format()) +
+				          "\n\t\tInt " + temp + " = v_" + expr.var + ";\n";
+			} else if constexpr (std::is_same_v<Expr, ExprIndex>) {
+				String index = emit_element(expr.var, *expr.child);
+				m_code += "\t\tInt " + temp + " = arr_" + expr.var + "[std::size_t(" + index + ")];\n";
+			} else if constexpr (Expr::kType == ExpressionType::kUnary) {
+				String child = emit_expr(*expr.child);
+				String value = std::is_same_v<Expr, ExprNeg> ? "neg(" + child + ")" : child;
+				m_code += "\t\tInt " + temp + " = " + value + ";\n";
+			} else {
+				String left = emit_expr(*expr.left), right = emit_expr(*expr.right);
+				if constexpr (std::is_same_v<Expr, ExprDiv> || std::is_same_v<Expr, ExprMod>)
+					m_code += "\t\tif (" + right + " == 0) " +
+					          emit_stop(ErrDivByZero{.zero_expr_str = expr.right->Format()}.Format()) + "\n";
+				if constexpr (std::is_same_v<Expr, ExprExp>)
+					m_code += "\t\tif (" + right + " < 0) " +
+					          emit_stop(ErrExpByNeg{.neg_expr_str = expr.right->Format()}.Format()) + "\n";
+
+				const char *func = std::is_same_v<Expr, ExprAdd>   ? "add"
+				                   : std::is_same_v<Expr, ExprSub> ? "sub"
+				                   : std::is_same_v<Expr, ExprMul> ? "mul"
+				                   : std::is_same_v<Expr, ExprDiv> ? "div_int"
+				                   : std::is_same_v<Expr, ExprMod> ? "mod_int"
+				                                                   : "pow_int";
+				m_code += "\t\tInt " + temp + " = " + func + "(" + left + ", " + right + ");\n";
+			}
+			return temp;
+		});
+	}
+	void emit_assign(const String &var, const String &value) {
+		m_variables.insert(var);
+		m_code += "\t\tv_" + var + " = " + value + ";\n\t\td_" + var + " = true;\n";
+	}
+	// the element is checked before LET computes the value, but after INPUT reads it, as StmtLet and StmtInput run
+	template <typename Stmt, typename ValueFunc> void emit_target(const Stmt &stmt, ValueFunc &&value_func) {
+		if (stmt.expr_index == nullptr) {
+			emit_assign(stmt.var, value_func());
+			return;
+		}
+		constexpr bool kValueFirst = std::is_same_v<Stmt, StmtInput>;
+		String value, index;
+		if constexpr (kValueFirst)
+			value = value_func();
+		index = emit_element(stmt.var, *stmt.expr_index);
+		if constexpr (!kValueFirst)
+			value = value_func();
+		m_code += "\t\tarr_" + stmt.var + "[std::size_t(" + index + ")] = " + value + ";\n";
+	}
+	void emit_dim(const StmtDim &stmt) {
+		String size = emit_expr(*stmt.expr_size);
+		m_arrays.insert(stmt.var);
+		m_code += "\t\tif (UInt(" + size + ") > UInt(" + std::to_string(kArrayMaxSize) + ")) size_error(\"" +
+		          stmt.var + "(\" + int_to_string(" + size + ") + \")\");\n";
+		m_code += "\t\tarr_" + stmt.var + ".assign(std::size_t(" + size + "), 0);\n\t\tdim_" + stmt.var + " = true;\n";
+	}
+	int loop_var(const String &var) const {
+		return int(std::distance(m_loop_bodies.begin(), m_loop_bodies.find(var)));
+	}
+	void emit_for(LineID line, const StmtFor &stmt) {
+		String from = emit_expr(*stmt.expr_from), to = emit_expr(*stmt.expr_to);
+		String step = stmt.opt_step.has_value() ? emit_num(stmt.opt_step.value()) : emit_expr(*stmt.expr_step);
+		emit_assign(stmt.var, from);
+		String var = std::to_string(loop_var(stmt.var));
+		m_code += "\t\tif (find_loop(loops, " + var + ")) loops.pop_back();\n";
+
+		// the same target as StmtFor::Run for an empty range
+		String skip;
+		auto next_res = m_program.FindNext(line, stmt.var);
+		if (next_res.IsError())
+			skip = emit_stop(next_res.PopError().Format());
+		else {
+			auto after_res = m_program.GetNextLine(next_res.PopValue());
+			skip = after_res.IsError() ? emit_stop(after_res.PopError().Format()) : emit_goto(after_res.PopValue());
+		}
+		m_code += "\t\tif (" + step + " < 0 ? " + from + " < " + to + " : " + from + " > " + to + ") " + skip + "\n";
+		m_code += "\t\tloops.push_back({" + var + ", " + to + ", " + step + ", " + std::to_string(m_for_count++) +
+		          "});\n";
+	}
+	void emit_next(const StmtNext &stmt) {
+		m_variables.insert(stmt.var);
+		auto it = m_loop_bodies.find(stmt.var);
+		if (it == m_loop_bodies.end()) {
+			m_code += "\t\t" + emit_stop(ErrNextWithoutFor{.var = stmt.var}.Format()) + "\n";
+			return;
+		}
+		String var = "v_" + stmt.var;
+		m_code += "\t\tLoop *p_loop = find_loop(loops, " + std::to_string(loop_var(stmt.var)) + ");\n";
+		m_code += "\t\tif (!p_loop) " + emit_stop(ErrNextWithoutFor{.var = stmt.var}.Format()) + "\n";
+		m_code += "\t\tInt value;\n\t\tif (!__builtin_add_overflow(" + var + ", p_loop->step, &value)) {\n";
+		m_code += "\t\t\t" + var + " = value;\n";
+		m_code += "\t\t\tif (p_loop->step < 0 ? value >= p_loop->limit : value <= p_loop->limit) {\n";
+		m_code += "\t\t\t\tswitch (p_loop->body) {\n";
+		for (const auto &[index, body_line] : it->second)
+			m_code += "\t\t\t\tcase " + std::to_string(index) + ": goto L_" + std::to_string(body_line) + ";\n";
+		m_code += "\t\t\t\t}\n\t\t\t}\n\t\t}\n\t\tloops.pop_back();\n";
+	}
+	void emit_statement(LineID line, const Statement &statement) {
+		m_code += "\tL_" + std::to_string(line) + ":\n\t\tline = " + std::to_string(line) + ";\n";
+		m_code += "\t{\n";
+		statement.Visit([this, line](const auto &stmt) {
+			using Stmt = std::decay_t<decltype(stmt)>;
+			if constexpr (std::is_same_v<Stmt, StmtDim>)
+				emit_dim(stmt);
+			else if constexpr (std::is_same_v<Stmt, StmtInput>)
+				emit_target(stmt, [this] {
+					String temp = "t" + std::to_string(m_temp_count++);
+					m_code += "\t\tInt " + temp + " = read_input();\n";
+					return temp;
+				});
+			else if constexpr (std::is_same_v<Stmt, StmtPrint>)
+				m_code += "\t\tstd::cout << int_to_string(" + emit_expr(*stmt.expr) + ") << '\\n';\n";
+			else if constexpr (std::is_same_v<Stmt, StmtLet>)
+				emit_target(stmt, [this, &stmt] { return emit_expr(*stmt.expr); });
+			else if constexpr (std::is_same_v<Stmt, StmtGoto>)
+				m_code += "\t\t" + emit_goto(stmt.line) + "\n";
+			else if constexpr (std::is_same_v<Stmt, StmtIf>) {
+				String left = emit_expr(*stmt.expr_l), right = emit_expr(*stmt.expr_r);
+				String cmp = stmt.cmp == '=' ? "==" : String(1, stmt.cmp);
+				m_code += "\t\tif (" + left + " " + cmp + " " + right + ") " + emit_goto(stmt.line_then) + "\n";
+			} else if constexpr (std::is_same_v<Stmt, StmtFor>)
+				emit_for(line, stmt);
+			else if constexpr (std::is_same_v<Stmt, StmtNext>)
+				emit_next(stmt);
+			else if constexpr (std::is_same_v<Stmt, StmtEnd>)
+				m_code += "\t\t" + emit_stop(MsgEndOfProgram{}.Format()) + "\n";
+		});
+		m_code += "\t}\n";
+	}
+
+public:
+	explicit Emitter(const Program &program) : m_program{program} {}
+
+	String Emit() {
+		if (m_program.GetFirstLine().IsError())
+			return prelude() + "} // namespace\n\nint main() {\n\tstd::cout << " +
+			       quote(m_program.GetFirstLine().PopError().Format()) + " << '\\n';\n\treturn 0;\n}\n";
+
+		// the FORs are numbered in the order of their lines, a NEXT may come before its FOR
+		uint32_t for_count = 0;
+		m_program.ForEachStatement([this, &for_count](LineID line, const Statement &statement) {
+			statement.Visit([this, &for_count, line](const auto &stmt) {
+				if constexpr (std::is_same_v<std::decay_t<decltype(stmt)>, StmtFor>) {
+					auto body_res = m_program.GetNextLine(line);
+					auto &bodies = m_loop_bodies[stmt.var];
+					if (body_res.IsOK())
+						bodies.emplace_back(for_count, body_res.PopValue());
+					++for_count;
+				}
+			});
+		});
+		m_program.ForEachStatement(
+		    [this](LineID line, const Statement &statement) { emit_statement(line, statement); });
+		m_code += "\t\t" + emit_stop(MsgEndOfProgram{}.Format()) + "\n";
+
+		// stops with the message of the error, its field filled at run time
+		const auto emit_message = [](const auto &error, const String &field) {
+			String message = error.Format();
+			std::size_t pos = message.find('\n');
+			return "stop(" + quote(message.substr(0, pos)) + " + " + field + " + " + quote(message.substr(pos + 1)) +
+			       ");";
+		};
+
+		String source = prelude();
+		source += "Int read_input() {\n\tstd::string input;\n\tif (!std::getline(std::cin, input))\n\t\t" +
+		          emit_stop(MsgRequestInput{}.Format()) + "\n\tInt value;\n\tif (!parse_input(input, &value))\n\t\t" +
+		          emit_message(ErrInvalidInput{.input = "\n"}, "input") + "\n\treturn value;\n}\n\n";
+		if (!m_arrays.empty())
+			source += "[[noreturn]] void index_error(const std::string &element) {\n\t" +
+			          emit_message(ErrIndexOutOfRange{.element_str = "\n"}, "element") +
+			          "\n}\n[[noreturn]] void size_error(const std::string &dim) {\n\t" +
+			          emit_message(ErrInvalidArraySize{.dim_str = "\n"}, "dim") + "\n}\n\n";
+		source += "} // namespace\n\n";
+		source += "int main() {\n\tstd::ios::sync_with_stdio(false);\n\tuint32_t line = 0;\n";
+		for (const auto &var : m_variables)
+			source += "\tInt v_" + var + " = 0;\n\tbool d_" + var + " = false;\n";
+		for (const auto &var : m_arrays)
+			source += "\tstd::vector<Int> arr_" + var + ";\n\tbool dim_" + var + " = false;\n";
+		if (!m_loop_bodies.empty())
+			source += "\tstd::vector<Loop> loops;\n";
+		source += "\ttry {\n" + m_code +
+		          "\t} catch (const Stop &s) {\n\t\tstd::cout << '[' << line << ']' << s.message << '\\n';\n\t}\n"
+		          "\treturn 0;\n}\n";
+		return source;
+	}
+};
+
+} // namespace
+
+String Transpiler::Transpile(const Program &program) { return Emitter{program}.Emit(); }
+
+} // namespace basic
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Program.hpp"
+
+namespace basic {
+
+// Ahead-of-time translation of a Program into a self-contained C++ translation unit.
+// Lines become labels, GOTO and IF become goto. The generated program reads one input per line from stdin, prints
+// outputs to stdout and finishes with the same "[LINE]MESSAGE" as Script::Run, including runtime errors.
+class Transpiler {
+public:
+	static String Transpile(const Program &program);
+};
+
+} // namespace basic
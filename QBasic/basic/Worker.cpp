@@ -0,0 +1,400 @@
+#include "Worker.hpp"
+
+#include "Checkpoint.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+
+#if defined(__linux__) && !defined(BASIC_NO_WORKER)
+#define BASIC_WORKER_LINUX
+#include "ShmRing.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#endif
+
+namespace basic {
+
+#ifdef BASIC_WORKER_LINUX
+
+namespace {
+
+// each message is its payload size, its type and its payload
+enum class Frame : uint8_t { kEdit, kRun, kInput, kResult };
+constexpr std::size_t kFrameHeaderSize = 5;
+
+struct Slot {
+	std::atomic<int32_t> pid;          // written by the worker once started
+	std::atomic<uint32_t> terminate;   // checked by the worker before each statement
+	ShmRing<kWorkerRingSize> requests; // program edits (kEdit), context (kRun) and inputs (kInput)
+	ShmRing<kWorkerRingSize> responses;
+};
+
+template <typename Poll>
+bool send_frame(ShmRing<kWorkerRingSize> *p_ring, Frame type, StringView payload, uint32_t timeout_us, Poll &&poll) {
+	char header[kFrameHeaderSize];
+	auto size = uint32_t(payload.size());
+	memcpy(header, &size, sizeof(size));
+	header[4] = char(type);
+	return p_ring->Write(header, sizeof(header), timeout_us, poll) &&
+	       p_ring->Write(payload.data(), payload.size(), timeout_us, poll);
+}
+template <typename Poll>
+bool recv_frame(ShmRing<kWorkerRingSize> *p_ring, Frame *p_type, String *p_payload, uint32_t timeout_us, Poll &&poll) {
+	char header[kFrameHeaderSize];
+	if (!p_ring->Read(header, sizeof(header), timeout_us, poll))
+		return false;
+	uint32_t size;
+	memcpy(&size, header, sizeof(size));
+	*p_type = Frame(header[4]);
+	p_payload->resize(size);
+	return p_ring->Read(p_payload->data(), size, timeout_us, poll);
+}
+
+void write_debug(StringWriter &writer, const DebugOptions &debug) {
+	Serializer<uint64_t>::Write(writer, debug.breakpoints.size());
+	for (LineID line : debug.breakpoints)
+		Serializer<LineID>::Write(writer, line);
+	Serializer<uint64_t>::Write(writer, debug.watchpoints.size());
+	for (const String &var : debug.watchpoints)
+		Serializer<String>::Write(writer, var);
+	Serializer<bool>::Write(writer, debug.step);
+}
+// the lines of program edited since base, so that a worker holding base doesn't parse the others again
+void write_edits(StringWriter &writer, const Program &program, const Program &base) {
+	std::vector<std::pair<LineID, const Statement *>> edits;
+	program.ForEachEdit(base, [&edits](LineID line, const Statement *p_stmt) { edits.emplace_back(line, p_stmt); });
+	Serializer<uint64_t>::Write(writer, edits.size());
+	for (const auto &[line, p_stmt] : edits) {
+		Serializer<LineID>::Write(writer, line);
+		Serializer<bool>::Write(writer, p_stmt != nullptr);
+		if (p_stmt)
+			Serializer<String>::Write(writer, p_stmt->Format());
+	}
+}
+void read_edits(StringReader &reader, Program *p_program) {
+	for (uint64_t size = Serializer<uint64_t>::Read(reader); size-- && reader;) {
+		LineID line = Serializer<LineID>::Read(reader);
+		std::unique_ptr<Statement> statement;
+		if (Serializer<bool>::Read(reader)) {
+			auto stmt_res = Statement::Parse(Token::Tokenize(Serializer<String>::Read(reader)));
+			if (stmt_res.IsOK())
+				statement = stmt_res.PopValue();
+		}
+		if (statement)
+			p_program->InsertStatement(line, std::move(statement));
+		else
+			p_program->EraseStatement(line);
+	}
+}
+
+DebugOptions read_debug(StringReader &reader) {
+	DebugOptions debug;
+	for (uint64_t size = Serializer<uint64_t>::Read(reader); size-- && reader;)
+		debug.breakpoints.insert(Serializer<LineID>::Read(reader));
+	for (uint64_t size = Serializer<uint64_t>::Read(reader); size-- && reader;)
+		debug.watchpoints.insert(Serializer<String>::Read(reader));
+	debug.step = Serializer<bool>::Read(reader);
+	return debug;
+}
+
+// worker side, mirrors Machine::execute
+RuntimeError worker_run(const Program &program, Context *p_context, const DebugOptions &debug, Slot *p_slot,
+                        uint64_t *p_inputs_received) {
+	Program patched_program;
+	const Program *p_run_program = &program;
+	if (!debug.breakpoints.empty() || !debug.watchpoints.empty()) {
+		patched_program = program.Patch(debug.breakpoints, debug.watchpoints);
+		p_run_program = &patched_program;
+	}
+
+	String payload;
+	Frame type;
+	while (true) {
+		while (!p_slot->requests.Empty() && recv_frame(&p_slot->requests, &type, &payload, 0, [] { return true; })) {
+			if (type == Frame::kInput) {
+				p_context->PushInput(payload);
+				++*p_inputs_received;
+			}
+		}
+		if (p_slot->terminate.load(std::memory_order_relaxed))
+			p_context->Terminate();
+		if (p_context->IsTerminated())
+			return ErrTerminate{};
+
+		auto step_res = p_run_program->Step(p_context);
+		if (step_res.IsError())
+			return step_res.PopError();
+		if (debug.step)
+			return MsgStep{};
+	}
+}
+
+[[noreturn]] void worker_main(Slot *p_slot) {
+	const auto wait = [] { return true; };
+	Program program;
+	String payload, response;
+	Frame type;
+	while (recv_frame(&p_slot->requests, &type, &payload, 0, wait)) {
+		StringReader reader{payload};
+		if (type == Frame::kEdit)
+			read_edits(reader, &program);
+		else if (type == Frame::kRun) {
+			auto context = Serializer<Context>::Read(reader);
+			DebugOptions debug = read_debug(reader);
+			uint64_t inputs_received = 0;
+			RuntimeError error = worker_run(program, context.get(), debug, p_slot, &inputs_received);
+
+			response.clear();
+			StringWriter writer{&response};
+			Serializer<RuntimeError>::Write(writer, error);
+			Serializer<Context>::Write(writer, *context);
+			Serializer<uint64_t>::Write(writer, inputs_received);
+			send_frame(&p_slot->responses, Frame::kResult, response, 0, wait);
+		}
+		// an input arriving after the run stopped is given back by the caller
+	}
+	_exit(1);
+}
+
+// single-threaded, forks the workers
+[[noreturn]] void zygote_main(Slot *p_slots, std::size_t slot_count, int control_fd, pid_t parent) {
+	prctl(PR_SET_PDEATHSIG, SIGKILL);
+	if (getppid() != parent)
+		_exit(0);
+	// the workers are reaped automatically
+	signal(SIGCHLD, SIG_IGN);
+
+	pid_t zygote = getpid();
+	const auto spawn = [&](uint32_t id) {
+		if (fork() != 0)
+			return;
+		close(control_fd);
+		prctl(PR_SET_PDEATHSIG, SIGKILL);
+		if (getppid() != zygote)
+			_exit(0);
+		signal(SIGCHLD, SIG_DFL);
+		p_slots[id].pid.store(getpid(), std::memory_order_release);
+		worker_main(p_slots + id);
+	};
+	for (uint32_t id = 0; id < slot_count; ++id)
+		spawn(id);
+	// slot ids to respawn, until the parent closes the socket
+	uint32_t id;
+	while (recv(control_fd, &id, sizeof(id), MSG_WAITALL) == sizeof(id)) {
+		if (id < slot_count)
+			spawn(id);
+	}
+	_exit(0);
+}
+
+inline bool is_alive(pid_t pid) { return kill(pid, 0) == 0 || errno != ESRCH; }
+
+// state in the calling process
+struct Pool {
+	Slot *p_slots{};
+	std::size_t slot_count{};
+	int control_fd{-1};
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<bool> busy;
+	std::vector<Program> loaded; // program held by each worker, accessed by the run leasing it
+
+	std::size_t acquire(const Program &program) {
+		std::unique_lock lock{mutex};
+		condition.wait(lock, [this] { return std::find(busy.begin(), busy.end(), false) != busy.end(); });
+		// prefer a worker already holding the program
+		std::size_t ret = slot_count;
+		for (std::size_t id = 0; id < slot_count; ++id) {
+			if (!busy[id] && (ret == slot_count || loaded[id].IsSameAs(program)))
+				ret = id;
+		}
+		busy[ret] = true;
+		return ret;
+	}
+	void release(std::size_t id) {
+		{
+			std::scoped_lock lock{mutex};
+			busy[id] = false;
+		}
+		condition.notify_one();
+	}
+	// kill the worker and have the zygote fork another one
+	void replace(std::size_t id, pid_t pid) {
+		Slot *p_slot = p_slots + id;
+		if (pid > 0) {
+			kill(pid, SIGKILL);
+			while (is_alive(pid))
+				std::this_thread::sleep_for(std::chrono::microseconds{kWorkerPollUs});
+		}
+		// nothing uses the rings anymore
+		p_slot->pid.store(0, std::memory_order_relaxed);
+		p_slot->terminate.store(0, std::memory_order_relaxed);
+		p_slot->requests.Reset();
+		p_slot->responses.Reset();
+		loaded[id] = Program{};
+		auto id_32 = uint32_t(id);
+		send(control_fd, &id_32, sizeof(id_32), MSG_NOSIGNAL);
+	}
+};
+Pool g_pool;
+
+ExecuteResult run_on(std::size_t id, Program program, std::unique_ptr<Context> context, const DebugOptions &debug,
+                     const std::function<bool()> &is_terminated,
+                     const std::function<std::optional<String>()> &poll_input) {
+	using Clock = std::chrono::steady_clock;
+	Slot *p_slot = g_pool.p_slots + id;
+
+	std::vector<String> forwarded_inputs;
+	bool terminating = false;
+	// A worker lost before reading anything of the run, e.g. killed while idle but not gone yet, is replaced and the
+	// run retried once on the new one
+	for (bool retry = true;; retry = false) {
+		// an idle worker may have been lost too, a replaced one may still be starting
+		pid_t pid = p_slot->pid.load(std::memory_order_acquire);
+		if (pid != 0 && !is_alive(pid)) {
+			g_pool.replace(id, pid);
+			pid = 0;
+		}
+		for (auto deadline = Clock::now() + std::chrono::microseconds{kWorkerKillTimeoutUs}; pid == 0;) {
+			if (Clock::now() > deadline)
+				return {std::move(program), std::move(context), RuntimeError{ErrWorkerLost{}}};
+			std::this_thread::sleep_for(std::chrono::microseconds{kWorkerPollUs});
+			pid = p_slot->pid.load(std::memory_order_acquire);
+		}
+		p_slot->terminate.store(0, std::memory_order_relaxed);
+
+		Clock::time_point kill_time = Clock::time_point::max();
+		const auto is_worker_alive = [pid] { return is_alive(pid); };
+		// between waits for the worker
+		const auto poll = [&] {
+			if (!terminating && is_terminated()) {
+				terminating = true;
+				p_slot->terminate.store(1, std::memory_order_relaxed);
+				kill_time = Clock::now() + std::chrono::microseconds{kWorkerKillTimeoutUs};
+			}
+			for (auto opt_input = poll_input(); opt_input.has_value(); opt_input = poll_input()) {
+				if (!send_frame(&p_slot->requests, Frame::kInput, opt_input.value(), kWorkerPollUs, is_worker_alive))
+					return false;
+				forwarded_inputs.push_back(std::move(opt_input.value()));
+			}
+			return Clock::now() < kill_time && is_alive(pid);
+		};
+
+		uint32_t request_begin = p_slot->requests.GetWriteCount();
+		String payload;
+		StringWriter writer{&payload};
+		bool ok = true;
+		if (!g_pool.loaded[id].IsSameAs(program)) {
+			write_edits(writer, program, g_pool.loaded[id]);
+			ok = send_frame(&p_slot->requests, Frame::kEdit, payload, kWorkerPollUs, poll);
+			g_pool.loaded[id] = program;
+		}
+		if (ok) {
+			payload.clear();
+			Serializer<Context>::Write(writer, *context);
+			write_debug(writer, debug);
+			ok = send_frame(&p_slot->requests, Frame::kRun, payload, kWorkerPollUs, poll);
+		}
+		Frame type{};
+		if (ok && recv_frame(&p_slot->responses, &type, &payload, kWorkerPollUs, poll) && type == Frame::kResult) {
+			StringReader reader{payload};
+			auto opt_error = Serializer<RuntimeError>::Read(reader);
+			auto result_context = Serializer<Context>::Read(reader);
+			uint64_t inputs_received = Serializer<uint64_t>::Read(reader);
+			if (opt_error.has_value() && reader) {
+				for (std::size_t i = inputs_received; i < forwarded_inputs.size(); ++i)
+					result_context->PushInput(forwarded_inputs[i]);
+				return {std::move(program), std::move(result_context), std::move(opt_error.value())};
+			}
+		}
+
+		// lost, killed or not answering: the context stays as before the run
+		bool read_any = int32_t(p_slot->requests.GetReadCount() - request_begin) > 0;
+		g_pool.replace(id, pid);
+		for (auto &input : forwarded_inputs)
+			context->PushInput(input);
+		forwarded_inputs.clear();
+		if (!retry || read_any || terminating)
+			return {std::move(program), std::move(context),
+			        terminating ? RuntimeError{ErrTerminate{}} : RuntimeError{ErrWorkerLost{}}};
+	}
+}
+
+} // namespace
+
+bool WorkerPool::Start(std::size_t worker_count) {
+	if (g_pool.p_slots)
+		return true;
+	worker_count = std::max<std::size_t>(worker_count, 1);
+
+	void *p_memory =
+	    mmap(nullptr, sizeof(Slot) * worker_count, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (p_memory == MAP_FAILED)
+		return false;
+	auto p_slots = static_cast<Slot *>(p_memory);
+	for (std::size_t id = 0; id < worker_count; ++id)
+		new (p_slots + id) Slot{};
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		munmap(p_memory, sizeof(Slot) * worker_count);
+		return false;
+	}
+	pid_t parent = getpid(), zygote = fork();
+	if (zygote == 0) {
+		close(fds[0]);
+		zygote_main(p_slots, worker_count, fds[1], parent);
+	}
+	close(fds[1]);
+	if (zygote < 0) {
+		close(fds[0]);
+		munmap(p_memory, sizeof(Slot) * worker_count);
+		return false;
+	}
+
+	g_pool.p_slots = p_slots;
+	g_pool.slot_count = worker_count;
+	g_pool.control_fd = fds[0];
+	g_pool.busy.assign(worker_count, false);
+	g_pool.loaded.resize(worker_count);
+	return true;
+}
+
+bool WorkerPool::IsStarted() { return g_pool.p_slots != nullptr; }
+
+ExecuteResult WorkerPool::Run(Program program, std::unique_ptr<Context> context, const DebugOptions &debug,
+                              const std::function<bool()> &is_terminated,
+                              const std::function<std::optional<String>()> &poll_input) {
+	std::size_t id = g_pool.acquire(program);
+	ExecuteResult result = run_on(id, std::move(program), std::move(context), debug, is_terminated, poll_input);
+	g_pool.release(id);
+	return result;
+}
+
+std::vector<int> WorkerPool::GetPids() {
+	std::vector<int> pids;
+	for (std::size_t id = 0; id < g_pool.slot_count; ++id)
+		pids.push_back(g_pool.p_slots[id].pid.load(std::memory_order_acquire));
+	return pids;
+}
+
+#else
+
+bool WorkerPool::Start(std::size_t worker_count) { return false; }
+bool WorkerPool::IsStarted() { return false; }
+ExecuteResult WorkerPool::Run(Program program, std::unique_ptr<Context> context, const DebugOptions &debug,
+                              const std::function<bool()> &is_terminated,
+                              const std::function<std::optional<String>()> &poll_input) {
+	return {std::move(program), std::move(context), RuntimeError{ErrWorkerLost{}}};
+}
+std::vector<int> WorkerPool::GetPids() { return {}; }
+
+#endif
+
+} // namespace basic
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Machine.hpp"
+
+namespace basic {
+
+// Pre-forked worker processes running programs out of process (ExecuteOptions::isolated), so that a crashing or
+// runaway run cannot take the caller down. Each worker shares a pair of ShmRing with the caller: the program (only
+// when it changed), the context and the inputs go one way, the result and the context come back, without a syscall
+// per message while both sides are active. The workers are forked from a zygote process started by Start, which
+// forks a replacement when one is lost, so the caller itself never forks once it has threads.
+class WorkerPool {
+public:
+	// fork the zygote and the workers, before the process starts any thread (e.g. first thing in main), returns false
+	// if unsupported on the platform or failed
+	static bool Start(std::size_t worker_count = kWorkerCount);
+	static bool IsStarted();
+
+	// Run until the program stops, like Machine with the debug options. Inputs polled while running are forwarded.
+	// A worker lost (killed or crashed) returns ErrWorkerLost with the context as it was before the run, a worker not
+	// stopping within kWorkerKillTimeoutUs of is_terminated is killed and returns ErrTerminate the same way.
+	static ExecuteResult Run(Program program, std::unique_ptr<Context> context, const DebugOptions &debug,
+	                         const std::function<bool()> &is_terminated,
+	                         const std::function<std::optional<String>()> &poll_input);
+
+	// pid of each worker, 0 while it is being replaced
+	static std::vector<int> GetPids();
+};
+
+} // namespace basic
@@ -5,10 +5,13 @@
 #include "basic/Context.hpp"
 #include "basic/Program.hpp"
 #include "basic/Token.hpp"
+#include "basic/Worker.hpp"
 #include <QFontDatabase>
 #include <iostream>
 
 int main(int argc, char *argv[]) {
+	// before any thread, the workers are forked from this state
+	basic::WorkerPool::Start();
 	QApplication a(argc, argv);
 	QFontDatabase::addApplicationFont(":/SourceCodePro-Regular.ttf");
 	MainWindow w;
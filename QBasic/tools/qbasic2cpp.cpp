@@ -0,0 +1,37 @@
+#include "basic/Script.hpp"
+#include "basic/Transpiler.hpp"
+
+#include <fstream>
+#include <iostream>
+
+// qbasic2cpp INPUT.qbasic [OUTPUT.cpp]
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " INPUT.qbasic [OUTPUT.cpp]" << std::endl;
+		return 1;
+	}
+
+	std::ifstream fin{argv[1]};
+	if (!fin.is_open()) {
+		std::cerr << "Unable to load \'" << argv[1] << "\'" << std::endl;
+		return 1;
+	}
+	auto script_res = basic::Script::Load(fin);
+	if (script_res.IsError()) {
+		std::cerr << script_res.PopError().Format() << std::endl;
+		return 1;
+	}
+	basic::String source = basic::Transpiler::Transpile(script_res.PopValue().GetProgram());
+
+	if (argc < 3) {
+		std::cout << source;
+		return 0;
+	}
+	std::ofstream fout{argv[2]};
+	if (!fout.is_open()) {
+		std::cerr << "Unable to write \'" << argv[2] << "\'" << std::endl;
+		return 1;
+	}
+	fout << source;
+	return 0;
+}
@@ -0,0 +1,121 @@
+#include "basic/Machine.hpp"
+#include "basic/Meter.hpp"
+#include "basic/Script.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+// Interpreter throughput of the configured integer width (QBASIC_INT_BITS), each width is a separate build
+namespace {
+
+struct Workload {
+	const char *name, *code;
+	uint32_t input_count{}; // values read by INPUT from an InputSource
+};
+
+// about 10^6 statements each, outputs only at the end
+constexpr Workload kWorkloads[] = {
+    {"arith", "10 LET i = 0\n"
+              "20 LET s = 0\n"
+              "30 LET s = s + i * i - i / 3\n"
+              "40 LET i = i + 1\n"
+              "50 IF i < 333333 THEN 30\n"
+              "60 PRINT s\n"},
+    {"for", "10 LET s = 0\n"
+            "20 FOR i = 0 TO 499999\n"
+            "30 LET s = s + i * i - i / 3\n"
+            "40 NEXT i\n"
+            "50 PRINT s\n"},
+    {"sieve", "10 DIM f(100000)\n"
+              "20 LET c = 0\n"
+              "30 FOR i = 2 TO 99999\n"
+              "40 IF f(i) > 0 THEN 90\n"
+              "50 LET c = c + 1\n"
+              "60 FOR j = i + i TO 99999 STEP i\n"
+              "70 LET f(j) = 1\n"
+              "80 NEXT j\n"
+              "90 NEXT i\n"
+              "100 PRINT c\n"},
+    {"pow_mod", "10 LET i = 1\n"
+                "20 LET h = 7\n"
+                "30 LET h = (h * 31 + i ** 3) MOD 1000003\n"
+                "40 LET i = i + 1\n"
+                "50 IF i < 333333 THEN 30\n"
+                "60 PRINT h\n"},
+    {"branch", "10 LET i = 0\n"
+               "20 LET n = 0\n"
+               "30 IF i MOD 3 = 0 THEN 50\n"
+               "40 LET n = n + 1\n"
+               "50 LET i = i + 1\n"
+               "60 IF i < 300000 THEN 30\n"
+               "70 PRINT n\n"},
+    {"input",
+     "10 LET s = 0\n"
+     "20 INPUT x\n"
+     "30 LET s = s + x\n"
+     "40 IF x > 0 THEN 20\n"
+     "50 PRINT s\n",
+     333333},
+};
+
+bool run(const Workload &workload, basic::Meter *p_meter) {
+	std::istringstream sin{workload.code};
+	auto script = basic::Script::Load(sin).PopValue();
+	// counting down to 0
+	basic::String inputs;
+	for (uint32_t i = workload.input_count; i--;)
+		inputs += (i % 2 ? "+ " : "") + std::to_string(i) + "\n";
+	basic::InputSource source{std::move(inputs)};
+	std::unique_ptr<basic::Context> context;
+	while (true) {
+		auto machine = basic::Machine::Execute(script.GetProgram(), std::move(context), [] {},
+		                                       {.p_meter = p_meter, .p_input_source = &source});
+		auto result = basic::Machine::GetResult(&machine);
+		context = std::move(result.context);
+		auto error = result.result.PopError();
+		bool print = false, end = false;
+		error.Visit([&](const auto &error) {
+			using Error = std::decay_t<decltype(error)>;
+			print = std::is_same_v<Error, basic::MsgPrint>;
+			end = std::is_same_v<Error, basic::MsgEndOfProgram>;
+		});
+		if (end)
+			return true;
+		if (!print) {
+			std::cerr << workload.name << ": " << error.Format() << std::endl;
+			return false;
+		}
+	}
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	int repeat = 3;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			repeat = std::max(atoi(argv[++i]), 1);
+		else {
+			std::cerr << "Usage: " << argv[0] << " [--repeat N]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << "int" << BASIC_INT_BITS << (basic::kCheckedInt ? " (checked)" : " (wrapping)") << std::endl;
+	for (const auto &workload : kWorkloads) {
+		// best of the repetitions
+		double best = 0;
+		for (int r = 0; r < repeat; ++r) {
+			basic::Meter meter;
+			if (!run(workload, &meter))
+				return 1;
+			auto reading = meter.Read();
+			double seconds = double(reading.cpu_time.count()) / 1e6;
+			if (seconds > 0)
+				best = std::max(best, double(reading.statements) / seconds);
+		}
+		std::cout << workload.name << ": " << uint64_t(best) << " statements/s" << std::endl;
+	}
+	return 0;
+}
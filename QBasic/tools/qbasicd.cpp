@@ -0,0 +1,45 @@
+#include "basic/Daemon.hpp"
+
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+// Execution daemon, serves the protocol of basic/Daemon.hpp on a Unix socket until SIGINT or SIGTERM
+static basic::Daemon *g_p_daemon;
+
+static void on_signal(int) { g_p_daemon->Stop(); }
+
+int main(int argc, char **argv) {
+	basic::String path = basic::kDaemonSocketPath;
+	std::size_t thread_count = std::thread::hardware_concurrency(), cache_size = basic::kDaemonCacheSize;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+			path = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			thread_count = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+			cache_size = std::max(atoi(argv[++i]), 1);
+		else {
+			std::cerr << "Usage: " << argv[0] << " [--socket PATH] [--threads N] [--cache N]" << std::endl;
+			return 1;
+		}
+	}
+
+	auto daemon = basic::Daemon::Listen(path, thread_count, cache_size);
+	if (daemon == nullptr) {
+		std::cerr << "Unable to listen on \'" << path << "\': " << strerror(errno) << std::endl;
+		return 1;
+	}
+	g_p_daemon = daemon.get();
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	std::cout << "Listening on " << path << " with " << thread_count << " threads" << std::endl;
+	daemon->Serve();
+
+	auto stats = daemon->GetStats();
+	std::cout << stats.requests << " requests, " << stats.cache_hits << " cache hits, " << stats.cache_misses
+	          << " misses" << std::endl;
+	return 0;
+}
@@ -0,0 +1,430 @@
+#include "basic/Jit.hpp"
+#include "basic/Machine.hpp"
+#include "basic/Scheduler.hpp"
+#include "basic/Transpiler.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+// Differential fuzzing: random programs and inputs run on every engine, which must agree with the reference tree
+// walker on outputs, the final message and the line, branch and variable statistics (FormatAST).
+//
+// qbasicfuzz [--seed N] [--iterations N] [--steps N] [--cxx COMPILER] [--cxx-every N]
+
+namespace {
+
+using basic::String;
+
+struct Case {
+	String source;
+	basic::Program program;
+	std::vector<String> inputs;
+};
+
+struct Outcome {
+	String outputs; // outputs and the final "[LINE]MESSAGE", as printed by Script::Run
+	String stats;   // FormatAST with the final context, empty if the engine doesn't keep one
+};
+
+class Generator {
+public:
+	using LineID = basic::LineID;
+
+private:
+	inline static constexpr const char *kVariables[] = {"a", "b", "c", "x", "y", "n1"};
+	inline static constexpr const char *kLoopVariables[] = {"i", "j"};
+	inline static constexpr const char *kArrays[] = {"p", "q"};
+	inline static constexpr const char *kBinaryOperators[] = {"+", "-", "*", "/", "MOD", "**"};
+
+	std::mt19937_64 m_rng;
+	uint32_t m_line_count{};
+
+	inline uint32_t rand(uint32_t n) { return std::uniform_int_distribution<uint32_t>{0, n - 1}(m_rng); }
+	inline bool chance(uint32_t percent) { return rand(100) < percent; }
+
+	String gen_variable() { return kVariables[rand(std::size(kVariables))]; }
+	String gen_read_variable() {
+		return chance(80) ? gen_variable() : kLoopVariables[rand(std::size(kLoopVariables))];
+	}
+	String gen_number() { return std::to_string(chance(90) ? rand(10) : rand(100000)); }
+	// an element of an array, the index mostly in range of the small sizes
+	String gen_element(uint32_t depth) {
+		return String(kArrays[rand(std::size(kArrays))]) + "(" + (chance(50) ? gen_number() : gen_expression(depth)) +
+		       ")";
+	}
+	String gen_expression(uint32_t depth) {
+		if (depth == 0 || chance(30))
+			return chance(50) ? gen_read_variable() : gen_number();
+		if (chance(15))
+			return String(chance(50) ? "-" : "+") + "(" + gen_expression(depth - 1) + ")";
+		if (chance(10))
+			return gen_element(depth - 1);
+		String op = kBinaryOperators[rand(std::size(kBinaryOperators))];
+		// small exponents keep the values in range
+		String right =
+		    op == "**" ? (chance(80) ? std::to_string(rand(4)) : gen_read_variable()) : gen_expression(depth - 1);
+		return "(" + gen_expression(depth - 1) + ") " + op + " (" + right + ")";
+	}
+	LineID gen_line() { return chance(95) ? 10 * (1 + rand(m_line_count)) : 10 * rand(m_line_count + 2) + 5; }
+	String gen_statement() {
+		switch (rand(12)) {
+		case 0:
+			return "REM fuzz";
+		case 1:
+			return "INPUT " + (chance(80) ? gen_variable() : gen_element(1));
+		case 2:
+		case 3:
+			return "PRINT " + gen_expression(3);
+		case 4:
+			return "GOTO " + std::to_string(gen_line());
+		case 5:
+		case 6:
+			return "IF " + gen_expression(2) + " " + "<=>"[rand(3)] + " " + gen_expression(2) + " THEN " +
+			       std::to_string(gen_line());
+		case 7:
+			return "END";
+		case 8:
+			return "LET " + gen_element(1) + " = " + gen_expression(3);
+		default:
+			return "LET " + gen_variable() + " = " + gen_expression(3);
+		}
+	}
+	String gen_input() {
+		switch (rand(10)) {
+		case 0:
+			return "- " + gen_number();
+		case 1:
+			return "+" + gen_number();
+		case 2:
+			return "x1";
+		default:
+			return gen_number();
+		}
+	}
+
+public:
+	inline explicit Generator(uint64_t seed) : m_rng{seed} {}
+
+	// nullopt if the parser rejects a generated line
+	std::optional<Case> Generate() {
+		std::vector<String> stmt_strs;
+		m_line_count = 1 + rand(24);
+		// define the variables first so that most runs go past the first statements
+		for (const char *var : kVariables)
+			if (chance(70))
+				stmt_strs.push_back("LET " + String(var) + " = " + gen_number());
+		for (const char *var : kArrays)
+			if (chance(70))
+				stmt_strs.push_back("DIM " + String(var) + "(" + gen_number() + ")");
+		while (stmt_strs.size() < m_line_count) {
+			if (!chance(25)) {
+				stmt_strs.push_back(gen_statement());
+				continue;
+			}
+			// counted loop, the body doesn't write the counter so that it terminates unless jumped out of
+			String var = kLoopVariables[rand(std::size(kLoopVariables))];
+			bool native = chance(50);
+			if (native) {
+				// possibly empty or descending, the step may be an expression
+				String step = chance(50) ? "" : " STEP " + (chance(70) ? std::to_string(int(rand(7)) - 3) : "a");
+				stmt_strs.push_back("FOR " + var + " = " + gen_number() + " TO " + gen_expression(1) + step);
+			} else
+				stmt_strs.push_back("LET " + var + " = 0");
+			std::size_t begin = stmt_strs.size();
+			for (uint32_t i = 1 + rand(4); i; --i)
+				stmt_strs.push_back(chance(80) ? "LET " + gen_variable() + " = " + gen_expression(3) : gen_statement());
+			if (native)
+				stmt_strs.push_back("NEXT " + var);
+			else {
+				stmt_strs.push_back("LET " + var + " = " + var + " + 1");
+				stmt_strs.push_back("IF " + var + " < " + std::to_string(1 + rand(50)) + " THEN " +
+				                    std::to_string(10 * (begin + 1)));
+			}
+		}
+
+		Case ret;
+		for (std::size_t i = 0; i < stmt_strs.size(); ++i) {
+			auto stmt_res = basic::Statement::Parse(basic::Token::Tokenize(stmt_strs[i]));
+			if (stmt_res.IsError()) {
+				std::cerr << "Unable to parse \'" << stmt_strs[i] << "\': " << stmt_res.PopError().Format()
+				          << std::endl;
+				return std::nullopt;
+			}
+			LineID line = 10 * (i + 1);
+			ret.source += std::to_string(line) + " " + stmt_strs[i] + "\n";
+			ret.program.InsertStatement(line, stmt_res.PopValue());
+		}
+		for (uint32_t i = rand(6); i; --i)
+			ret.inputs.push_back(gen_input());
+		return ret;
+	}
+};
+
+String format_final(const basic::Context *p_context, const basic::RuntimeError &error) {
+	return (p_context ? "[" + std::to_string(p_context->GetLine()) + "]" : String{}) + error.Format() + "\n";
+}
+
+template <typename T> bool is_error(const basic::RuntimeError &error) {
+	bool ret = false;
+	error.Visit([&ret](const auto &error) { ret = std::is_same_v<std::decay_t<decltype(error)>, T>; });
+	return ret;
+}
+
+// Step loop on the calling thread, nullopt if the step limit is reached
+std::optional<Outcome> run_steps(const Case &fuzz_case, uint64_t max_steps) {
+	Outcome ret;
+	auto context_res = basic::Context::Create(fuzz_case.program);
+	if (context_res.IsError()) {
+		ret.outputs = format_final(nullptr, context_res.PopError());
+		return ret;
+	}
+	auto context = context_res.PopValue();
+	for (const auto &input : fuzz_case.inputs)
+		context->PushInput(input);
+
+	for (uint64_t step = 0; step < max_steps; ++step) {
+		auto step_res = fuzz_case.program.Step(context.get());
+		if (step_res.IsOK())
+			continue;
+		auto error = step_res.PopError();
+		String outputs = context->PopOutputs();
+		if (!outputs.empty())
+			ret.outputs += outputs + "\n";
+		if (!is_error<basic::MsgPrint>(error)) {
+			ret.outputs += format_final(context.get(), error);
+			ret.stats = fuzz_case.program.FormatAST(context.get());
+			return ret;
+		}
+	}
+	return std::nullopt;
+}
+
+std::optional<Outcome> run_reference(const Case &fuzz_case, uint64_t max_steps) {
+	basic::Jit::SetMode(basic::JitMode::kDisabled);
+	return run_steps(fuzz_case, max_steps);
+}
+
+std::optional<Outcome> run_jit(const Case &fuzz_case, uint64_t max_steps) {
+	basic::Jit::SetMode(basic::JitMode::kEnabled);
+	return run_steps(fuzz_case, max_steps);
+}
+
+std::optional<Outcome> run_machine(const Case &fuzz_case, uint64_t) {
+	Outcome ret;
+	std::unique_ptr<basic::Context> context;
+	for (std::size_t input_id = 0;;) {
+		auto machine = basic::Machine::Execute(fuzz_case.program, std::move(context), [] {});
+		auto result = basic::Machine::GetResult(&machine);
+		context = std::move(result.context);
+		String outputs = context ? context->PopOutputs() : String{};
+		if (!outputs.empty())
+			ret.outputs += outputs + "\n";
+
+		auto error = result.result.PopError();
+		if (is_error<basic::MsgPrint>(error))
+			continue;
+		if (is_error<basic::MsgRequestInput>(error) && input_id < fuzz_case.inputs.size()) {
+			context->PushInput(fuzz_case.inputs[input_id++]);
+			continue;
+		}
+		ret.outputs += format_final(context.get(), error);
+		if (context)
+			ret.stats = fuzz_case.program.FormatAST(context.get());
+		return ret;
+	}
+}
+
+// a small slice so that sessions get preempted and resumed on other workers
+basic::Scheduler &get_scheduler() {
+	static basic::Scheduler scheduler{2, 7};
+	return scheduler;
+}
+
+std::optional<Outcome> run_scheduler(const Case &fuzz_case, uint64_t) {
+	struct State {
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool finished = false;
+		std::optional<basic::LineID> opt_input_line; // inputs ran out
+		String outputs;
+		basic::ExecuteResult result;
+		std::size_t input_id = 0;
+	};
+	auto state = std::make_shared<State>();
+	basic::Scheduler &scheduler = get_scheduler();
+	auto session = std::make_shared<basic::Scheduler::SessionHandle>();
+
+	basic::SessionCallbacks callbacks{
+	    .on_output =
+	        [state](const String &outputs) {
+		        std::scoped_lock lock{state->mutex};
+		        state->outputs += outputs + "\n";
+	        },
+	    .on_input_request =
+	        [state, session, &fuzz_case, &scheduler](basic::LineID line) {
+		        std::unique_lock lock{state->mutex};
+		        if (state->input_id < fuzz_case.inputs.size()) {
+			        const String &input = fuzz_case.inputs[state->input_id++];
+			        lock.unlock();
+			        scheduler.PushInput(*session, input);
+		        } else {
+			        // stop the session to get its context back
+			        state->opt_input_line = line;
+			        lock.unlock();
+			        scheduler.Terminate(*session);
+		        }
+	        },
+	    .on_finish =
+	        [state](basic::ExecuteResult result) {
+		        std::scoped_lock lock{state->mutex};
+		        state->result = std::move(result);
+		        state->finished = true;
+		        state->condition.notify_one();
+	        },
+	};
+	{
+		// the callbacks may run before Submit returns
+		std::scoped_lock lock{state->mutex};
+		*session = scheduler.Submit(fuzz_case.program, nullptr, 0, std::move(callbacks));
+	}
+
+	std::unique_lock lock{state->mutex};
+	state->condition.wait(lock, [&state] { return state->finished; });
+	Outcome ret{.outputs = std::move(state->outputs)};
+	const basic::Context *p_context = state->result.context.get();
+	ret.outputs += state->opt_input_line.has_value() ? format_final(p_context, basic::MsgRequestInput{})
+	                                                 : format_final(p_context, state->result.result.PopError());
+	if (p_context)
+		ret.stats = fuzz_case.program.FormatAST(p_context);
+	return ret;
+}
+
+// Compile the transpiled program and run it with the inputs on stdin, statistics are not available
+std::optional<Outcome> run_transpiler(const Case &fuzz_case, const String &cxx) {
+	namespace fs = std::filesystem;
+	fs::path dir = fs::temp_directory_path() / ("qbasicfuzz-" + std::to_string(getpid()));
+	fs::create_directories(dir);
+	fs::path source_path = dir / "program.cpp", exe_path = dir / "program", input_path = dir / "input.txt",
+	         output_path = dir / "output.txt";
+	std::ofstream{source_path} << basic::Transpiler::Transpile(fuzz_case.program);
+	{
+		std::ofstream input_file{input_path};
+		for (const auto &input : fuzz_case.inputs)
+			input_file << input << "\n";
+	}
+	// the interpreter relies on wrapping integer overflow as well
+	String compile_cmd = cxx + " -std=c++17 -O1 -fwrapv -o " + exe_path.string() + " " + source_path.string();
+	if (std::system(compile_cmd.c_str()) != 0)
+		return Outcome{.outputs = "<compile error>"};
+	String run_cmd = exe_path.string() + " < " + input_path.string() + " > " + output_path.string();
+	if (std::system(run_cmd.c_str()) == -1)
+		return Outcome{.outputs = "<run error>"};
+
+	std::stringstream output;
+	output << std::ifstream{output_path}.rdbuf();
+	fs::remove_all(dir);
+	return Outcome{.outputs = output.str()};
+}
+
+struct Engine {
+	const char *name;
+	std::function<std::optional<Outcome>(const Case &, uint64_t max_steps)> run;
+	uint64_t every; // run on one case out of every
+	bool compare_stats;
+	double seconds{}, reference_seconds{}; // on the cases this engine ran
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	uint64_t seed = std::random_device{}(), iterations = 1000, max_steps = 100000, cxx_every = 50;
+	String cxx;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		String arg = argv[i];
+		if (arg == "--seed")
+			seed = std::stoull(argv[i + 1]);
+		else if (arg == "--iterations")
+			iterations = std::stoull(argv[i + 1]);
+		else if (arg == "--steps")
+			max_steps = std::stoull(argv[i + 1]);
+		else if (arg == "--cxx")
+			cxx = argv[i + 1];
+		else if (arg == "--cxx-every")
+			cxx_every = std::max<uint64_t>(std::stoull(argv[i + 1]), 1);
+		else {
+			std::cerr << "Usage: " << argv[0]
+			          << " [--seed N] [--iterations N] [--steps N] [--cxx COMPILER] [--cxx-every N]" << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "seed " << seed << std::endl;
+
+	// compile lines as soon as possible so that short runs exercise the JIT
+	basic::Jit::SetThreshold(2);
+	std::vector<Engine> engines{
+	    {"reference", run_reference, 1, true},
+	    {"jit", run_jit, 1, true},
+	    {"machine", run_machine, 1, true},
+	    {"scheduler", run_scheduler, 1, true},
+	};
+	if (!cxx.empty())
+		engines.push_back(
+		    {"transpiler", [&cxx](const Case &fuzz_case, uint64_t) { return run_transpiler(fuzz_case, cxx); },
+		     cxx_every, false});
+
+	Generator generator{seed};
+	uint64_t limited = 0;
+	for (uint64_t iteration = 0; iteration < iterations; ++iteration) {
+		auto opt_case = generator.Generate();
+		if (!opt_case.has_value())
+			return 1;
+		const Case &fuzz_case = opt_case.value();
+
+		std::optional<Outcome> reference;
+		double reference_seconds = 0;
+		for (auto &engine : engines) {
+			if (iteration % engine.every)
+				continue;
+			// other engines have no step limit, they only run the cases the reference finishes
+			if (&engine != &engines.front() && !reference.has_value())
+				break;
+
+			auto begin = std::chrono::steady_clock::now();
+			auto opt_outcome = engine.run(fuzz_case, max_steps);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+			if (&engine == &engines.front())
+				reference_seconds = seconds;
+			if (opt_outcome.has_value()) {
+				engine.seconds += seconds;
+				engine.reference_seconds += reference_seconds;
+			}
+
+			if (&engine == &engines.front()) {
+				reference = std::move(opt_outcome);
+				limited += !reference.has_value();
+				continue;
+			}
+			if (opt_outcome->outputs != reference->outputs ||
+			    (engine.compare_stats && opt_outcome->stats != reference->stats)) {
+				std::cout << "Divergence on iteration " << iteration << " (" << engine.name << ")\n"
+				          << fuzz_case.source;
+				for (const auto &input : fuzz_case.inputs)
+					std::cout << "? " << input << "\n";
+				std::cout << "--- reference\n" << reference->outputs << reference->stats;
+				std::cout << "--- " << engine.name << "\n" << opt_outcome->outputs << opt_outcome->stats;
+				return 1;
+			}
+		}
+	}
+
+	std::cout << iterations << " cases, " << limited << " hit the step limit" << std::endl;
+	for (const auto &engine : engines)
+		std::cout << engine.name << ": " << engine.seconds << " s (x" << engine.seconds / engine.reference_seconds
+		          << " of the reference)" << std::endl;
+	return 0;
+}
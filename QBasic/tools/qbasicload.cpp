@@ -0,0 +1,159 @@
+#include "basic/Daemon.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+// Load generator for qbasicd: keeps a window of requests in flight on each connection, reports the throughput and the
+// latency percentiles from submission to the kFinish frame
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr const char *kDefaultScript = "10 INPUT n\n"
+                                       "20 LET s = 0\n"
+                                       "30 LET s = s + n * n\n"
+                                       "40 LET n = n - 1\n"
+                                       "50 IF n > 0 THEN 30\n"
+                                       "60 PRINT s\n"
+                                       "? 100\n";
+
+struct Options {
+	basic::String path = basic::kDaemonSocketPath, source = kDefaultScript;
+	uint32_t connection_count = 4, depth = 16, variant_count = 1;
+	uint64_t request_count = 10000;
+};
+
+struct ConnectionResult {
+	std::vector<uint64_t> latencies_ns;
+	uint64_t failures{};
+	basic::String first_failure;
+	bool lost{};
+};
+
+void run_connection(const Options &options, const std::vector<basic::String> &sources, uint64_t request_count,
+                    ConnectionResult *p_result) {
+	auto client = basic::DaemonClient::Connect(options.path);
+	if (client == nullptr) {
+		p_result->lost = true;
+		return;
+	}
+	p_result->latencies_ns.reserve(request_count);
+	std::unordered_map<uint64_t, Clock::time_point> in_flight;
+	for (uint64_t submitted = 0; p_result->latencies_ns.size() + p_result->failures < request_count;) {
+		if (in_flight.size() < options.depth && submitted < request_count) {
+			for (; in_flight.size() < options.depth && submitted < request_count; ++submitted) {
+				client->Submit(submitted, sources[submitted % sources.size()]);
+				in_flight.emplace(submitted, Clock::now());
+			}
+			if (!client->Flush()) {
+				p_result->lost = true;
+				return;
+			}
+		}
+		auto opt_reply = client->Receive();
+		if (!opt_reply.has_value()) {
+			p_result->lost = true;
+			return;
+		}
+		if (opt_reply->type != basic::DaemonFrame::kFinish)
+			continue;
+		auto it = in_flight.find(opt_reply->id);
+		if (it == in_flight.end())
+			continue;
+		if (opt_reply->status == basic::DaemonStatus::kEnd)
+			p_result->latencies_ns.push_back(
+			    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - it->second).count());
+		else if (p_result->failures++ == 0)
+			p_result->first_failure = "[" + std::to_string(opt_reply->line) + "]" + opt_reply->text;
+		in_flight.erase(it);
+	}
+}
+
+bool parse_options(int argc, char **argv, Options *p_options) {
+	for (int i = 1; i < argc; ++i) {
+		if (i + 1 >= argc)
+			return false;
+		if (strcmp(argv[i], "--socket") == 0)
+			p_options->path = argv[++i];
+		else if (strcmp(argv[i], "--connections") == 0)
+			p_options->connection_count = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--requests") == 0)
+			p_options->request_count = std::max(atoll(argv[++i]), 1ll);
+		else if (strcmp(argv[i], "--depth") == 0)
+			p_options->depth = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--variants") == 0)
+			p_options->variant_count = std::max(atoi(argv[++i]), 1);
+		else if (strcmp(argv[i], "--script") == 0) {
+			std::ifstream fin{argv[++i]};
+			if (!fin.is_open()) {
+				std::cerr << "Unable to load \'" << argv[i] << "\'" << std::endl;
+				return false;
+			}
+			std::ostringstream sout;
+			sout << fin.rdbuf();
+			p_options->source = sout.str();
+		} else
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	Options options;
+	if (!parse_options(argc, argv, &options)) {
+		std::cerr << "Usage: " << argv[0]
+		          << " [--socket PATH] [--connections N] [--requests N] [--depth N] [--variants N] [--script FILE]"
+		          << std::endl;
+		return 1;
+	}
+
+	// distinct sources of the same program (padded with blank lines), each one parsed once by the daemon
+	std::vector<basic::String> sources;
+	for (uint32_t i = 0; i < options.variant_count; ++i)
+		sources.push_back(options.source + basic::String(i, '\n'));
+
+	std::vector<ConnectionResult> results(options.connection_count);
+	std::vector<std::thread> threads;
+	auto begin = Clock::now();
+	for (uint32_t i = 0; i < options.connection_count; ++i) {
+		uint64_t request_count = options.request_count / options.connection_count +
+		                         (i < options.request_count % options.connection_count ? 1 : 0);
+		threads.emplace_back(run_connection, std::cref(options), std::cref(sources), request_count, &results[i]);
+	}
+	for (auto &thread : threads)
+		thread.join();
+	double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+	std::vector<uint64_t> latencies_ns;
+	uint64_t failures = 0;
+	for (const auto &result : results) {
+		if (result.lost) {
+			std::cerr << "Lost the connection to \'" << options.path << "\'" << std::endl;
+			return 1;
+		}
+		latencies_ns.insert(latencies_ns.end(), result.latencies_ns.begin(), result.latencies_ns.end());
+		if (result.failures && failures == 0)
+			std::cerr << "Request failed: " << result.first_failure << std::endl;
+		failures += result.failures;
+	}
+	if (latencies_ns.empty())
+		return 1;
+	std::sort(latencies_ns.begin(), latencies_ns.end());
+	const auto percentile_us = [&latencies_ns](double p) {
+		auto index = std::min<std::size_t>(std::size_t(p * double(latencies_ns.size())), latencies_ns.size() - 1);
+		return double(latencies_ns[index]) / 1e3;
+	};
+
+	std::cout << latencies_ns.size() + failures << " requests (" << failures << " failed) in " << seconds << " s, "
+	          << uint64_t(double(latencies_ns.size() + failures) / seconds) << " req/s" << std::endl;
+	std::cout << "latency us: p50 " << percentile_us(0.5) << ", p99 " << percentile_us(0.99) << ", max "
+	          << percentile_us(1.0) << std::endl;
+	return failures ? 1 : 0;
+}
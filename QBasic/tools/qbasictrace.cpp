@@ -0,0 +1,156 @@
+#include "basic/Machine.hpp"
+#include "basic/Script.hpp"
+#include "basic/Trace.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+// Record a script with its inputs, stops at the first unanswered input request
+static int record(const char *script_filename, const char *trace_filename) {
+	std::ifstream fin{script_filename};
+	if (!fin.is_open()) {
+		std::cerr << "Unable to load \'" << script_filename << "\'" << std::endl;
+		return 1;
+	}
+	auto script_res = basic::Script::Load(fin);
+	if (script_res.IsError()) {
+		std::cerr << script_res.PopError().Format() << std::endl;
+		return 1;
+	}
+	auto script = script_res.PopValue();
+
+	std::ofstream fout{trace_filename, std::ios::binary};
+	if (!fout.is_open()) {
+		std::cerr << "Unable to write \'" << trace_filename << "\'" << std::endl;
+		return 1;
+	}
+	basic::TraceWriter tracer{fout, script.GetProgram(), nullptr};
+
+	std::unique_ptr<basic::Context> context;
+	for (std::size_t input_id = 0;;) {
+		std::unique_ptr<basic::Machine> machine =
+		    basic::Machine::Execute(script.GetProgram(), std::move(context), [] {}, {.p_tracer = &tracer});
+		auto result = basic::Machine::GetResult(&machine);
+		context = std::move(result.context);
+		if (context) {
+			basic::String outputs = context->PopOutputs();
+			if (!outputs.empty())
+				std::cout << outputs << std::endl;
+		}
+
+		auto error = result.result.PopError();
+		bool resume = false;
+		error.Visit([&](const auto &error) {
+			using Error = std::decay_t<decltype(error)>;
+			if constexpr (std::is_same_v<Error, basic::MsgRequestInput>) {
+				if ((resume = input_id < script.GetInputs().size()))
+					context->PushInput(script.GetInputs()[input_id++]);
+			} else
+				resume = std::is_same_v<Error, basic::MsgPrint>;
+		});
+		if (!resume) {
+			std::cout << (context ? "[" + std::to_string(context->GetLine()) + "]" : "") << error.Format() << std::endl;
+			return 0;
+		}
+	}
+}
+
+static int replay(std::istream &istr) {
+	auto opt_result = basic::ReplayTrace(istr, std::cout);
+	if (!opt_result.has_value()) {
+		std::cerr << "Invalid trace" << std::endl;
+		return 1;
+	}
+	std::cerr << opt_result->lines << " lines replayed" << std::endl;
+	if (opt_result->divergence.has_value()) {
+		std::cerr << "Diverged: " << opt_result->divergence.value() << std::endl;
+		return 2;
+	}
+	return 0;
+}
+
+// Per-line counts, estimated timing from the sampled durations, and the most frequent transitions
+static int dump(std::istream &istr) {
+	auto opt_reader = basic::TraceReader::Open(istr);
+	if (!opt_reader.has_value()) {
+		std::cerr << "Invalid trace" << std::endl;
+		return 1;
+	}
+	struct LineSummary {
+		uint64_t count, samples, sample_ns;
+		inline uint64_t GetAverageNs() const { return samples ? sample_ns / samples : 0; }
+		inline uint64_t GetTimeNs() const { return samples ? sample_ns * count / samples : 0; }
+	};
+	std::map<basic::LineID, LineSummary> lines;
+	std::map<std::pair<basic::LineID, basic::LineID>, uint64_t> edges;
+	uint64_t writes = 0, inputs = 0;
+
+	basic::TraceRecord record;
+	std::optional<basic::LineID> prev_line;
+	while (opt_reader->Next(&record)) {
+		if (record.event == basic::TraceEvent::kWrite)
+			++writes;
+		else if (record.event == basic::TraceEvent::kInput)
+			++inputs;
+		else {
+			if (prev_line.has_value()) {
+				if (record.event == basic::TraceEvent::kTimedLine) {
+					++lines[prev_line.value()].samples;
+					lines[prev_line.value()].sample_ns += record.time_ns;
+				}
+				++edges[{prev_line.value(), record.line}];
+			}
+			++lines[record.line].count;
+			prev_line = record.line;
+		}
+	}
+
+	uint64_t total_count = 0, total_ns = 0;
+	for (const auto &entry : lines) {
+		total_count += entry.second.count;
+		total_ns += entry.second.GetTimeNs();
+	}
+	std::cout << total_count << " lines, " << writes << " writes, " << inputs << " inputs, ~" << total_ns / 1000
+	          << " us" << std::endl;
+
+	std::vector<std::pair<basic::LineID, LineSummary>> sorted_lines{lines.begin(), lines.end()};
+	std::sort(sorted_lines.begin(), sorted_lines.end(),
+	          [](const auto &l, const auto &r) { return l.second.GetTimeNs() > r.second.GetTimeNs(); });
+	std::cout << std::endl << std::setw(10) << "LINE" << std::setw(14) << "COUNT" << std::setw(10) << "SAMPLES"
+	          << std::setw(14) << "~TIME(us)" << std::setw(10) << "AVG(ns)" << std::setw(8) << "TIME%" << std::endl;
+	for (const auto &[line, summary] : sorted_lines)
+		std::cout << std::setw(10) << line << std::setw(14) << summary.count << std::setw(10) << summary.samples
+		          << std::setw(14) << summary.GetTimeNs() / 1000 << std::setw(10) << summary.GetAverageNs()
+		          << std::setw(7) << std::fixed << std::setprecision(1)
+		          << (total_ns ? 100.0 * summary.GetTimeNs() / total_ns : 0.0) << '%' << std::endl;
+
+	constexpr std::size_t kHotEdges = 10;
+	std::vector<std::pair<std::pair<basic::LineID, basic::LineID>, uint64_t>> sorted_edges{edges.begin(), edges.end()};
+	std::sort(sorted_edges.begin(), sorted_edges.end(),
+	          [](const auto &l, const auto &r) { return l.second > r.second; });
+	std::cout << std::endl << "Hot paths:" << std::endl;
+	for (std::size_t i = 0; i < std::min(kHotEdges, sorted_edges.size()); ++i)
+		std::cout << std::setw(10) << sorted_edges[i].first.first << " -> " << std::setw(10)
+		          << sorted_edges[i].first.second << std::setw(14) << sorted_edges[i].second << std::endl;
+	return 0;
+}
+
+// qbasictrace record SCRIPT.qbasic TRACE | replay TRACE | dump TRACE
+int main(int argc, char *argv[]) {
+	basic::String command = argc >= 2 ? argv[1] : "";
+	if (command == "record" && argc == 4)
+		return record(argv[2], argv[3]);
+	if ((command == "replay" || command == "dump") && argc == 3) {
+		std::ifstream fin{argv[2], std::ios::binary};
+		if (!fin.is_open()) {
+			std::cerr << "Unable to load \'" << argv[2] << "\'" << std::endl;
+			return 1;
+		}
+		return command == "replay" ? replay(fin) : dump(fin);
+	}
+	std::cerr << "Usage: " << argv[0] << " record SCRIPT.qbasic TRACE | replay TRACE | dump TRACE" << std::endl;
+	return 1;
+}
@@ -1,7 +1,60 @@
 #include "GridTest.hpp"
 
+#include "Config.hpp"
 #include "game/Grid.hpp"
 
+#include <algorithm>
+#include <chrono>
+
+// HasSolution by trying every pair of cells
+static bool has_solution_by_pairs(const Grid &grid) {
+	for (uint32_t y1 = 1; y1 <= grid.GetHeight(); ++y1)
+		for (uint32_t x1 = 1; x1 <= grid.GetWidth(); ++x1)
+			for (uint32_t y2 = y1; y2 <= grid.GetHeight(); ++y2)
+				for (uint32_t x2 = 1; x2 <= grid.GetWidth(); ++x2)
+					if (grid.IsLinked({x1, y1}, {x2, y2}, nullptr))
+						return true;
+	return false;
+}
+
+// cells strictly between two aligned cells are empty
+static bool is_segment_empty(const Grid &grid, Coord c1, Coord c2) {
+	if (c1.x != c2.x && c1.y != c2.y)
+		return false;
+	Coord lo = c1 < c2 ? c1 : c2, hi = c1 < c2 ? c2 : c1;
+	for (Coord c = lo; !(c == hi);) {
+		c = c1.x == c2.x ? Coord{c.x, c.y + 1} : Coord{c.x + 1, c.y};
+		if (!(c == hi) && grid[c])
+			return false;
+	}
+	return true;
+}
+
+// IsLinked by trying every path c1 -> j1 -> j2 -> c2 with j1 on a line of c1 and j2 on a line of c2
+static bool is_linked_by_paths(const Grid &grid, Coord c1, Coord c2) {
+	const auto is_surrounded = [&grid](Coord c) {
+		return grid.Get(c.x - 1, c.y) && grid.Get(c.x + 1, c.y) && grid.Get(c.x, c.y - 1) && grid.Get(c.x, c.y + 1);
+	};
+	if (c1 == c2 || !grid[c1] || grid[c1] != grid[c2] || is_surrounded(c1) || is_surrounded(c2))
+		return false;
+	const auto get_lines = [&grid](Coord c) {
+		std::vector<Coord> ret;
+		for (uint32_t x = 0; x <= grid.GetWidth() + 1; ++x)
+			ret.push_back({x, c.y});
+		for (uint32_t y = 0; y <= grid.GetHeight() + 1; ++y)
+			ret.push_back({c.x, y});
+		return ret;
+	};
+	for (Coord j1 : get_lines(c1)) {
+		if ((!(j1 == c1) && grid[j1]) || !is_segment_empty(grid, c1, j1))
+			continue;
+		for (Coord j2 : get_lines(c2))
+			if ((j2 == c2 || !grid[j2]) && is_segment_empty(grid, j1, j2) && is_segment_empty(grid, j2, c2))
+				return true;
+	}
+	return false;
+}
+
 void GridTest::test1Match() {
 	Grid grid;
 	grid.Initialize(3, 3);
@@ -52,4 +105,221 @@ void GridTest::testHasSolution() {
 	QVERIFY(!grid.HasSolution(nullptr));
 }
 
+void GridTest::testLinkPaths() {
+	// random boards and pairs, the joints of each link being a path
+	Random random{3};
+	for (int board = 0; board < 300; ++board) {
+		Grid grid;
+		grid.Initialize(1 + random() % 70, 1 + random() % 12);
+		uint32_t fill = random() % 100;
+		for (uint32_t y = 1; y <= grid.GetHeight(); ++y)
+			for (uint32_t x = 1; x <= grid.GetWidth(); ++x)
+				grid.Set(x, y, random() % 100 < fill ? 1 + random() % 2 : 0);
+		for (int i = 0; i < 200; ++i) {
+			Coord c1{uint32_t(random() % grid.GetWidth()) + 1, uint32_t(random() % grid.GetHeight()) + 1};
+			Coord c2{uint32_t(random() % grid.GetWidth()) + 1, uint32_t(random() % grid.GetHeight()) + 1};
+			std::vector<Coord> joints;
+			bool linked = grid.IsLinked(c1, c2, &joints);
+			QCOMPARE(linked, is_linked_by_paths(grid, c1, c2));
+			if (!linked)
+				continue;
+			QVERIFY(joints.size() >= 2 && joints.size() <= 4 && joints.front() == c1 && joints.back() == c2);
+			for (std::size_t j = 1; j < joints.size(); ++j) {
+				QVERIFY(is_segment_empty(grid, joints[j - 1], joints[j]));
+				QVERIFY(j + 1 == joints.size() || grid[joints[j]] == 0);
+			}
+		}
+	}
+}
+
+void GridTest::testLinkedCells() {
+	// all the links from a cell at once, the same as IsLinked at two turns, fewer at fewer turns
+	Random random{4};
+	for (int board = 0; board < 300; ++board) {
+		Grid grid;
+		grid.Initialize(1 + random() % 40, 1 + random() % 12);
+		uint32_t fill = random() % 100;
+		for (uint32_t y = 1; y <= grid.GetHeight(); ++y)
+			for (uint32_t x = 1; x <= grid.GetWidth(); ++x)
+				grid.Set(x, y, random() % 100 < fill ? 1 + random() % 2 : 0);
+		for (int i = 0; i < 10; ++i) {
+			Coord c{uint32_t(random() % grid.GetWidth()) + 1, uint32_t(random() % grid.GetHeight()) + 1};
+			std::set<Coord> expected;
+			for (uint32_t y = 1; y <= grid.GetHeight(); ++y)
+				for (uint32_t x = 1; x <= grid.GetWidth(); ++x)
+					if (grid.IsLinked(c, {x, y}, nullptr))
+						expected.insert({x, y});
+			std::set<Coord> fewer;
+			for (uint32_t max_turns = 0; max_turns <= 3; ++max_turns) {
+				std::vector<std::vector<Coord>> paths;
+				std::vector<Coord> linked = grid.GetLinked(c, max_turns, &paths);
+				std::set<Coord> linked_set{linked.begin(), linked.end()};
+				QCOMPARE(linked_set.size(), linked.size());
+				QVERIFY(grid.GetLinked(c, max_turns, nullptr) == linked);
+				QVERIFY(std::includes(linked_set.begin(), linked_set.end(), fewer.begin(), fewer.end()));
+				if (max_turns == Grid::kMaxTurns)
+					QVERIFY(linked_set == expected);
+				else if (max_turns < Grid::kMaxTurns)
+					QVERIFY(std::includes(expected.begin(), expected.end(), linked_set.begin(), linked_set.end()));
+				QCOMPARE(paths.size(), linked.size());
+				for (std::size_t k = 0; k < linked.size(); ++k) {
+					const auto &joints = paths[k];
+					QVERIFY(joints.size() >= 2 && joints.size() <= max_turns + 2);
+					QVERIFY(joints.front() == c && joints.back() == linked[k] && grid[c] == grid[linked[k]]);
+					for (std::size_t j = 1; j < joints.size(); ++j) {
+						QVERIFY(is_segment_empty(grid, joints[j - 1], joints[j]));
+						QVERIFY(j + 1 == joints.size() || grid[joints[j]] == 0);
+					}
+				}
+				fewer = std::move(linked_set);
+			}
+		}
+	}
+}
+
+void GridTest::testIncrementalSolution() {
+	// random edits and links of small boards, against trying every pair
+	Random random{1};
+	for (int board = 0; board < 200; ++board) {
+		Grid grid;
+		std::array<Coord, 2> solution{};
+		grid.InitializeRandomized(&random, 2 + random() % 7, 2 + random() % 6, 1 + random() % 4, &solution);
+		for (int step = 0; step < 40; ++step) {
+			bool has_solution = grid.HasSolution(&solution);
+			QCOMPARE(has_solution, has_solution_by_pairs(grid));
+			if (has_solution && random() % 4) {
+				QVERIFY(grid.IsLinked(solution[0], solution[1], nullptr));
+				grid.Set(solution[0], 0);
+				grid.Set(solution[1], 0);
+			} else
+				grid.Set(1 + random() % grid.GetWidth(), 1 + random() % grid.GetHeight(), random() % 3);
+		}
+	}
+}
+
+void GridTest::testLargeBoard() {
+	// a 200x200 game cleared by its hints, each check after a link stays interactive
+	Random random{2};
+	Grid grid;
+	std::array<Coord, 2> solution{};
+	grid.InitializeRandomized(&random, 200, 200, 4, &solution);
+	auto max_time = std::chrono::steady_clock::duration::zero();
+	for (int step = 0; step < 2000 && grid.HasSolution(&solution); ++step) {
+		QVERIFY(grid.IsLinked(solution[0], solution[1], nullptr));
+		auto begin = std::chrono::steady_clock::now();
+		grid.Set(solution[0], 0);
+		grid.Set(solution[1], 0);
+		grid.HasSolution(&solution);
+		max_time = std::max(max_time, std::chrono::steady_clock::now() - begin);
+	}
+	QVERIFY(max_time < std::chrono::milliseconds{50});
+}
+
+void GridTest::testSolvableBoard() {
+	// boards of all shapes cleared in their order, the same again from the same seed
+	for (uint32_t width = 1; width <= 12; ++width)
+		for (uint32_t height = 1; height <= 12; ++height)
+			for (RandomSeed seed = 0; seed < 8; ++seed) {
+				Grid grid, again;
+				std::array<Coord, 2> solution{};
+				std::vector<std::array<Coord, 2>> pairs;
+				grid.InitializeSolvable(seed, width, height, 1 + seed % kBlockTypes, &solution, &pairs);
+				again.InitializeSolvable(seed, width, height, 1 + seed % kBlockTypes, nullptr, nullptr);
+				QCOMPARE(pairs.size(), std::size_t(width * height / 2));
+				QCOMPARE(grid.HasSolution(nullptr), !pairs.empty());
+				QVERIFY(pairs.empty() || grid.IsLinked(solution[0], solution[1], nullptr));
+				uint32_t count = 0;
+				for (uint32_t y = 1; y <= height; ++y)
+					for (uint32_t x = 1; x <= width; ++x) {
+						QCOMPARE(grid.Get(x, y), again.Get(x, y));
+						QVERIFY(grid.Get(x, y) <= 1 + seed % kBlockTypes);
+						count += grid.Get(x, y) != 0;
+					}
+				QCOMPARE(count, width * height / 2 * 2);
+				for (auto [c1, c2] : pairs) {
+					QVERIFY(grid.IsLinked(c1, c2, nullptr));
+					grid.Set(c1, 0);
+					grid.Set(c2, 0);
+				}
+				QVERIFY(!grid.HasSolution(nullptr));
+			}
+
+	// in linear time
+	Grid grid;
+	auto begin = std::chrono::steady_clock::now();
+	grid.InitializeSolvable(1, 1000, 1000, kBlockTypes, nullptr, nullptr);
+	QVERIFY(std::chrono::steady_clock::now() - begin < std::chrono::seconds{2});
+}
+
+void GridTest::testShuffle() {
+	// the blocks left permuted over their cells, with a move, through a game
+	Random random{5};
+	for (int board = 0; board < 100; ++board) {
+		Grid grid;
+		std::vector<std::array<Coord, 2>> pairs;
+		grid.InitializeSolvable(random(), 2 + random() % 15, 2 + random() % 15, 1 + random() % kBlockTypes, nullptr,
+		                        &pairs);
+		for (std::size_t k = 0; k < pairs.size(); ++k) {
+			std::array<Coord, 2> solution{};
+			if (random() % 3 == 0) {
+				std::vector<Block> blocks, shuffled_blocks;
+				for (uint32_t y = 1; y <= grid.GetHeight(); ++y)
+					for (uint32_t x = 1; x <= grid.GetWidth(); ++x)
+						blocks.push_back(grid.Get(x, y));
+				QVERIFY(grid.Shuffle(&random, &solution));
+				QVERIFY(grid.IsLinked(solution[0], solution[1], nullptr));
+				for (uint32_t y = 1; y <= grid.GetHeight(); ++y)
+					for (uint32_t x = 1; x <= grid.GetWidth(); ++x) {
+						QCOMPARE(grid.Get(x, y) != 0, blocks[shuffled_blocks.size()] != 0);
+						shuffled_blocks.push_back(grid.Get(x, y));
+					}
+				std::sort(blocks.begin(), blocks.end());
+				std::sort(shuffled_blocks.begin(), shuffled_blocks.end());
+				QVERIFY(blocks == shuffled_blocks);
+				QCOMPARE(grid.HasSolution(nullptr), has_solution_by_pairs(grid));
+			}
+			if (!grid.HasSolution(&solution))
+				break;
+			grid.Set(solution[0], 0);
+			grid.Set(solution[1], 0);
+		}
+	}
+
+	// no move for any permutation
+	Grid grid;
+	grid.Initialize(3, 1);
+	grid.Set({1, 1}, 1);
+	grid.Set({3, 1}, 2);
+	QVERIFY(!grid.Shuffle(&random, nullptr));
+	QVERIFY(grid.Get(1, 1) && !grid.Get(2, 1) && grid.Get(3, 1));
+
+	// No current move, and most blocks surrounded so that the random tries often all miss: distinct types around the
+	// edges, the same type inside. The cells linked are then searched in turn.
+	Grid surrounded;
+	surrounded.Initialize(64, 64);
+	Block edge_type = 0;
+	for (uint32_t y = 1; y <= 64; ++y)
+		for (uint32_t x = 1; x <= 64; ++x)
+			surrounded.Set(x, y, x == 1 || x == 64 || y == 1 || y == 64 ? ++edge_type : Block{255});
+	QVERIFY(!surrounded.HasSolution(nullptr));
+	for (int i = 0; i < 20; ++i) {
+		grid = surrounded;
+		std::array<Coord, 2> solution{};
+		QVERIFY(grid.Shuffle(&random, &solution));
+		QVERIFY(grid.IsLinked(solution[0], solution[1], nullptr));
+		QCOMPARE(grid.Get(solution[0]), grid.Get(solution[1]));
+	}
+
+	// late in a large game, in a bounded time
+	std::vector<std::array<Coord, 2>> pairs;
+	grid.InitializeSolvable(3, 100, 100, kBlockTypes, nullptr, &pairs);
+	for (std::size_t k = 0; k < pairs.size() * 3 / 4; ++k) {
+		grid.Set(pairs[k][0], 0);
+		grid.Set(pairs[k][1], 0);
+	}
+	auto begin = std::chrono::steady_clock::now();
+	QVERIFY(grid.Shuffle(&random, nullptr));
+	QVERIFY(std::chrono::steady_clock::now() - begin < std::chrono::milliseconds{50});
+}
+
 QTEST_MAIN(GridTest)
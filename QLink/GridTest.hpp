@@ -9,6 +9,12 @@ private slots:
 	static void test2Match();
 	static void test3Match();
 	static void testHasSolution();
+	static void testLinkPaths();
+	static void testLinkedCells();
+	static void testIncrementalSolution();
+	static void testLargeBoard();
+	static void testSolvableBoard();
+	static void testShuffle();
 
 public:
 	GridTest() = default;
@@ -33,13 +33,15 @@ MainWindow::MainWindow(QWidget *parent)
 	// Setup New Game Dialog
 	connect(m_new_game_dialog, &NewGameDialog::newGame, this,
 	        [this](uint32_t width, uint32_t height, bool multi_player) {
+		        RandomSeed seed = std::random_device{}();
 		        if (multi_player)
-			        m_game.Start(width, height, kInitialTime, kBlockTypes, 2,
+			        m_game.Start(seed, width, height, kInitialTime, kBlockTypes, 2,
 			                     {EffectType::kShuffle, EffectType::kDizzy, EffectType::kHint, EffectType::kFreeze,
 			                      EffectType::kPlus1S});
 		        else
-			        m_game.Start(width, height, kInitialTime, kBlockTypes, 1,
+			        m_game.Start(seed, width, height, kInitialTime, kBlockTypes, 1,
 			                     {EffectType::kShuffle, EffectType::kHint, EffectType::kPlus1S});
+		        update_title();
 		        update_game();
 		        m_timer->start();
 	        });
@@ -60,6 +62,7 @@ MainWindow::MainWindow(QWidget *parent)
 		fin.seekg(0);
 		if (fin.is_open()) {
 			m_game = Serializer<Game>::Read(fin);
+			update_title();
 			update_game();
 			if (!m_game.IsValid())
 				QMessageBox::critical(this, tr("QLink"), tr("Invalid QLink File ") + filename);
@@ -143,6 +146,12 @@ void MainWindow::keyPressEvent(QKeyEvent *event) {
 	update_game();
 }
 
+void MainWindow::update_title() {
+	if (m_game.IsValid())
+		setWindowTitle(tr("QLink - Board %1").arg(m_game.GetSeed()));
+	else
+		setWindowTitle(tr("QLink"));
+}
 void MainWindow::update_game() {
 	m_game.Update();
 	m_game_grid_widget->update();
@@ -22,6 +22,7 @@ private:
 	GameWidget *m_game_grid_widget;
 	NewGameDialog *m_new_game_dialog;
 
+	void update_title();
 	void update_game();
 	void pause_game();
 
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cinttypes>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Lines of bits, each stored in 64-bit words, for range tests and nearest-bit searches a word at a time
+class Bitboard {
+private:
+	uint32_t m_line_words{};
+	std::vector<uint64_t> m_words;
+
+	inline static uint32_t count_trailing_zeros(uint64_t word) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return index;
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+	inline static uint32_t count_leading_zeros(uint64_t word) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, word);
+		return 63 - index;
+#else
+		return __builtin_clzll(word);
+#endif
+	}
+	inline const uint64_t *get_line(uint32_t line) const { return m_words.data() + line * m_line_words; }
+
+public:
+	inline void Initialize(uint32_t lines, uint32_t bits) {
+		m_line_words = (bits + 63) / 64;
+		m_words.assign(lines * m_line_words, 0);
+	}
+	inline bool Get(uint32_t line, uint32_t bit) const { return get_line(line)[bit / 64] >> (bit % 64) & 1; }
+	inline void Set(uint32_t line, uint32_t bit, bool value) {
+		uint64_t &word = m_words[line * m_line_words + bit / 64];
+		if (value)
+			word |= 1ull << (bit % 64);
+		else
+			word &= ~(1ull << (bit % 64));
+	}
+
+	// no bit set in [begin, end)
+	inline bool IsEmpty(uint32_t line, uint32_t begin, uint32_t end) const {
+		if (begin >= end)
+			return true;
+		const uint64_t *p_words = get_line(line);
+		uint32_t begin_word = begin / 64, last_word = (end - 1) / 64;
+		uint64_t begin_mask = ~0ull << (begin % 64), last_mask = ~0ull >> (63 - (end - 1) % 64);
+		if (begin_word == last_word)
+			return (p_words[begin_word] & begin_mask & last_mask) == 0;
+		if (p_words[begin_word] & begin_mask)
+			return false;
+		for (uint32_t w = begin_word + 1; w < last_word; ++w)
+			if (p_words[w])
+				return false;
+		return (p_words[last_word] & last_mask) == 0;
+	}
+	// the nearest set bit before / after bit, which must exist
+	inline uint32_t FindPrev(uint32_t line, uint32_t bit) const {
+		const uint64_t *p_words = get_line(line);
+		uint32_t w = bit / 64;
+		uint64_t word = p_words[w] & ((1ull << (bit % 64)) - 1);
+		while (word == 0)
+			word = p_words[--w];
+		return w * 64 + 63 - count_leading_zeros(word);
+	}
+	inline uint32_t FindNext(uint32_t line, uint32_t bit) const {
+		const uint64_t *p_words = get_line(line);
+		uint32_t w = bit / 64;
+		uint64_t word = bit % 64 == 63 ? 0 : p_words[w] & (~0ull << (bit % 64 + 1));
+		while (word == 0)
+			word = p_words[++w];
+		return w * 64 + count_trailing_zeros(word);
+	}
+};
@@ -37,17 +37,15 @@ void Effect<EffectType::kPlus1S>::OnActive(Game *p_game, Player *p_player) {
 
 void Effect<EffectType::kShuffle>::OnActive(Game *p_game, Player *p_player) {
 	p_game->m_next_solution = std::array<Coord, 2>{};
-	p_game->m_grid.Shuffle(&p_game->m_random, &p_game->m_next_solution.value());
+	if (!p_game->m_grid.Shuffle(&p_game->m_random, &p_game->m_next_solution.value())) {
+		p_game->m_over = true;
+		p_game->m_next_solution.reset();
+	}
 
-	// Move players if overlapped
-	std::set<Coord> used_coords;
+	// The blocks keep their cells, so no player is overlapped, only the activations are stale
 	for (auto &player : p_game->m_players) {
 		player.m_activation.reset();  // De-activate
 		player.m_link_joints.clear(); // Clear Joints
-		if (p_game->m_grid[player.m_position]) {
-			player.m_position = p_game->m_grid.GetRandomSpace(&p_game->m_random, used_coords);
-			used_coords.insert(player.m_position);
-		}
 	}
 }
 
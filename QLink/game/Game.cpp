@@ -1,7 +1,7 @@
 #include "Game.hpp"
 
-void Game::Start(uint32_t width, uint32_t height, uint32_t initial_time, Block types, uint32_t player_count,
-                 const std::vector<EffectType> &available_effects) {
+void Game::Start(RandomSeed seed, uint32_t width, uint32_t height, uint32_t initial_time, Block types,
+                 uint32_t player_count, const std::vector<EffectType> &available_effects) {
 	assert(!available_effects.empty());
 	assert((width * height) % 2 == 0);
 
@@ -10,7 +10,9 @@ void Game::Start(uint32_t width, uint32_t height, uint32_t initial_time, Block t
 	m_paused = false;
 	m_time = initial_time;
 	m_next_solution = std::array<Coord, 2>{};
-	m_grid.InitializeRandomized(&m_random, width, height, types, &m_next_solution.value());
+	m_seed = seed;
+	m_random.seed(seed);
+	m_grid.InitializeSolvable(m_seed, width, height, types, &m_next_solution.value(), nullptr);
 
 	std::set<Coord> used_coords;
 	m_players.clear();
@@ -10,6 +10,7 @@
 class Game {
 private:
 	Random m_random;
+	RandomSeed m_seed{};
 	uint32_t m_time{};
 	Grid m_grid;
 	std::vector<Player> m_players;
@@ -35,6 +36,7 @@ public:
 	inline bool IsValid() const { return !m_players.empty() && m_grid.GetWidth() && m_grid.GetHeight(); }
 	inline const Grid &GetGrid() const { return m_grid; }
 	inline uint32_t GetTime() const { return m_time; }
+	inline RandomSeed GetSeed() const { return m_seed; }
 	inline void NextSecond() const { m_update.next_second = true; }
 	inline void TogglePause() const { m_update.toggle_pause = true; }
 	inline const std::vector<Player> &GetPlayers() const { return m_players; }
@@ -46,7 +48,8 @@ public:
 	inline const std::vector<EffectType> &GetAvailableEffects() const { return m_available_effects; }
 	inline const std::optional<std::array<Coord, 2>> &GetNextSolution() const { return m_next_solution; }
 
-	void Start(uint32_t width, uint32_t height, uint32_t initial_time, Block types, uint32_t player_count,
-	           const std::vector<EffectType> &available_effects);
+	// the same seed starts the same board and positions
+	void Start(RandomSeed seed, uint32_t width, uint32_t height, uint32_t initial_time, Block types,
+	           uint32_t player_count, const std::vector<EffectType> &available_effects);
 	void Update();
 };
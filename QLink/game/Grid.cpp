@@ -1,6 +1,8 @@
 #include "Grid.hpp"
 
 #include <algorithm>
+#include <deque>
+#include <optional>
 #include <random>
 
 void Grid::Initialize(uint32_t width, uint32_t height) {
@@ -8,6 +10,7 @@ void Grid::Initialize(uint32_t width, uint32_t height) {
 	m_height = height;
 	m_blocks.clear();
 	m_blocks.resize(m_width * m_height);
+	rebuild();
 }
 
 void Grid::InitializeRandomized(Random *p_random, uint32_t width, uint32_t height, Block types,
@@ -23,57 +26,314 @@ void Grid::InitializeRandomized(Random *p_random, uint32_t width, uint32_t heigh
 		if (i < m_blocks.size())
 			m_blocks[i] = type_dis(*p_random);
 	}
+	rebuild();
 	Shuffle(p_random, p_next_solution);
 }
 
-void Grid::Shuffle(Random *p_random, std::array<Coord, 2> *p_next_solution) {
-	do {
-		std::shuffle(m_blocks.begin(), m_blocks.end(), *p_random);
-	} while (!HasSolution(p_next_solution));
+void Grid::InitializeSolvable(RandomSeed seed, uint32_t width, uint32_t height, Block types,
+                              std::array<Coord, 2> *p_next_solution, std::vector<std::array<Coord, 2>> *p_solution) {
+	Random random{seed};
+	std::vector<std::array<Coord, 2>> solution;
+
+	// Plan the links from the outside in, a line of the remaining rectangle at a time. The rest of the board is
+	// empty, so any two blocks of the line link through the line outside it. An odd block left links to one of the
+	// next line, through the emptied line, so the next line is taken from the same side.
+	uint32_t x1 = 1, y1 = 1, x2 = width, y2 = height;
+	std::optional<Coord> odd;
+	uint32_t side = 0;
+	std::vector<Coord> line;
+	while (x1 <= x2 && y1 <= y2) {
+		if (!odd)
+			side = random() % 4;
+		line.clear();
+		if (side < 2) {
+			uint32_t y = side == 0 ? y1++ : y2--;
+			for (uint32_t x = x1; x <= x2; ++x)
+				line.push_back({x, y});
+		} else {
+			uint32_t x = side == 2 ? x1++ : x2--;
+			for (uint32_t y = y1; y <= y2; ++y)
+				line.push_back({x, y});
+		}
+		std::shuffle(line.begin(), line.end(), random);
+		if (odd) {
+			// Not the block next to the odd one, which may be surrounded
+			auto it = std::find_if(line.begin(), line.end(), [&odd, side](Coord c) {
+				return side < 2 ? c.x != odd->x : c.y != odd->y;
+			});
+			if (it == line.end())
+				it = line.begin();
+			solution.push_back({*odd, *it});
+			line.erase(it);
+			odd.reset();
+		}
+		for (std::size_t i = 0; i + 1 < line.size(); i += 2)
+			solution.push_back({line[i], line[i + 1]});
+		if (line.size() % 2)
+			odd = line.back();
+	}
+
+	// Place the links in the reverse order, each onto the board it is linked on
+	Initialize(width, height);
+	std::uniform_int_distribution<Block> type_dis{1, types};
+	for (auto it = solution.rbegin(); it != solution.rend(); ++it)
+		m_blocks[get_index((*it)[0])] = m_blocks[get_index((*it)[1])] = type_dis(random);
+	rebuild();
+	HasSolution(p_next_solution);
+	if (p_solution)
+		*p_solution = std::move(solution);
+}
+
+bool Grid::Shuffle(Random *p_random, std::array<Coord, 2> *p_next_solution) {
+	// The blocks are permuted over their own cells, so the corridors don't change and two cells linked now stay
+	// linked whatever their types. Two blocks of a type go to such cells, a move whatever the rest.
+	std::optional<std::array<Coord, 2>> cells_linked;
+	std::vector<Coord> cells;
+	std::vector<Block> blocks;
+	for (uint32_t y = 1; y <= m_height; ++y)
+		for (uint32_t x = 1; x <= m_width; ++x)
+			if (Get(x, y)) {
+				cells.push_back({x, y});
+				blocks.push_back(Get(x, y));
+			}
+	if (cells.empty())
+		return false;
+	const auto find_linked = [this, &cells_linked](Coord c) {
+		if (!is_surrounded(c))
+			visit_reachable(c, kMaxTurns, [this, c, &cells_linked](Coord d) {
+				if (d == c || is_surrounded(d))
+					return false;
+				cells_linked = {c, d};
+				return true;
+			});
+	};
+	for (uint32_t i = 0; i < kShuffleTries && !cells_linked; ++i)
+		find_linked(cells[(*p_random)() % cells.size()]);
+	// Past the tries, every cell in turn: no cells linked then, no permutation has a move
+	for (std::size_t i = 0; i < cells.size() && !cells_linked; ++i)
+		find_linked(cells[i]);
+
+	std::shuffle(blocks.begin(), blocks.end(), *p_random);
+	if (cells_linked) {
+		// The first block of a type with two blocks, and another of its type, go first
+		std::vector<uint32_t> counts;
+		for (Block b : blocks) {
+			if (counts.size() <= b)
+				counts.resize(b + 1);
+			++counts[b];
+		}
+		auto it = std::find_if(blocks.begin(), blocks.end(), [&counts](Block b) { return counts[b] >= 2; });
+		if (it != blocks.end()) {
+			std::iter_swap(blocks.begin(), it);
+			std::iter_swap(blocks.begin() + 1, std::find(blocks.begin() + 1, blocks.end(), blocks[0]));
+		} else
+			cells_linked.reset();
+	}
+	std::size_t i = 0;
+	if (cells_linked)
+		for (Coord c : *cells_linked)
+			m_blocks[get_index(c)] = blocks[i++];
+	for (Coord c : cells)
+		if (!cells_linked || !(c == (*cells_linked)[0] || c == (*cells_linked)[1]))
+			m_blocks[get_index(c)] = blocks[i++];
+	rebuild();
+	return HasSolution(p_next_solution);
 }
 
+void Grid::set_partner(Coord c, Coord partner) {
+	m_partners[get_index(c)] = partner;
+	if (partner == Coord{})
+		m_linkable.erase(c);
+	else
+		m_linkable.insert(c);
+}
+void Grid::unlist_block(Coord c) {
+	uint32_t index = get_index(c);
+	if (m_type_indices[index] == kUnlisted)
+		return;
+	auto &coords = m_type_coords[Get(c)];
+	Coord last = coords.back();
+	coords[m_type_indices[index]] = last;
+	m_type_indices[get_index(last)] = m_type_indices[index];
+	coords.pop_back();
+	m_type_indices[index] = kUnlisted;
+}
+void Grid::update_listing(Coord c) {
+	uint32_t index = get_index(c);
+	bool listed = m_type_indices[index] != kUnlisted, open = Get(c) && !is_surrounded(c);
+	if (listed && !open)
+		unlist_block(c);
+	else if (!listed && open) {
+		if (m_type_coords.size() <= Get(c))
+			m_type_coords.resize(Get(c) + 1);
+		m_type_indices[index] = (uint32_t)m_type_coords[Get(c)].size();
+		m_type_coords[Get(c)].push_back(c);
+	}
+}
+void Grid::set_block(Coord c, Block b) {
+	std::vector<Coord> stale;
+	if (Get(c)) {
+		for (Coord d : m_type_coords[Get(c)])
+			if (get_partner(d) == c)
+				stale.push_back(d);
+		unlist_block(c);
+		set_partner(c, {});
+	}
+	m_blocks[get_index(c)] = b;
+	m_rows.Set(c.y, c.x + 1, b);
+	m_cols.Set(c.x, c.y + 1, b);
+	if (m_type_coords.size() <= b)
+		m_type_coords.resize(b + 1);
+	// c and its neighbours may have been opened or closed
+	for (Coord n : {c, Coord{c.x - 1, c.y}, Coord{c.x + 1, c.y}, Coord{c.x, c.y - 1}, Coord{c.x, c.y + 1}})
+		if (Get(n))
+			update_listing(n);
+
+	// A link made or broken goes through c, so one of its ends is reached from c with at most one turn
+	for (Coord e : get_pos_reachable(c))
+		scan_partners(e, &stale);
+	for (Coord d : stale) {
+		Coord partner = get_partner(d);
+		if (partner == Coord{} || !IsLinked(d, partner, nullptr))
+			find_partner(d);
+	}
+}
+void Grid::scan_partners(Coord c, std::vector<Coord> *p_stale) {
+	// The blocks of its type without a partner may now have c, those with c may have lost it
+	Coord partner{};
+	bool surrounded = is_surrounded(c);
+	for (Coord d : m_type_coords[Get(c)]) {
+		Coord d_partner = get_partner(d);
+		if (d == c || !(partner == Coord{} || d_partner == Coord{} || d_partner == c))
+			continue;
+		if (!surrounded && IsLinked(c, d, nullptr)) {
+			if (partner == Coord{})
+				partner = d;
+			if (d_partner == Coord{})
+				set_partner(d, c);
+		} else if (d_partner == c)
+			p_stale->push_back(d);
+	}
+	set_partner(c, partner);
+}
+void Grid::rebuild() {
+	m_rows.Initialize(m_height + 2, m_width + 4);
+	m_cols.Initialize(m_width + 2, m_height + 4);
+	for (uint32_t y = 0; y <= m_height + 1; ++y) {
+		m_rows.Set(y, 0, true);
+		m_rows.Set(y, m_width + 3, true);
+	}
+	for (uint32_t x = 0; x <= m_width + 1; ++x) {
+		m_cols.Set(x, 0, true);
+		m_cols.Set(x, m_height + 3, true);
+	}
+	for (uint32_t y = 1; y <= m_height; ++y)
+		for (uint32_t x = 1; x <= m_width; ++x)
+			if (Get(x, y)) {
+				m_rows.Set(y, x + 1, true);
+				m_cols.Set(x, y + 1, true);
+			}
+
+	m_type_coords.clear();
+	m_type_indices.assign(m_blocks.size(), kUnlisted);
+	m_partners.assign(m_blocks.size(), {});
+	m_linkable.clear();
+	for (uint32_t y = 1; y <= m_height; ++y)
+		for (uint32_t x = 1; x <= m_width; ++x)
+			update_listing({x, y});
+	for (uint32_t y = 1; y <= m_height; ++y)
+		for (uint32_t x = 1; x <= m_width; ++x) {
+			if (Get(x, y) == 0 || !(get_partner({x, y}) == Coord{}))
+				continue;
+			find_partner({x, y});
+			Coord partner = get_partner({x, y});
+			if (!(partner == Coord{}) && get_partner(partner) == Coord{})
+				set_partner(partner, {x, y});
+		}
+}
+template <typename Func> bool Grid::visit_reachable(Coord c, uint32_t max_turns, Func &&func) const {
+	const auto reach = [this, &func](Coord d) { return Get(d) && func(d); };
+	// The blocks ending the corridors from c, then those ending the perpendicular corridors from each of their
+	// cells, then those from the cells of these
+	auto [x1, x2] = get_pos_h_bound(c);
+	auto [y1, y2] = get_pos_v_bound(c);
+	if (reach({x1 - 1, c.y}) || reach({x2 + 1, c.y}) || reach({c.x, y1 - 1}) || reach({c.x, y2 + 1}))
+		return true;
+	for (uint32_t turns = 1; turns <= max_turns && turns <= 2; ++turns) {
+		for (uint32_t x = x1; x <= x2; ++x) {
+			if (x == c.x)
+				continue;
+			auto [cy1, cy2] = get_pos_v_bound({x, c.y});
+			if (turns == 1 && (reach({x, cy1 - 1}) || reach({x, cy2 + 1})))
+				return true;
+			for (uint32_t y = cy1; turns == 2 && y <= cy2; ++y) {
+				auto [cx1, cx2] = get_pos_h_bound({x, y});
+				if (y != c.y && (reach({cx1 - 1, y}) || reach({cx2 + 1, y})))
+					return true;
+			}
+		}
+		for (uint32_t y = y1; y <= y2; ++y) {
+			if (y == c.y)
+				continue;
+			auto [cx1, cx2] = get_pos_h_bound({c.x, y});
+			if (turns == 1 && (reach({cx1 - 1, y}) || reach({cx2 + 1, y})))
+				return true;
+			for (uint32_t x = cx1; turns == 2 && x <= cx2; ++x) {
+				auto [cy1, cy2] = get_pos_v_bound({x, y});
+				if (x != c.x && (reach({x, cy1 - 1}) || reach({x, cy2 + 1})))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+std::vector<Coord> Grid::get_pos_reachable(Coord c) const {
+	std::vector<Coord> ret;
+	if (Get(c))
+		ret.push_back(c);
+	visit_reachable(c, 1, [&ret](Coord d) {
+		ret.push_back(d);
+		return false;
+	});
+	std::sort(ret.begin(), ret.end());
+	ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+	return ret;
+}
+
+void Grid::find_partner(Coord c) {
+	// A block further than a neighbour is reached through an empty cell, so it can't be surrounded
+	Coord partner{};
+	if (!is_surrounded(c))
+		visit_reachable(c, kMaxTurns, [this, c, &partner](Coord d) {
+			if (d == c || Get(d) != Get(c) || is_surrounded(d))
+				return false;
+			partner = d;
+			return true;
+		});
+	set_partner(c, partner);
+}
 bool Grid::is_surrounded(Coord c) const {
 	return Get(c.x - 1, c.y) && Get(c.x + 1, c.y) && Get(c.x, c.y - 1) && Get(c.x, c.y + 1);
 }
 bool Grid::is_pos_h_linked(Coord c1, Coord c2) const {
 	if (c1.y != c2.y)
 		return false;
-	if (c1.y == 0 || c1.y == m_height + 1)
-		return true;
 	if (c1.x > c2.x)
 		std::swap(c1.x, c2.x);
-	for (uint32_t x = c1.x + 1; x < c2.x; ++x)
-		if (Get(x, c1.y))
-			return false;
-	return true;
+	return m_rows.IsEmpty(c1.y, c1.x + 2, c2.x + 1);
 }
 bool Grid::is_pos_v_linked(Coord c1, Coord c2) const {
 	if (c1.x != c2.x)
 		return false;
-	if (c1.x == 0 || c1.x == m_width + 1)
-		return true;
 	if (c1.y > c2.y)
 		std::swap(c1.y, c2.y);
-	for (uint32_t y = c1.y + 1; y < c2.y; ++y)
-		if (Get(c1.x, y))
-			return false;
-	return true;
+	return m_cols.IsEmpty(c1.x, c1.y + 2, c2.y + 1);
 }
 std::pair<uint32_t, uint32_t> Grid::get_pos_h_bound(Coord c) const {
-	uint32_t x1 = c.x, x2 = c.x;
-	while (x1 >= 1 && Get(x1 - 1, c.y) == 0)
-		--x1;
-	while (x2 <= m_width && Get(x2 + 1, c.y) == 0)
-		++x2;
-	return {x1, x2};
+	return {m_rows.FindPrev(c.y, c.x + 1), m_rows.FindNext(c.y, c.x + 1) - 2};
 }
 std::pair<uint32_t, uint32_t> Grid::get_pos_v_bound(Coord c) const {
-	uint32_t y1 = c.y, y2 = c.y;
-	while (y1 >= 1 && Get(c.x, y1 - 1) == 0)
-		--y1;
-	while (y2 <= m_height && Get(c.x, y2 + 1) == 0)
-		++y2;
-	return {y1, y2};
+	return {m_cols.FindPrev(c.x, c.y + 1), m_cols.FindNext(c.x, c.y + 1) - 2};
 }
 
 bool Grid::IsLinked(Coord c1, Coord c2, std::vector<Coord> *p_joints) const {
@@ -141,23 +401,85 @@ bool Grid::IsLinked(Coord c1, Coord c2, std::vector<Coord> *p_joints) const {
 	return false;
 }
 
-bool Grid::HasSolution(std::array<Coord, 2> *p_next_solution) const {
-	for (uint32_t y1 = 1; y1 <= m_height; ++y1)
-		for (uint32_t x1 = 1; x1 <= m_width; ++x1) {
-			if (Get(x1, y1) == 0)
-				continue;
-			for (uint32_t y2 = y1; y2 <= m_height; ++y2)
-				for (uint32_t x2 = 1; x2 <= m_width; ++x2) {
-					if (IsLinked({x1, y1}, {x2, y2}, nullptr)) {
-						if (p_next_solution) {
-							(*p_next_solution)[0] = {x1, y1};
-							(*p_next_solution)[1] = {x2, y2};
-						}
-						return true;
-					}
+std::vector<Coord> Grid::GetLinked(Coord c, uint32_t max_turns, std::vector<std::vector<Coord>> *p_joints) const {
+	std::vector<Coord> ret;
+	if (p_joints)
+		p_joints->clear();
+	if (Get(c) == 0 || is_surrounded(c))
+		return ret;
+
+	// 0-1 BFS over the states (cell, direction) of the grid and its border, going straight is free, turning costs one
+	constexpr uint32_t kDirections[4][2] = {{1, 0}, {~0u, 0}, {0, 1}, {0, ~0u}};
+	constexpr uint32_t kUnreached = ~0u;
+	const uint32_t line = m_width + 2;
+	const auto get_state = [line](Coord p, uint32_t dir) { return (p.y * line + p.x) * 4 + dir; };
+	const auto get_cell = [line](uint32_t state) { return Coord{state / 4 % line, state / 4 / line}; };
+	std::vector<uint32_t> turns((m_height + 2) * line * 4, kUnreached), parents;
+	std::vector<bool> found(m_blocks.size());
+	std::deque<std::pair<uint32_t, uint32_t>> queue;
+	if (p_joints)
+		parents.resize(turns.size());
+	for (uint32_t dir = 0; dir < 4; ++dir) {
+		turns[get_state(c, dir)] = 0;
+		queue.emplace_back(get_state(c, dir), 0);
+	}
+	while (!queue.empty()) {
+		auto [state, t] = queue.front();
+		queue.pop_front();
+		if (t > turns[state])
+			continue;
+		Coord p = get_cell(state);
+		uint32_t dir = state % 4;
+		// Turn, except at c, where it would only be a worse start
+		if (t < max_turns && !(p == c))
+			for (uint32_t new_dir : {dir < 2 ? 2u : 0u, dir < 2 ? 3u : 1u}) {
+				uint32_t new_state = get_state(p, new_dir);
+				if (turns[new_state] > t + 1) {
+					turns[new_state] = t + 1;
+					if (p_joints)
+						parents[new_state] = state;
+					queue.emplace_back(new_state, t + 1);
 				}
+			}
+		// Go straight, through the empty cells to a block
+		Coord q = {p.x + kDirections[dir][0], p.y + kDirections[dir][1]};
+		if (q.x > m_width + 1 || q.y > m_height + 1)
+			continue;
+		if (Get(q) == 0) {
+			uint32_t new_state = get_state(q, dir);
+			if (turns[new_state] > t) {
+				turns[new_state] = t;
+				if (p_joints)
+					parents[new_state] = state;
+				queue.emplace_front(new_state, t);
+			}
+			continue;
 		}
-	return false;
+		if (Get(q) != Get(c) || q == c || found[get_index(q)] || is_surrounded(q))
+			continue;
+		found[get_index(q)] = true;
+		ret.push_back(q);
+		if (p_joints) {
+			std::vector<Coord> joints = {q};
+			for (uint32_t s = state; !(get_cell(s) == c); s = parents[s])
+				if (parents[s] % 4 != s % 4)
+					joints.push_back(get_cell(s));
+			joints.push_back(c);
+			std::reverse(joints.begin(), joints.end());
+			p_joints->push_back(std::move(joints));
+		}
+	}
+	return ret;
+}
+
+bool Grid::HasSolution(std::array<Coord, 2> *p_next_solution) const {
+	if (m_linkable.empty())
+		return false;
+	if (p_next_solution) {
+		(*p_next_solution)[0] = *m_linkable.begin();
+		(*p_next_solution)[1] = get_partner(*m_linkable.begin());
+	}
+	return true;
 }
 
 Coord Grid::GetRandomSpace(Random *p_random, const std::set<Coord> &exclude_coords) const {
@@ -6,6 +6,7 @@
 #include <set>
 #include <vector>
 
+#include "Bitboard.hpp"
 #include "Block.hpp"
 #include "Coord.hpp"
 #include "Random.hpp"
@@ -14,6 +15,33 @@ class Grid {
 private:
 	uint32_t m_width, m_height;
 	std::vector<Block> m_blocks;
+	// Occupancy by row (bit x + 1 of line y) and by column (bit y + 1 of line x), including the empty border, with
+	// a sentinel bit past each end so that bound searches always stop
+	Bitboard m_rows, m_cols;
+
+	// Coordinates of the blocks of each type that are not surrounded (the others can't link), and the index of each
+	// block in its list (kUnlisted if not in it)
+	inline static constexpr uint32_t kUnlisted = ~0u;
+	std::vector<std::vector<Coord>> m_type_coords;
+	std::vector<uint32_t> m_type_indices;
+	// A block each block can link to ({0, 0} if none, then it links to no block), updated on each Set from the blocks
+	// whose corridors go through the changed cell
+	std::vector<Coord> m_partners;
+	std::set<Coord> m_linkable;
+	// The random cells searched for a link by Shuffle before it searches all the cells
+	inline static constexpr uint32_t kShuffleTries = 16;
+
+	inline uint32_t get_index(Coord c) const { return (c.y - 1) * m_width + c.x - 1; }
+	inline Coord get_partner(Coord c) const { return m_partners[get_index(c)]; }
+	void unlist_block(Coord c);
+	void update_listing(Coord c);
+	void set_partner(Coord c, Coord partner);
+	void set_block(Coord c, Block b);
+	void find_partner(Coord c);
+	void scan_partners(Coord c, std::vector<Coord> *p_stale);
+	void rebuild();
+	template <typename Func> bool visit_reachable(Coord c, uint32_t max_turns, Func &&func) const;
+	std::vector<Coord> get_pos_reachable(Coord c) const;
 
 	inline bool is_surrounded(Coord c) const;
 	inline bool is_pos_h_linked(Coord c1, Coord c2) const;
@@ -24,13 +52,16 @@ private:
 	template <typename> friend class Serializer;
 
 public:
+	// The turns a link may take
+	inline static constexpr uint32_t kMaxTurns = 2;
+
 	inline Block Get(uint32_t x, uint32_t y) const {
 		return 1 <= x && x <= m_width && 1 <= y && y <= m_height ? m_blocks[(y - 1) * m_width + x - 1] : 0;
 	}
 	inline Block Get(Coord c) const { return Get(c.x, c.y); }
 	inline void Set(uint32_t x, uint32_t y, Block b) {
-		if (1 <= x && x <= m_width && 1 <= y && y <= m_height)
-			m_blocks[(y - 1) * m_width + x - 1] = b;
+		if (1 <= x && x <= m_width && 1 <= y && y <= m_height && m_blocks[(y - 1) * m_width + x - 1] != b)
+			set_block({x, y}, b);
 	}
 	inline void Set(Coord c, Block b) { Set(c.x, c.y, b); }
 	inline Block operator[](Coord c) const { return Get(c); }
@@ -41,8 +72,14 @@ public:
 	void Initialize(uint32_t width, uint32_t height);
 	void InitializeRandomized(Random *p_random, uint32_t width, uint32_t height, Block types,
 	                          std::array<Coord, 2> *p_next_solution);
-	void Shuffle(Random *p_random, std::array<Coord, 2> *p_next_solution);
+	// A board that clears in the order of p_solution, the same for the same seed
+	void InitializeSolvable(RandomSeed seed, uint32_t width, uint32_t height, Block types,
+	                        std::array<Coord, 2> *p_next_solution, std::vector<std::array<Coord, 2>> *p_solution);
+	// Permutes the blocks over their cells with a move guaranteed if any permutation has one, false if none has
+	bool Shuffle(Random *p_random, std::array<Coord, 2> *p_next_solution);
 	bool IsLinked(Coord c1, Coord c2, std::vector<Coord> *p_joints) const;
+	// The blocks c links to with at most max_turns turns, nearest in turns first, with the joints of each link
+	std::vector<Coord> GetLinked(Coord c, uint32_t max_turns, std::vector<std::vector<Coord>> *p_joints) const;
 	bool HasSolution(std::array<Coord, 2> *p_next_solution) const;
 	Coord GetRandomSpace(Random *p_random, const std::set<Coord> &exclude_coords) const;
 };
@@ -160,14 +160,16 @@ template <> struct Serializer<Grid> {
 		ret.m_width = Serializer<uint32_t>::Read(istr);
 		ret.m_height = Serializer<uint32_t>::Read(istr);
 		ret.m_blocks = Serializer<std::vector<Block>>::Read(istr);
+		ret.rebuild();
 		return ret;
 	}
 };
 
 template <> struct Serializer<Game> {
-	inline static constexpr char kVersionStr[] = "QLink1.0";
+	inline static constexpr char kVersionStr[] = "QLink1.1";
 	template <typename Stream> inline static void Write(Stream &&ostr, const Game &val) {
 		ostr.write(kVersionStr, sizeof(kVersionStr));
+		Serializer<uint32_t>::Write(ostr, val.m_seed);
 		Serializer<uint32_t>::Write(ostr, val.m_time);
 		Serializer<Grid>::Write(ostr, val.m_grid);
 		Serializer<std::vector<Player>>::Write(ostr, val.m_players);
@@ -185,6 +187,7 @@ template <> struct Serializer<Game> {
 		istr.read(version_str, sizeof(kVersionStr));
 		if (strcmp(kVersionStr, version_str) != 0)
 			return ret;
+		ret.m_seed = Serializer<uint32_t>::Read(istr);
 		ret.m_time = Serializer<uint32_t>::Read(istr);
 		ret.m_grid = Serializer<Grid>::Read(istr);
 		ret.m_players = Serializer<std::vector<Player>>::Read(istr);